@@ -0,0 +1,123 @@
+/* Bump allocator for memory which lives as long as one command.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include "memory.h"
+#include "arena.h"
+
+struct arena_chunk
+{
+  struct arena_chunk *next;
+  size_t size;
+  char data[1];
+};
+
+#define ARENA_ALIGN(n) (((n) + sizeof (void *) - 1) & ~(sizeof (void *) - 1))
+
+/* Start a new chunk with room for at least SIZE bytes. */
+static void
+arena_grow (struct arena *arena, size_t size)
+{
+  struct arena_chunk *chunk;
+
+  if (size < ARENA_CHUNK_SIZE)
+    size = ARENA_CHUNK_SIZE;
+
+  chunk = XMALLOC (MTYPE_VTY_ARENA, sizeof (struct arena_chunk) + size);
+  chunk->size = size;
+  chunk->next = arena->head;
+  arena->head = chunk;
+  arena->ptr = chunk->data;
+  arena->end = chunk->data + size;
+}
+
+/* Allocate SIZE bytes which are freed by arena_reset (). */
+void *
+arena_alloc (struct arena *arena, size_t size)
+{
+  char *p;
+
+  size = ARENA_ALIGN (size);
+  if ((size_t) (arena->end - arena->ptr) < size)
+    arena_grow (arena, size);
+
+  p = arena->ptr;
+  arena->ptr += size;
+  return p;
+}
+
+/* Copy LEN bytes of STR to the arena as a string. */
+char *
+arena_strndup (struct arena *arena, const char *str, size_t len)
+{
+  char *p;
+
+  p = arena_alloc (arena, len + 1);
+  memcpy (p, str, len);
+  p[len] = '\0';
+  return p;
+}
+
+/* Free everything allocated.  A chunk of the default size is kept,
+   most commands fit into it and then never touch the allocator;
+   larger ones, made for single large requests, are given back. */
+void
+arena_reset (struct arena *arena)
+{
+  struct arena_chunk *chunk;
+  struct arena_chunk *next;
+  struct arena_chunk *keep = NULL;
+
+  for (chunk = arena->head; chunk; chunk = next)
+    {
+      next = chunk->next;
+      if (keep == NULL && chunk->size == ARENA_CHUNK_SIZE)
+        keep = chunk;
+      else
+        XFREE (MTYPE_VTY_ARENA, chunk);
+    }
+
+  arena->head = keep;
+  if (keep == NULL)
+    {
+      arena->ptr = arena->end = NULL;
+      return;
+    }
+  keep->next = NULL;
+  arena->ptr = keep->data;
+  arena->end = keep->data + keep->size;
+}
+
+/* Free the arena's memory. */
+void
+arena_fini (struct arena *arena)
+{
+  struct arena_chunk *chunk;
+  struct arena_chunk *next;
+
+  for (chunk = arena->head; chunk; chunk = next)
+    {
+      next = chunk->next;
+      XFREE (MTYPE_VTY_ARENA, chunk);
+    }
+  arena->head = NULL;
+  arena->ptr = arena->end = NULL;
+}
@@ -0,0 +1,45 @@
+/* Bump allocator for memory which lives as long as one command.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_ARENA_H
+#define _ZEBRA_ARENA_H
+
+/* Size of the chunks memory is cut from, larger requests get a chunk
+   of their own. */
+#define ARENA_CHUNK_SIZE 4096
+
+struct arena_chunk;
+
+/* An arena.  All zero is an empty arena, nothing is allocated before
+   the first arena_alloc (). */
+struct arena
+{
+  struct arena_chunk *head;
+  char *ptr;
+  char *end;
+};
+
+/* Prototypes. */
+void *arena_alloc (struct arena *, size_t);
+char *arena_strndup (struct arena *, const char *, size_t);
+void arena_reset (struct arena *);
+void arena_fini (struct arena *);
+
+#endif /* _ZEBRA_ARENA_H */
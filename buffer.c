@@ -24,6 +24,7 @@
 
 #include "memory.h"
 #include "buffer.h"
+#include "ioloop.h"
 
 /* Make buffer data. */
 struct buffer_data *
@@ -187,6 +188,64 @@ buffer_write (struct buffer *b, u_char *ptr, size_t size)
   return 1;
 }
 
+/* Write the IOVCNT pieces at IOV to the buffer in one pass, copying
+   each straight into the data blocks. */
+int
+buffer_writev (struct buffer *b, const struct iovec *iov, int iovcnt)
+{
+  struct buffer_data *data = b->tail;
+  const u_char *p;
+  size_t left, n;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      p = iov[i].iov_base;
+      left = iov[i].iov_len;
+      b->length += left;
+      while (left)
+        {
+          if (data == NULL || data->cp == b->size)
+            {
+              buffer_add (b);
+              data = b->tail;
+            }
+          n = b->size - data->cp;
+          if (n > left)
+            n = left;
+          memcpy (data->data + data->cp, p, n);
+          data->cp += n;
+          p += n;
+          left -= n;
+        }
+    }
+  return 1;
+}
+
+/* Move all data of SRC to the end of B without copying.  Both buffers
+   must have been created with the same data size. */
+void
+buffer_splice (struct buffer *b, struct buffer *src)
+{
+  if (src->head == NULL)
+    return;
+
+  if (b->tail == NULL)
+    b->head = src->head;
+  else
+    {
+      b->tail->next = src->head;
+      src->head->prev = b->tail;
+    }
+  b->tail = src->tail;
+  b->alloc += src->alloc;
+  b->length += src->length;
+
+  src->head = src->tail = NULL;
+  src->alloc = 0;
+  src->length = 0;
+}
+
 /* Insert character into the buffer. */
 int
 buffer_putc (struct buffer *b, u_char c)
@@ -248,7 +307,7 @@ buffer_flush (struct buffer *b, int fd, size_t size)
     }
 
   /* Write buffer to the fd. */
-  writev (fd, iovec, iov_index);
+  io_writev (fd, iovec, iov_index);
 
   /* Free printed buffer data. */
   for (out = b->head; out && out != data; out = next)
@@ -288,7 +347,7 @@ buffer_flush_all (struct buffer *b, int fd)
       iovec[iov_index].iov_len = d->cp - d->sp;
       iov_index++;
     }
-  ret = writev (fd, iovec, iov_index);
+  ret = io_writev (fd, iovec, iov_index);
 
   free (iovec);
 
@@ -348,7 +407,7 @@ buffer_flush_vty_all (struct buffer *b, int fd, int erase_flag,
     }
 
   /* We use write or writev*/
-  nbytes = writev (fd, iov, iov_index);
+  nbytes = io_writev (fd, iov, iov_index);
 
   /* Error treatment. */
   if (nbytes < 0)
@@ -464,7 +523,7 @@ buffer_flush_vty (struct buffer *b, int fd, int size,
        /* initialize write vector size at once */
        iov_size = ( total_size > IOV_MAX ) ? IOV_MAX : total_size;
 
-       c_nbytes = writev (fd, c_iov, iov_size );
+       c_nbytes = io_writev (fd, c_iov, iov_size );
 
        if( c_nbytes < 0 )
          {
@@ -486,7 +545,7 @@ buffer_flush_vty (struct buffer *b, int fd, int size,
        total_size -= iov_size;
     }
 #else  /* IOV_MAX */
-   nbytes = writev (fd, iov, iov_index);
+   nbytes = io_writev (fd, iov, iov_index);
 
   /* Error treatment. */
   if (nbytes < 0)
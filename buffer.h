@@ -64,6 +64,8 @@ struct buffer_data
 /* Buffer prototypes. */
 struct buffer *buffer_new (size_t);
 int buffer_write (struct buffer *, u_char *, size_t);
+int buffer_writev (struct buffer *, const struct iovec *, int);
+void buffer_splice (struct buffer *, struct buffer *);
 void buffer_free (struct buffer *);
 char *buffer_getstr (struct buffer *);
 int buffer_putc (struct buffer *, u_char);
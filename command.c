@@ -23,6 +23,8 @@ Boston, MA 02111-1307, USA.  */
 #include "command.h"
 #include "memory.h"
 #include "log.h"
+#include "worker.h"
+#include "intern.h"
 char *host_name = "";
 
 /* Command vector which includes some level of command lists. Normally
@@ -72,36 +74,33 @@ struct cmd_node config_node =
 };
 
 /* Utility function to concatenate argv argument into a single string
-   with inserting ' ' character between each argument.  */
+   with inserting ' ' character between each argument.  The string is
+   part of VTY's command arena, it must not be freed.  */
 char *
-argv_concat (char **argv, int argc, int shift)
+argv_concat (struct vty *vty, char **argv, int argc, int shift)
 {
   int i;
   int len;
-  int index;
   char *str;
+  char *p;
 
-  str = NULL;
-  index = 0;
+  if (shift >= argc)
+    return NULL;
 
+  len = 0;
   for (i = shift; i < argc; i++)
-    {
-      len = strlen (argv[i]);
+    len += strlen (argv[i]) + 1;
 
-      if (i == shift)
-    {
-      str = XSTRDUP (MTYPE_TMP, argv[i]);
-      index = len;
-    }
-      else
+  str = p = arena_alloc (&vty->arena, len);
+  for (i = shift; i < argc; i++)
     {
-      str = XREALLOC (MTYPE_TMP, str, (index + len + 2));
-      str[index++] = ' ';
-      memcpy (str + index, argv[i], len);
-      index += len;
-      str[index] = '\0';
-    }
+      len = strlen (argv[i]);
+      memcpy (p, argv[i], len);
+      p += len;
+      *p++ = ' ';
     }
+  p[-1] = '\0';
+
   return str;
 }
 
@@ -161,9 +160,10 @@ sort_node ()
 
 /* Breaking up string into each command piece. I assume given
    character is separated by a space character. Return value is a
-   vector which includes char ** data element. */
-vector
-cmd_make_strvec (char *string)
+   vector which includes char ** data element.  With ARENA set, the
+   vector and its strings are allocated there. */
+static vector
+cmd_strvec_make (struct arena *arena, char *string)
 {
   char *cp, *start, *token;
   int strlen;
@@ -186,7 +186,10 @@ cmd_make_strvec (char *string)
     return NULL;
 
   /* Prepare return vector. */
-  strvec = vector_init (VECTOR_MIN_SIZE);
+  if (arena)
+    strvec = vector_init_arena (arena, VECTOR_MIN_SIZE);
+  else
+    strvec = vector_init (VECTOR_MIN_SIZE);
 
   /* Copy each command piece and set into vector. */
   while (1) 
@@ -196,9 +199,14 @@ cmd_make_strvec (char *string)
          *cp != '\0')
     cp++;
       strlen = cp - start;
-      token = XMALLOC (MTYPE_STRVEC, strlen + 1);
-      memcpy (token, start, strlen);
-      *(token + strlen) = '\0';
+      if (arena)
+        token = arena_strndup (arena, start, strlen);
+      else
+        {
+          token = XMALLOC (MTYPE_STRVEC, strlen + 1);
+          memcpy (token, start, strlen);
+          *(token + strlen) = '\0';
+        }
       vector_set (strvec, token);
 
       while ((isspace ((int) *cp) || *cp == '\n' || *cp == '\r') &&
@@ -210,6 +218,19 @@ cmd_make_strvec (char *string)
     }
 }
 
+vector
+cmd_make_strvec (char *string)
+{
+  return cmd_strvec_make (NULL, string);
+}
+
+/* Split STRING up into ARENA, nothing needs to be freed. */
+vector
+cmd_make_strvec_arena (struct arena *arena, char *string)
+{
+  return cmd_strvec_make (arena, string);
+}
+
 /* Free allocated string vector. */
 void
 cmd_free_strvec (vector v)
@@ -217,7 +238,7 @@ cmd_free_strvec (vector v)
   int i;
   char *cp;
 
-  if (!v)
+  if (!v || v->arena)
     return;
 
   for (i = 0; i < vector_max (v); i++)
@@ -227,7 +248,8 @@ cmd_free_strvec (vector v)
   vector_free (v);
 }
 
-/* Fetch next description.  Used in cmd_make_descvec(). */
+/* Fetch next description.  Used in cmd_make_descvec().  The result
+   is interned. */
 char *
 cmd_desc_str (char **string)
 {
@@ -253,9 +275,7 @@ cmd_desc_str (char **string)
     cp++;
 
   strlen = cp - start;
-  token = XMALLOC (MTYPE_STRVEC, strlen + 1);
-  memcpy (token, start, strlen);
-  *(token + strlen) = '\0';
+  token = intern_n (start, strlen);
 
   *string = cp;
 
@@ -328,9 +348,7 @@ cmd_make_descvec (char *string, char *descstr)
 
       len = cp - sp;
 
-      token = XMALLOC (MTYPE_STRVEC, len + 1);
-      memcpy (token, sp, len);
-      *(token + len) = '\0';
+      token = intern_n (sp, len);
 
       desc = XCALLOC (MTYPE_DESC, sizeof (struct desc));
       desc->cmd = token;
@@ -1061,6 +1079,7 @@ cmd_filter_by_completion (char *command, vector v, int index)
 {
   int i;
   char *str;
+  char *icommand;
   struct cmd_element *cmd_element;
   enum match_type match_type;
   vector descvec;
@@ -1068,12 +1087,15 @@ cmd_filter_by_completion (char *command, vector v, int index)
   
   match_type = no_match;
 
+  /* Keywords are interned, one that is equal to COMMAND is the same
+     pointer. */
+  icommand = intern_lookup (command);
+
   /* If command and cmd_element string does not match set NULL to vector */
-  for (i = 0; i < vector_max (v); i++) 
-    if ((cmd_element = vector_slot (v, i)) != NULL)
+  vector_foreach (v, i, cmd_element)
       {
     if (index >= vector_max (cmd_element->strvec))
-      vector_slot (v, i) = NULL;
+      vector_unset (v, i);
     else
       {
         int j;
@@ -1151,7 +1173,7 @@ cmd_filter_by_completion (char *command, vector v, int index)
           }
         else if (strncmp (command, str, strlen (command)) == 0)
           {
-            if (strcmp (command, str) == 0) 
+            if (str == icommand)
               match_type = exact_match;
             else
               {
@@ -1162,7 +1184,7 @@ cmd_filter_by_completion (char *command, vector v, int index)
           }
           }
         if (! matched)
-          vector_slot (v, i) = NULL;
+          vector_unset (v, i);
       }
       }
   return match_type;
@@ -1174,21 +1196,22 @@ cmd_filter_by_string (char *command, vector v, int index)
 {
   int i;
   char *str;
+  char *icommand;
   struct cmd_element *cmd_element;
   enum match_type match_type;
   vector descvec;
   struct desc *desc;
   
   match_type = no_match;
+  icommand = intern_lookup (command);
 
   /* If command and cmd_element string does not match set NULL to vector */
-  for (i = 0; i < vector_max (v); i++) 
-    if ((cmd_element = vector_slot (v, i)) != NULL)
+  vector_foreach (v, i, cmd_element)
       {
     /* If given index is bigger than max string vector of command,
            set NULL*/
     if (index >= vector_max (cmd_element->strvec))
-      vector_slot (v, i) = NULL;
+      vector_unset (v, i);
     else 
       {
         int j;
@@ -1260,7 +1283,7 @@ cmd_filter_by_string (char *command, vector v, int index)
           }
         else
           {       
-            if (strcmp (command, str) == 0)
+            if (str == icommand)
               {
             match_type = exact_match;
             matched++;
@@ -1268,7 +1291,7 @@ cmd_filter_by_string (char *command, vector v, int index)
           }
           }
         if (! matched)
-          vector_slot (v, i) = NULL;
+          vector_unset (v, i);
       }
       }
   return match_type;
@@ -1283,11 +1306,13 @@ is_cmd_ambiguous (char *command, vector v, int index, enum match_type type)
   char *str = NULL;
   struct cmd_element *cmd_element;
   char *matched = NULL;
+  char *icommand;
   vector descvec;
   struct desc *desc;
   
-  for (i = 0; i < vector_max (v); i++) 
-    if ((cmd_element = vector_slot (v, i)) != NULL)
+  icommand = intern_lookup (command);
+
+  vector_foreach (v, i, cmd_element)
       {
     int match = 0;
 
@@ -1304,14 +1329,14 @@ is_cmd_ambiguous (char *command, vector v, int index, enum match_type type)
           {
           case exact_match:
         if (! (CMD_OPTION (str) || CMD_VARIABLE (str))
-            && strcmp (command, str) == 0)
+            && str == icommand)
           match++;
         break;
           case partly_match:
         if (! (CMD_OPTION (str) || CMD_VARIABLE (str))
             && strncmp (command, str, strlen (command)) == 0)
           {
-            if (matched && strcmp (matched, str) != 0)
+            if (matched && matched != str)
               return 1; /* There is ambiguous match. */
             else
               matched = str;
@@ -1321,7 +1346,7 @@ is_cmd_ambiguous (char *command, vector v, int index, enum match_type type)
           case range_match:
         if (cmd_range_match (str, command))
           {
-            if (matched && strcmp (matched, str) != 0)
+            if (matched && matched != str)
               return 1;
             else
               matched = str;
@@ -1364,7 +1389,7 @@ is_cmd_ambiguous (char *command, vector v, int index, enum match_type type)
           }
       }
     if (! match)
-      vector_slot (v, i) = NULL;
+      vector_unset (v, i);
       }
   return 0;
 }
@@ -1501,7 +1526,7 @@ cmd_describe_command (vector vline, struct vty *vty, int *status)
   index = vector_max (vline) - 1;
 
   /* Make copy vector of current node's command vector. */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
+  cmd_vector = vector_copy_arena (&vty->arena, cmd_node_vector (cmdvec, vty->node));
 
   /* Prepare match vector */
   matchvec = vector_init (INIT_MATCHVEC_SIZE);
@@ -1519,8 +1544,7 @@ cmd_describe_command (vector vline, struct vty *vty, int *status)
       vector descvec;
       int j, k;
 
-      for (j = 0; j < vector_max (cmd_vector); j++)
-        if ((cmd_element = vector_slot (cmd_vector, j)) != NULL)
+      vector_foreach (cmd_vector, j, cmd_element)
           {
         descvec = vector_slot (cmd_element->strvec,
                        vector_max (cmd_element->strvec) - 1);
@@ -1532,20 +1556,17 @@ cmd_describe_command (vector vline, struct vty *vty, int *status)
           }
 
       vector_set (matchvec, &desc_cr);
-      vector_free (cmd_vector);
 
       return matchvec;
     }
 
       if ((ret = is_cmd_ambiguous (command, cmd_vector, i, match)) == 1)
     {
-      vector_free (cmd_vector);
       *status = CMD_ERR_AMBIGUOUS;
       return NULL;
     }
       else if (ret == 2)
     {
-      vector_free (cmd_vector);
       *status = CMD_ERR_NO_MATCH;
       return NULL;
     }
@@ -1560,15 +1581,14 @@ cmd_describe_command (vector vline, struct vty *vty, int *status)
     match = cmd_filter_by_completion (command, cmd_vector, index);
 
   /* Make description vector. */
-  for (i = 0; i < vector_max (cmd_vector); i++)
-    if ((cmd_element = vector_slot (cmd_vector, i)) != NULL)
+  vector_foreach (cmd_vector, i, cmd_element)
       {
     char *string = NULL;
     vector strvec = cmd_element->strvec;
 
         /* if command is NULL, index may be equal to vector_max */
     if (command && index >= vector_max (strvec))
-      vector_slot (cmd_vector, i) = NULL;
+      vector_unset (cmd_vector, i);
     else
       {
         /* Check if command is completed. */
@@ -1598,7 +1618,6 @@ cmd_describe_command (vector vline, struct vty *vty, int *status)
           }
       }
       }
-  vector_free (cmd_vector);
 
   if (vector_slot (matchvec, 0) == NULL)
     {
@@ -1643,12 +1662,57 @@ int cmd_lcd (char **matched)
     return lcd;
 }
 
+/* Completion of variable arguments, such as interface names. */
+struct cmd_completer
+{
+  const char *var;
+  void (*func) (const char *, vector);
+};
+
+static vector cmd_completers;
+
+/* Have FUNC complete arguments VAR, such as IFNAME.  It's given what
+   has been typed so far and adds completions with cmd_complete_add (). */
+void
+install_completion (const char *var, void (*func) (const char *, vector))
+{
+  struct cmd_completer *c;
+
+  if (cmd_completers == NULL)
+    cmd_completers = vector_init (1);
+  c = XCALLOC (MTYPE_TMP, sizeof (struct cmd_completer));
+  c->var = var;
+  c->func = func;
+  vector_set (cmd_completers, c);
+}
+
+void
+cmd_complete_add (vector matchvec, const char *str)
+{
+  if (cmd_unique_string (matchvec, (char *) str))
+    vector_set (matchvec, XSTRDUP (MTYPE_TMP, (char *) str));
+}
+
+/* Add the completions of SRC as an argument VAR to MATCHVEC. */
+static void
+cmd_complete_variable (const char *var, char *src, vector matchvec)
+{
+  struct cmd_completer *c;
+  int i;
+
+  if (cmd_completers == NULL)
+    return;
+  vector_foreach (cmd_completers, i, c)
+    if (strcmp (c->var, var) == 0)
+      (*c->func) (src ? src : "", matchvec);
+}
+
 /* Command line completion support. */
 char **
 cmd_complete_command (vector vline, struct vty *vty, int *status)
 {
   int i;
-  vector cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
+  vector cmd_vector = vector_copy_arena (&vty->arena, cmd_node_vector (cmdvec, vty->node));
 #define INIT_MATCHVEC_SIZE 10
   vector matchvec;
   struct cmd_element *cmd_element;
@@ -1675,14 +1739,12 @@ cmd_complete_command (vector vline, struct vty *vty, int *status)
      ambiguousness. */
       if ((ret = is_cmd_ambiguous (command, cmd_vector, i, match)) == 1)
     {
-      vector_free (cmd_vector);
       *status = CMD_ERR_AMBIGUOUS;
       return NULL;
     }
       /*
     else if (ret == 2)
     {
-      vector_free (cmd_vector);
       *status = CMD_ERR_NO_MATCH;
       return NULL;
     }
@@ -1693,15 +1755,14 @@ cmd_complete_command (vector vline, struct vty *vty, int *status)
   matchvec = vector_init (INIT_MATCHVEC_SIZE);
 
   /* Now we got into completion */
-  for (i = 0; i < vector_max (cmd_vector); i++)
-    if ((cmd_element = vector_slot (cmd_vector, i)) != NULL)
+  vector_foreach (cmd_vector, i, cmd_element)
       {
     char *string;
     vector strvec = cmd_element->strvec;
     
     /* Check field length */
     if (index >= vector_max (strvec))
-      vector_slot (cmd_vector, i) = NULL;
+      vector_unset (cmd_vector, i);
     else 
       {
         int j;
@@ -1713,14 +1774,18 @@ cmd_complete_command (vector vline, struct vty *vty, int *status)
 
         if ((string = cmd_entry_function (vector_slot (vline, index),
                           desc->cmd)))
-          if (cmd_unique_string (matchvec, string))
-            vector_set (matchvec, XSTRDUP (MTYPE_TMP, string));
+          {
+            if (cmd_unique_string (matchvec, string))
+              vector_set (matchvec, XSTRDUP (MTYPE_TMP, string));
+          }
+        else if (CMD_VARIABLE (desc->cmd))
+          cmd_complete_variable (desc->cmd, vector_slot (vline, index),
+                                 matchvec);
           }
       }
       }
 
   /* We don't need cmd_vector any more. */
-  vector_free (cmd_vector);
 
   /* No matched command */
   if (vector_slot (matchvec, 0) == NULL)
@@ -1797,6 +1862,7 @@ int
 cmd_execute_command (vector vline, struct vty *vty, struct cmd_element **cmd)
 {
   int i;
+  int ret;
   int index;
   vector cmd_vector;
   struct cmd_element *cmd_element;
@@ -1809,7 +1875,7 @@ cmd_execute_command (vector vline, struct vty *vty, struct cmd_element **cmd)
   char *command;
 
   /* Make copy of command elements. */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
+  cmd_vector = vector_copy_arena (&vty->arena, cmd_node_vector (cmdvec, vty->node));
 
   for (index = 0; index < vector_max (vline); index++) 
     {
@@ -1826,12 +1892,10 @@ cmd_execute_command (vector vline, struct vty *vty, struct cmd_element **cmd)
 
       if (ret == 1)
     {
-      vector_free (cmd_vector);
       return CMD_ERR_AMBIGUOUS;
     }
       else if (ret == 2)
     {
-      vector_free (cmd_vector);
       return CMD_ERR_NO_MATCH;
     }
     }
@@ -1860,8 +1924,6 @@ cmd_execute_command (vector vline, struct vty *vty, struct cmd_element **cmd)
       }
       }
   
-  /* Finish of using cmd_vector. */
-  vector_free (cmd_vector);
 
   /* To execute command, matched_count must be 1.*/
   if (matched_count == 0) 
@@ -1913,8 +1975,20 @@ cmd_execute_command (vector vline, struct vty *vty, struct cmd_element **cmd)
   if (matched_element->daemon)
     return CMD_SUCCESS_DAEMON;
 
+  /* Read-only commands may run on the worker pool. */
+  if (matched_element->attr & CMD_ATTR_READONLY)
+    {
+      if (worker_execute (matched_element, vty, argc, argv) == 0)
+        return CMD_QUEUED;
+      return (*matched_element->func) (matched_element, vty, argc, argv);
+    }
+
   /* Execute matched command. */
-  return (*matched_element->func) (matched_element, vty, argc, argv);
+  worker_state_lock ();
+  ret = (*matched_element->func) (matched_element, vty, argc, argv);
+  worker_state_unlock ();
+
+  return ret;
 }
 
 /* Execute command by argument readline. */
@@ -1923,6 +1997,7 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
                 struct cmd_element **cmd)
 {
   int i;
+  int ret;
   int index;
   vector cmd_vector;
   struct cmd_element *cmd_element;
@@ -1935,7 +2010,7 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
   char *command;
 
   /* Make copy of command element */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
+  cmd_vector = vector_copy_arena (&vty->arena, cmd_node_vector (cmdvec, vty->node));
 
   for (index = 0; index < vector_max (vline); index++) 
     {
@@ -1953,12 +2028,10 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
       ret = is_cmd_ambiguous (command, cmd_vector, index, match);
       if (ret == 1)
     {
-      vector_free (cmd_vector);
       return CMD_ERR_AMBIGUOUS;
     }
       if (ret == 2)
     {
-      vector_free (cmd_vector);
       return CMD_ERR_NO_MATCH;
     }
     }
@@ -1981,8 +2054,6 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
       incomplete_count++;
       }
   
-  /* Finish of using cmd_vector. */
-  vector_free (cmd_vector);
 
   /* To execute command, matched_count must be 1.*/
   if (matched_count == 0) 
@@ -2034,8 +2105,16 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
   if (matched_element->daemon)
     return CMD_SUCCESS_DAEMON;
 
+  /* Read-only commands take the state lock themselves. */
+  if (matched_element->attr & CMD_ATTR_READONLY)
+    return (*matched_element->func) (matched_element, vty, argc, argv);
+
   /* Now execute matched command */
-  return (*matched_element->func) (matched_element, vty, argc, argv);
+  worker_state_lock ();
+  ret = (*matched_element->func) (matched_element, vty, argc, argv);
+  worker_state_unlock ();
+
+  return ret;
 }
 
 /* Configration make from file. */
@@ -2047,7 +2126,10 @@ config_from_file (struct vty *vty, FILE *fp)
 
   while (fgets (vty->buf, VTY_BUFSIZ, fp))
     {
-      vline = cmd_make_strvec (vty->buf);
+      /* Each line starts with an empty arena. */
+      arena_reset (&vty->arena);
+
+      vline = cmd_make_strvec_arena (&vty->arena, vty->buf);
 
       /* In case of comment line */
       if (vline == NULL)
@@ -2063,8 +2145,6 @@ config_from_file (struct vty *vty, FILE *fp)
         ret = cmd_execute_command_strict (vline, vty, NULL);
     }     
 
-      cmd_free_strvec (vline);
-
       if (ret != CMD_SUCCESS && ret != CMD_WARNING)
     return ret;
     }
@@ -2174,16 +2254,41 @@ DEFUN (config_end,
 }
 
 /* Show version. */
-DEFUN (show_version,
+static void
+show_version_vty (struct vty *vty)
+{
+  vty_object_begin (vty, NULL);
+  vty_field_label (vty, 0, "mini switch ");
+  vty_field_str (vty, "version", 0, MINISWTICH_VERSION);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 0, "Copyright ");
+  vty_field_str (vty, "copyright", 0, "1986-2020, xxx.");
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_object_end (vty);
+}
+
+DEFUN_ATTR (show_version,
        show_version_cmd,
        "show version",
        SHOW_STR
-       "Displays switch version\n")
+       "Displays switch version\n",
+       CMD_ATTR_READONLY)
 {
-  vty_out (vty, "mini switch %s %s", MINISWTICH_VERSION,
-       VTY_NEWLINE);
-  vty_out (vty, "Copyright 1986-2020, xxx.%s", VTY_NEWLINE);
+  show_version_vty (vty);
+  return CMD_SUCCESS;
+}
 
+DEFUN_ATTR (show_version_json,
+       show_version_json_cmd,
+       "show version json",
+       SHOW_STR
+       "Displays switch version\n"
+       "JavaScript Object Notation\n",
+       CMD_ATTR_READONLY)
+{
+  vty->json = 1;
+  show_version_vty (vty);
+  vty->json = 0;
   return CMD_SUCCESS;
 }
 
@@ -3050,6 +3155,7 @@ void cmd_init (int terminal)
 
     /* Each node's basic commands. */
     install_element (VIEW_NODE, &show_version_cmd);
+    install_element (VIEW_NODE, &show_version_json_cmd);
     if (terminal)
     {
         install_element (VIEW_NODE, &config_list_cmd);
@@ -3070,6 +3176,7 @@ void cmd_init (int terminal)
     }
     install_element (ENABLE_NODE, &show_startup_config_cmd);
     install_element (ENABLE_NODE, &show_version_cmd);
+    install_element (ENABLE_NODE, &show_version_json_cmd);
     install_element (ENABLE_NODE, &config_terminal_length_cmd);
     install_element (ENABLE_NODE, &config_terminal_no_length_cmd);
 
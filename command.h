@@ -107,8 +107,13 @@ struct cmd_element
   int cmdsize;			/* Command index count. */
   char *config;			/* Configuration string */
   vector subconfig;		/* Sub configuration string */
+  u_char attr;			/* Command attributes */
 };
 
+/* Command attributes. */
+#define CMD_ATTR_READONLY  0x01	/* Doesn't change state, may run on
+				   the worker pool. */
+
 /* Command description structure. */
 struct desc
 {
@@ -128,6 +133,7 @@ struct desc
 #define CMD_COMPLETE_MATCH       8
 #define CMD_COMPLETE_LIST_MATCH  9
 #define CMD_SUCCESS_DAEMON      10
+#define CMD_QUEUED              11
 
 /* Argc max counts. */
 #define CMD_ARGC_MAX   25
@@ -147,6 +153,24 @@ struct desc
   int funcname \
   (struct cmd_element *self, struct vty *vty, int argc, char **argv)
 
+/* DEFUN with command attributes. */
+#define DEFUN_ATTR(funcname, cmdname, cmdstr, helpstr, attrs) \
+  int funcname (struct cmd_element *, struct vty *, int, char **); \
+  struct cmd_element cmdname = \
+  { \
+    cmdstr, \
+    funcname, \
+    helpstr, \
+    0, \
+    NULL, \
+    0, \
+    NULL, \
+    NULL, \
+    attrs \
+  }; \
+  int funcname \
+  (struct cmd_element *self, struct vty *vty, int argc, char **argv)
+
 /* DEFUN_NOSH for commands that vtysh should ignore */
 #define DEFUN_NOSH(funcname, cmdname, cmdstr, helpstr) \
   DEFUN(funcname, cmdname, cmdstr, helpstr)
@@ -183,6 +207,20 @@ struct desc
     helpstr \
   };
 
+#define ALIAS_ATTR(funcname, cmdname, cmdstr, helpstr, attrs) \
+  struct cmd_element cmdname = \
+  { \
+    cmdstr, \
+    funcname, \
+    helpstr, \
+    0, \
+    NULL, \
+    0, \
+    NULL, \
+    NULL, \
+    attrs \
+  };
+
 #endif /* VTYSH_EXTRACT_PL */
 
 /* Some macroes */
@@ -245,10 +283,13 @@ struct desc
 void install_node (struct cmd_node *, int (*) (struct vty *));
 void install_default (enum node_type);
 void install_element (enum node_type, struct cmd_element *);
+void install_completion (const char *, void (*) (const char *, vector));
+void cmd_complete_add (vector, const char *);
 void sort_node ();
 
-char *argv_concat (char **, int, int);
+char *argv_concat (struct vty *, char **, int, int);
 vector cmd_make_strvec (char *);
+vector cmd_make_strvec_arena (struct arena *, char *);
 void cmd_free_strvec (vector);
 vector cmd_describe_command ();
 char **cmd_complete_command ();
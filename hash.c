@@ -0,0 +1,404 @@
+/* Hash table with open addressing.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
+#include "memory.h"
+#include "hash.h"
+
+/* Lookups probe slot after slot from the key's home slot, a group of
+   control bytes at a time, and end at the first empty slot.  Removal
+   moves the following slots of the run back instead of leaving a
+   tombstone, so runs never get longer than the entries in them.
+
+   A full table grows into one of twice the size, and its entries are
+   moved over a few at a time with each change, so no single call pays
+   for the whole table. */
+
+#define HASH_EMPTY 0x80
+
+/* Control byte of KEY, its top 7 bits; the home slot uses the low
+   bits. */
+#define HASH_CTRL(key) ((unsigned char) ((key) >> 25))
+
+/* Mix the bits of a user's key, which may be weak, into all of KEY. */
+static unsigned int
+hash_mix (unsigned int key)
+{
+  key ^= key >> 16;
+  key *= 0x85ebca6bU;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35U;
+  key ^= key >> 16;
+  return key;
+}
+
+/* Bit per slot of the group at CTRL whose control byte is C. */
+static unsigned int
+hash_group_match (const unsigned char *ctrl, unsigned char c)
+{
+#ifdef __SSE2__
+  __m128i group = _mm_loadu_si128 ((const __m128i *) ctrl);
+
+  return _mm_movemask_epi8 (_mm_cmpeq_epi8 (group, _mm_set1_epi8 (c)));
+#else
+  unsigned int mask = 0;
+  int i;
+
+  for (i = 0; i < HASH_GROUP; i++)
+    if (ctrl[i] == c)
+      mask |= 1U << i;
+  return mask;
+#endif /* __SSE2__ */
+}
+
+/* Bit per empty slot of the group at CTRL. */
+static unsigned int
+hash_group_empty (const unsigned char *ctrl)
+{
+#ifdef __SSE2__
+  /* Only HASH_EMPTY has the top bit set. */
+  return _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *) ctrl));
+#else
+  return hash_group_match (ctrl, HASH_EMPTY);
+#endif /* __SSE2__ */
+}
+
+static void
+hash_table_init (struct hash_table *t, unsigned int size)
+{
+  t->size = size;
+  t->count = 0;
+  t->ctrl = XMALLOC (MTYPE_HASH_INDEX, size + HASH_GROUP - 1);
+  memset (t->ctrl, HASH_EMPTY, size + HASH_GROUP - 1);
+  t->slots = XCALLOC (MTYPE_HASH_INDEX, sizeof (struct hash_slot) * size);
+}
+
+static void
+hash_table_fini (struct hash_table *t)
+{
+  if (t->size)
+    {
+      XFREE (MTYPE_HASH_INDEX, t->ctrl);
+      XFREE (MTYPE_HASH_INDEX, t->slots);
+    }
+  memset (t, 0, sizeof (struct hash_table));
+}
+
+static void
+hash_ctrl_set (struct hash_table *t, unsigned int i, unsigned char c)
+{
+  t->ctrl[i] = c;
+  if (i < HASH_GROUP - 1)
+    t->ctrl[t->size + i] = c;
+}
+
+/* Where probing for KEY starts in table T.  Old slots before the
+   migration point are empty now, what's left of their runs starts
+   there. */
+static unsigned int
+hash_home (struct hash *hash, struct hash_table *t, unsigned int key)
+{
+  unsigned int mask = t->size - 1;
+  unsigned int home = key & mask;
+
+  if (t == &hash->old
+      && ((home - hash->migrate_start) & mask) < hash->migrated)
+    home = (hash->migrate_start + hash->migrated) & mask;
+  return home;
+}
+
+/* Slot of DATA with KEY in table T, or -1. */
+static int
+hash_table_find (struct hash *hash, struct hash_table *t, void *data,
+                 unsigned int key)
+{
+  unsigned int mask = t->size - 1;
+  unsigned int pos, probed, match, i;
+  unsigned char c = HASH_CTRL (key);
+
+  if (t->count == 0)
+    return -1;
+
+  pos = hash_home (hash, t, key);
+  for (probed = 0; probed < t->size; probed += HASH_GROUP)
+    {
+      for (match = hash_group_match (t->ctrl + pos, c); match;
+           match &= match - 1)
+        {
+          i = (pos + __builtin_ctz (match)) & mask;
+          if (t->slots[i].key == key
+              && (*hash->hash_cmp) (t->slots[i].data, data))
+            return i;
+        }
+      if (hash_group_empty (t->ctrl + pos))
+        break;
+      pos = (pos + HASH_GROUP) & mask;
+    }
+  return -1;
+}
+
+/* Put DATA with KEY into the first empty slot from its home on. */
+static void
+hash_table_insert (struct hash_table *t, void *data, unsigned int key)
+{
+  unsigned int mask = t->size - 1;
+  unsigned int pos = key & mask;
+  unsigned int empty, i;
+
+  while ((empty = hash_group_empty (t->ctrl + pos)) == 0)
+    pos = (pos + HASH_GROUP) & mask;
+
+  i = (pos + __builtin_ctz (empty)) & mask;
+  hash_ctrl_set (t, i, HASH_CTRL (key));
+  t->slots[i].data = data;
+  t->slots[i].key = key;
+  t->count++;
+}
+
+/* Empty slot I of table T.  Entries after it in the run whose home
+   isn't between I and their slot move back, so every entry stays
+   reachable from its home without passing an empty slot. */
+static void
+hash_table_remove (struct hash *hash, struct hash_table *t, unsigned int i)
+{
+  unsigned int mask = t->size - 1;
+  unsigned int j, home;
+
+  for (j = (i + 1) & mask; t->ctrl[j] != HASH_EMPTY; j = (j + 1) & mask)
+    {
+      home = hash_home (hash, t, t->slots[j].key);
+      if (((j - home) & mask) >= ((j - i) & mask))
+        {
+          hash_ctrl_set (t, i, t->ctrl[j]);
+          t->slots[i] = t->slots[j];
+          i = j;
+        }
+    }
+
+  hash_ctrl_set (t, i, HASH_EMPTY);
+  t->slots[i].data = NULL;
+  t->count--;
+}
+
+/* Move up to COUNT slots of the old table over. */
+static void
+hash_migrate (struct hash *hash, unsigned int count)
+{
+  struct hash_table *old = &hash->old;
+  unsigned int i;
+
+  while (old->size && count--)
+    {
+      i = (hash->migrate_start + hash->migrated) & (old->size - 1);
+      if (old->ctrl[i] != HASH_EMPTY)
+        {
+          hash_table_insert (&hash->table, old->slots[i].data,
+                             old->slots[i].key);
+          hash_ctrl_set (old, i, HASH_EMPTY);
+          old->count--;
+        }
+      if (++hash->migrated == old->size)
+        hash_table_fini (old);
+    }
+}
+
+/* Make room for one more entry, the table is kept at most 7/8 full. */
+static void
+hash_grow (struct hash *hash)
+{
+  struct hash_table *t = &hash->table;
+  unsigned int i;
+
+  if (t->size == 0)
+    {
+      hash_table_init (t, HASH_MIN_SIZE);
+      return;
+    }
+  if (hash_count (hash) + 1 <= t->size - t->size / 8)
+    return;
+
+  /* Still moving the previous table, finish that first. */
+  hash_migrate (hash, hash->old.size);
+
+  hash->old = *t;
+  hash_table_init (t, hash->old.size * 2);
+
+  /* Start moving after an empty slot, no run crosses it. */
+  for (i = 0; hash->old.ctrl[i] != HASH_EMPTY; i++)
+    ;
+  hash->migrate_start = i + 1;
+  hash->migrated = 0;
+}
+
+struct hash *
+hash_create_size (unsigned int size, unsigned int (*hash_key) (void *),
+                  int (*hash_cmp) (void *, void *))
+{
+  struct hash *hash;
+  unsigned int n;
+
+  hash = XCALLOC (MTYPE_HASH, sizeof (struct hash));
+  hash->hash_key = hash_key;
+  hash->hash_cmp = hash_cmp;
+
+  /* Room for SIZE entries without growing. */
+  if (size)
+    {
+      for (n = HASH_MIN_SIZE; n - n / 8 < size; n *= 2)
+        ;
+      hash_table_init (&hash->table, n);
+    }
+  return hash;
+}
+
+struct hash *
+hash_create (unsigned int (*hash_key) (void *),
+             int (*hash_cmp) (void *, void *))
+{
+  return hash_create_size (0, hash_key, hash_cmp);
+}
+
+/* Allocator for hash_get () which stores DATA itself. */
+void *
+hash_alloc_intern (void *data)
+{
+  return data;
+}
+
+/* Entry equal to DATA.  If there is none and ALLOC_FUNC is given, the
+   entry it makes of DATA is added. */
+void *
+hash_get (struct hash *hash, void *data, void * (*alloc_func) (void *))
+{
+  unsigned int key = hash_mix ((*hash->hash_key) (data));
+  void *new;
+  int i;
+
+  if ((i = hash_table_find (hash, &hash->table, data, key)) >= 0)
+    return hash->table.slots[i].data;
+  if ((i = hash_table_find (hash, &hash->old, data, key)) >= 0)
+    return hash->old.slots[i].data;
+
+  if (alloc_func == NULL || (new = (*alloc_func) (data)) == NULL)
+    return NULL;
+
+  hash_grow (hash);
+  hash_table_insert (&hash->table, new, key);
+  hash_migrate (hash, HASH_MIGRATE_STEP);
+  return new;
+}
+
+void *
+hash_lookup (struct hash *hash, void *data)
+{
+  return hash_get (hash, data, NULL);
+}
+
+/* Take the entry equal to DATA out and return it. */
+void *
+hash_release (struct hash *hash, void *data)
+{
+  unsigned int key = hash_mix ((*hash->hash_key) (data));
+  struct hash_table *t = &hash->table;
+  void *ret;
+  int i;
+
+  if ((i = hash_table_find (hash, t, data, key)) < 0)
+    {
+      t = &hash->old;
+      if ((i = hash_table_find (hash, t, data, key)) < 0)
+        return NULL;
+    }
+
+  ret = t->slots[i].data;
+  hash_table_remove (hash, t, i);
+  hash_migrate (hash, HASH_MIGRATE_STEP);
+  return ret;
+}
+
+static void
+hash_table_iterate (struct hash_table *t, void (*func) (void *, void *),
+                    void *arg)
+{
+  unsigned int i;
+
+  for (i = 0; i < t->size; i++)
+    if (t->ctrl[i] != HASH_EMPTY)
+      (*func) (t->slots[i].data, arg);
+}
+
+/* Call FUNC with each entry and ARG.  FUNC must not change the
+   table. */
+void
+hash_iterate (struct hash *hash, void (*func) (void *, void *), void *arg)
+{
+  hash_table_iterate (&hash->old, func, arg);
+  hash_table_iterate (&hash->table, func, arg);
+}
+
+static void
+hash_free_data (void *data, void *free_func)
+{
+  (*(void (*) (void *)) free_func) (data);
+}
+
+/* Remove all entries, giving each to FREE_FUNC when it's set. */
+void
+hash_clean (struct hash *hash, void (*free_func) (void *))
+{
+  struct hash_table *t = &hash->table;
+  unsigned int i;
+
+  if (free_func)
+    hash_iterate (hash, hash_free_data, (void *) free_func);
+
+  hash_table_fini (&hash->old);
+  if (t->size)
+    {
+      memset (t->ctrl, HASH_EMPTY, t->size + HASH_GROUP - 1);
+      for (i = 0; i < t->size; i++)
+        t->slots[i].data = NULL;
+      t->count = 0;
+    }
+}
+
+void
+hash_free (struct hash *hash)
+{
+  hash_table_fini (&hash->old);
+  hash_table_fini (&hash->table);
+  XFREE (MTYPE_HASH, hash);
+}
+
+/* Key of a string, for hash_key functions. */
+unsigned int
+hash_string (const char *str)
+{
+  unsigned int h = 2166136261U;
+
+  while (*str)
+    h = (h ^ (unsigned char) *str++) * 16777619U;
+  return h;
+}
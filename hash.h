@@ -0,0 +1,81 @@
+/* Hash table with open addressing.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_HASH_H
+#define _ZEBRA_HASH_H
+
+/* Slots whose control bytes are looked at together. */
+#define HASH_GROUP 16
+
+/* Smallest table, a power of two of at least HASH_GROUP slots. */
+#define HASH_MIN_SIZE 16
+
+/* Slots of the old table moved per change while the table grows. */
+#define HASH_MIGRATE_STEP 64
+
+struct hash_slot
+{
+  void *data;
+  unsigned int key;
+};
+
+/* A table of SIZE slots.  Each slot has a control byte, which is
+   HASH_EMPTY or 7 bits of the slot's key.  The first group of control
+   bytes is repeated past the end, so a group can be loaded from any
+   slot. */
+struct hash_table
+{
+  unsigned int size;
+  unsigned int count;
+  unsigned char *ctrl;
+  struct hash_slot *slots;
+};
+
+struct hash
+{
+  struct hash_table table;
+
+  /* While growing, the previous table.  Its slots are moved over
+     from the one after MIGRATE_START on, MIGRATED of them are done. */
+  struct hash_table old;
+  unsigned int migrate_start;
+  unsigned int migrated;
+
+  /* Key of data, and whether two data are equal. */
+  unsigned int (*hash_key) (void *);
+  int (*hash_cmp) (void *, void *);
+};
+
+#define hash_count(H) ((H)->table.count + (H)->old.count)
+
+/* Prototypes. */
+struct hash *hash_create (unsigned int (*) (void *), int (*) (void *, void *));
+struct hash *hash_create_size (unsigned int, unsigned int (*) (void *),
+                               int (*) (void *, void *));
+void *hash_get (struct hash *, void *, void * (*) (void *));
+void *hash_alloc_intern (void *);
+void *hash_lookup (struct hash *, void *);
+void *hash_release (struct hash *, void *);
+void hash_iterate (struct hash *, void (*) (void *, void *), void *);
+void hash_clean (struct hash *, void (*) (void *));
+void hash_free (struct hash *);
+unsigned int hash_string (const char *);
+
+#endif /* _ZEBRA_HASH_H */
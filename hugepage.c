@@ -0,0 +1,320 @@
+/* Hugepage-backed arenas for large state tables.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "vty.h"
+#include "hugepage.h"
+
+#define HUGE_ARENA_PAGES  (HUGE_ARENA_SPAN >> HUGE_PAGE_SHIFT)
+
+/* Page tag of the first page of a multi-page block. */
+#define HUGE_RUN          0xff
+
+/* A free multi-page block, kept at its start. */
+struct huge_run
+{
+  struct huge_run *next;
+};
+
+/* An arena is a span of address space which is backed by hugepages
+   from its start as it's used.  A page holds blocks of one power of
+   two size, or is part of a block of whole pages. */
+struct huge_arena
+{
+  pthread_mutex_t mtx;
+  const char *name;
+  char *base;
+
+  /* Pages handed out and pages mapped, from the start of the span. */
+  unsigned int brk;
+  unsigned int mapped;
+  unsigned int hugetlb;
+
+  /* Block size of each page as a shift, or HUGE_RUN.  RUN is the
+     length of a multi-page block at its first page. */
+  unsigned char shift[HUGE_ARENA_PAGES];
+  unsigned int run[HUGE_ARENA_PAGES];
+
+  /* Free blocks by size. */
+  void *free[HUGE_PAGE_SHIFT];
+  struct huge_run *runs;
+
+  unsigned long inuse;
+};
+
+static struct huge_arena huge_arenas[HUGE_ARENA_MAX] =
+{
+  [HUGE_ARENA_IF]    = { PTHREAD_MUTEX_INITIALIZER, "interface" },
+  [HUGE_ARENA_TABLE] = { PTHREAD_MUTEX_INITIALIZER, "table" },
+  [HUGE_ARENA_ROUTE] = { PTHREAD_MUTEX_INITIALIZER, "route" },
+};
+
+/* The region the arenas' spans are laid out in. */
+char *huge_base;
+
+static pthread_once_t huge_once = PTHREAD_ONCE_INIT;
+static int huge_disabled;
+
+static void
+huge_init_once (void)
+{
+  char *p;
+  unsigned long skew;
+  int i;
+
+  /* Reserve address space only, pages are mapped as they are used. */
+  p = mmap (NULL, HUGE_REGION_SIZE + HUGE_PAGE_SIZE, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED)
+    {
+      huge_disabled = 1;
+      return;
+    }
+
+  skew = (unsigned long) p & (HUGE_PAGE_SIZE - 1);
+  if (skew)
+    {
+      munmap (p, HUGE_PAGE_SIZE - skew);
+      p += HUGE_PAGE_SIZE - skew;
+      munmap (p + HUGE_REGION_SIZE, skew);
+    }
+  else
+    munmap (p + HUGE_REGION_SIZE, HUGE_PAGE_SIZE);
+
+  for (i = 1; i < HUGE_ARENA_MAX; i++)
+    huge_arenas[i].base = p + (i - 1) * HUGE_ARENA_SPAN;
+
+  __atomic_store_n (&huge_base, p, __ATOMIC_RELEASE);
+}
+
+static int
+huge_init (void)
+{
+  pthread_once (&huge_once, huge_init_once);
+  return huge_disabled ? -1 : 0;
+}
+
+/* Back page PAGE of ARENA.  A page from the hugetlb pool is tried
+   first, otherwise ordinary memory is asked to be backed by a
+   transparent hugepage. */
+static int
+huge_map (struct huge_arena *arena, unsigned int page)
+{
+  char *addr = arena->base + ((unsigned long) page << HUGE_PAGE_SHIFT);
+  char *p;
+
+  p = mmap (addr, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED)
+    {
+      arena->hugetlb++;
+      return 0;
+    }
+
+  p = mmap (addr, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED)
+    return -1;
+#ifdef MADV_HUGEPAGE
+  madvise (p, HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+  return 0;
+}
+
+/* Take COUNT fresh pages, with the arena's lock held. */
+static char *
+huge_pages_get (struct huge_arena *arena, unsigned int count)
+{
+  unsigned int page = arena->brk;
+
+  if (count > HUGE_ARENA_PAGES - page)
+    return NULL;
+
+  while (arena->mapped < page + count)
+    {
+      if (huge_map (arena, arena->mapped) < 0)
+        return NULL;
+      arena->mapped++;
+    }
+  arena->brk += count;
+
+  return arena->base + ((unsigned long) page << HUGE_PAGE_SHIFT);
+}
+
+static unsigned int
+huge_page_of (struct huge_arena *arena, void *p)
+{
+  return ((char *) p - arena->base) >> HUGE_PAGE_SHIFT;
+}
+
+/* Take a block of 1 << SHIFT bytes.  A new page is cut up into blocks
+   right away, it's backed as a whole anyway. */
+static void *
+huge_block_get (struct huge_arena *arena, int shift)
+{
+  char *page;
+  char *p;
+  void *block;
+
+  if (arena->free[shift] == NULL)
+    {
+      page = huge_pages_get (arena, 1);
+      if (page == NULL)
+        return NULL;
+      arena->shift[huge_page_of (arena, page)] = shift;
+
+      for (p = page + HUGE_PAGE_SIZE - (1UL << shift); p >= page;
+           p -= 1UL << shift)
+        {
+          *(void **) p = arena->free[shift];
+          arena->free[shift] = p;
+        }
+    }
+
+  block = arena->free[shift];
+  arena->free[shift] = *(void **) block;
+  return block;
+}
+
+/* Take a block of COUNT whole pages.  Freed blocks are reused when
+   they are large enough, they aren't split. */
+static void *
+huge_run_get (struct huge_arena *arena, unsigned int count)
+{
+  struct huge_run **rp;
+  struct huge_run *r;
+  char *p;
+
+  for (rp = &arena->runs; (r = *rp) != NULL; rp = &r->next)
+    if (arena->run[huge_page_of (arena, r)] >= count)
+      {
+        *rp = r->next;
+        return r;
+      }
+
+  p = huge_pages_get (arena, count);
+  if (p == NULL)
+    return NULL;
+  arena->shift[huge_page_of (arena, p)] = HUGE_RUN;
+  arena->run[huge_page_of (arena, p)] = count;
+  return p;
+}
+
+/* Allocate SIZE bytes from hugepage arena INDEX.  Returns NULL when
+   the arena is full or can't be backed, the caller falls back to
+   malloc. */
+void *
+huge_alloc (int index, size_t size)
+{
+  struct huge_arena *arena = &huge_arenas[index];
+  void *p;
+  int shift;
+
+  if (size < (1UL << HUGE_OBJECT_SHIFT))
+    return NULL;
+  if (huge_base == NULL && huge_init () < 0)
+    return NULL;
+
+  pthread_mutex_lock (&arena->mtx);
+  if (size <= HUGE_PAGE_SIZE / 2)
+    {
+      for (shift = HUGE_OBJECT_SHIFT; (1UL << shift) < size; shift++)
+        ;
+      p = huge_block_get (arena, shift);
+    }
+  else
+    p = huge_run_get (arena, (size + HUGE_PAGE_SIZE - 1) >> HUGE_PAGE_SHIFT);
+  if (p)
+    arena->inuse += huge_size (p);
+  pthread_mutex_unlock (&arena->mtx);
+
+  return p;
+}
+
+static struct huge_arena *
+huge_arena_of (void *p)
+{
+  return &huge_arenas[1 + ((char *) p - huge_base) / HUGE_ARENA_SPAN];
+}
+
+/* Free block P, which must be owned by an arena. */
+void
+huge_free (void *p)
+{
+  struct huge_arena *arena = huge_arena_of (p);
+  int shift;
+
+  pthread_mutex_lock (&arena->mtx);
+  arena->inuse -= huge_size (p);
+  shift = arena->shift[huge_page_of (arena, p)];
+  if (shift == HUGE_RUN)
+    {
+      ((struct huge_run *) p)->next = arena->runs;
+      arena->runs = p;
+    }
+  else
+    {
+      *(void **) p = arena->free[shift];
+      arena->free[shift] = p;
+    }
+  pthread_mutex_unlock (&arena->mtx);
+}
+
+/* Usable size of block P. */
+size_t
+huge_size (void *p)
+{
+  struct huge_arena *arena = huge_arena_of (p);
+  unsigned int page = huge_page_of (arena, p);
+
+  if (arena->shift[page] == HUGE_RUN)
+    return (size_t) arena->run[page] << HUGE_PAGE_SHIFT;
+  return 1UL << arena->shift[page];
+}
+
+void
+huge_show (struct vty *vty)
+{
+  struct huge_arena *arena;
+  unsigned int brk, mapped, hugetlb;
+  unsigned long inuse;
+  int i;
+
+  vty_out (vty, "%-10s %6s %6s %8s %12s%s", "Arena", "Pages", "Mapped",
+           "Hugetlb", "In use", VTY_NEWLINE);
+  for (i = 1; i < HUGE_ARENA_MAX; i++)
+    {
+      arena = &huge_arenas[i];
+
+      pthread_mutex_lock (&arena->mtx);
+      brk = arena->brk;
+      mapped = arena->mapped;
+      hugetlb = arena->hugetlb;
+      inuse = arena->inuse;
+      pthread_mutex_unlock (&arena->mtx);
+
+      vty_out (vty, "%-10s %6u %6u %8u %12lu%s", arena->name, brk, mapped,
+               hugetlb, inuse, VTY_NEWLINE);
+    }
+}
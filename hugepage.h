@@ -0,0 +1,58 @@
+/* Hugepage-backed arenas for large state tables.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_HUGEPAGE_H
+#define _ZEBRA_HUGEPAGE_H
+
+/* Size of a hugepage, arenas are mapped in these. */
+#define HUGE_PAGE_SHIFT    21
+#define HUGE_PAGE_SIZE     (1UL << HUGE_PAGE_SHIFT)
+
+/* Address space reserved for each arena. */
+#define HUGE_ARENA_SPAN    (256UL << 20)
+
+/* Smallest block handed out, a page.  Smaller objects such as table
+   headers aren't worth a share of a hugepage and come from malloc. */
+#define HUGE_OBJECT_SHIFT  12
+
+/* Arenas.  Memory types are assigned to one in memory.c. */
+#define HUGE_ARENA_IF      1
+#define HUGE_ARENA_TABLE   2
+#define HUGE_ARENA_ROUTE   3
+#define HUGE_ARENA_MAX     4
+
+#define HUGE_REGION_SIZE   ((HUGE_ARENA_MAX - 1) * HUGE_ARENA_SPAN)
+
+struct vty;
+
+/* Prototypes. */
+void *huge_alloc (int, size_t);
+void huge_free (void *);
+size_t huge_size (void *);
+void huge_show (struct vty *);
+
+extern char *huge_base;
+
+/* Is P a block of a hugepage arena? */
+#define HUGE_OWNS(p) \
+  (huge_base \
+   && (unsigned long) ((char *) (p) - huge_base) < HUGE_REGION_SIZE)
+
+#endif /* _ZEBRA_HUGEPAGE_H */
@@ -28,77 +28,1238 @@
 #include <sys/stat.h>
 #include "command.h"
 #include "memory.h"
+#include "log.h"
 #include "vtysh.h"
+#include "worker.h"
+#include "intern.h"
+#include "hash.h"
+#include "radix.h"
+#include "skiplist.h"
+#include "if.h"
+#include "ifstat.h"
+#include "ifshm.h"
+#include "ifevent.h"
+#include "ifnetlink.h"
 
-#define MAX_ETH_PORT 12
+struct if_table iftable;
 
-struct 
+/* Largest ifindex given out.  Those of removed ports aren't given out
+   again, so that a vty still configuring one can tell. */
+static unsigned int if_ifindex_last;
+
+static unsigned int if_index_key(void *data)
 {
-    int unit;
-    int admin_status;
-    int oper_status;
-    char name[64];
-    char desc[64];
-    int mtu;
-    int negotiation;
-    int duplex;
-    int linktype;
-    int speed;
-    int flowctrl;
-    int def_vlan;
-    char vlanlist[512];
-    char tagvlanlist[512];
-}eth_port[MAX_ETH_PORT];
+    return ((struct if_info *)data)->ifindex;
+}
+
+static int if_index_cmp(void *a, void *b)
+{
+    return ((struct if_info *)a)->ifindex == ((struct if_info *)b)->ifindex;
+}
+
+/* Order of interface names, where the numbers in them are compared by
+   value, so that ge1/0/2 comes before ge1/0/10. */
+static int if_name_cmp(void *a, void *b)
+{
+    const char *p = ((struct if_info *)a)->name;
+    const char *q = ((struct if_info *)b)->name;
+    int i, j, c;
+
+    while(*p && *q)
+    {
+        if(isdigit((unsigned char)*p) && isdigit((unsigned char)*q))
+        {
+            for(i = 0; isdigit((unsigned char)p[i]); i++)
+                ;
+            for(j = 0; isdigit((unsigned char)q[j]); j++)
+                ;
+            if(i != j)
+                return i - j;
+            if((c = strncmp(p, q, i)) != 0)
+                return c;
+            p += i;
+            q += j;
+        }
+        else if(*p != *q)
+            break;
+        else
+        {
+            p++;
+            q++;
+        }
+    }
+    return (unsigned char)*p - (unsigned char)*q;
+}
+
+/* Make room for SIZE slots, a multiple of VLAN_WORD_BITS. */
+static void if_table_grow(unsigned int size)
+{
+    unsigned int old = iftable.size;
+    int v;
+
+    iftable.flags = XREALLOC(MTYPE_IF, iftable.flags, size);
+    iftable.mtu = XREALLOC(MTYPE_IF, iftable.mtu, sizeof(unsigned int) * size);
+    iftable.speed = XREALLOC(MTYPE_IF, iftable.speed,
+        sizeof(unsigned int) * size);
+    iftable.def_vlan = XREALLOC(MTYPE_IF, iftable.def_vlan,
+        sizeof(unsigned short) * size);
+    iftable.info = XREALLOC(MTYPE_IF, iftable.info,
+        sizeof(struct if_info *) * size);
+    iftable.gen = XREALLOC(MTYPE_IF, iftable.gen, sizeof(unsigned int) * size);
+    iftable.up_ports = XREALLOC(MTYPE_IF, iftable.up_ports, size / 8);
+
+    memset(iftable.flags + old, 0, size - old);
+    memset(iftable.info + old, 0, sizeof(struct if_info *) * (size - old));
+    memset(iftable.gen + old, 0, sizeof(unsigned int) * (size - old));
+    memset((char *)iftable.up_ports + old / 8, 0, (size - old) / 8);
+
+    /* Port maps have a bit per slot too. */
+    for(v = 0; v < VLAN_BITS; v++)
+        if(iftable.vlan_ports[v])
+        {
+            iftable.vlan_ports[v] = XREALLOC(MTYPE_VLAN,
+                iftable.vlan_ports[v], size / 8);
+            memset((char *)iftable.vlan_ports[v] + old / 8, 0,
+                (size - old) / 8);
+        }
+
+    iftable.size = size;
+}
+
+/* Mark the port in SLOT operationally up or down. */
+void if_set_oper(int slot, int up)
+{
+    unsigned long bit = 1UL << (slot % VLAN_WORD_BITS);
+
+    if(! (iftable.flags[slot] & IF_OPER_UP) != ! up)
+    {
+        ifevent_post(slot, IF_EVENT_LINK);
+        IF_CHANGED(slot);
+    }
+    if(up)
+    {
+        iftable.flags[slot] |= IF_OPER_UP;
+        iftable.up_ports[slot / VLAN_WORD_BITS] |= bit;
+    }
+    else
+    {
+        iftable.flags[slot] &= ~IF_OPER_UP;
+        iftable.up_ports[slot / VLAN_WORD_BITS] &= ~bit;
+    }
+}
+
+/* VLANs the port in SLOT is a member of.  Whatever the link type, the
+   default VLAN is one of them, sent untagged unless it's also in the
+   tagged VLANs. */
+void if_vlan_member(int slot, struct vlan_bitmap *member)
+{
+    struct if_info *info = iftable.info[slot];
+
+    switch(info->linktype)
+    {
+    case IF_LINK_ACCESS:
+        vlan_bitmap_zero(member);
+        break;
+    case IF_LINK_TRUNK:
+        *member = info->tagged;
+        break;
+    default:
+        vlan_bitmap_or(member, &info->tagged, &info->untagged);
+        break;
+    }
+    VLAN_SET(member, iftable.def_vlan[slot]);
+}
+
+/* Move the port in SLOT from the port maps of the VLANs in OLD to those
+   of the VLANs in NEW.  Only the VLANs which differ are touched. */
+static void if_vlan_move(int slot, const struct vlan_bitmap *old,
+    const struct vlan_bitmap *new)
+{
+    struct vlan_bitmap diff;
+    unsigned long bit = 1UL << (slot % VLAN_WORD_BITS);
+    int w = slot / VLAN_WORD_BITS;
+    int v, changed = 0;
+
+    vlan_bitmap_andnot(&diff, old, new);
+    VLAN_LOOP(&diff, v)
+    {
+        iftable.vlan_ports[v][w] &= ~bit;
+        changed = 1;
+    }
+
+    vlan_bitmap_andnot(&diff, new, old);
+    VLAN_LOOP(&diff, v)
+    {
+        if(iftable.vlan_ports[v] == NULL)
+            iftable.vlan_ports[v] = XCALLOC(MTYPE_VLAN, iftable.size / 8);
+        iftable.vlan_ports[v][w] |= bit;
+        changed = 1;
+    }
+
+    if(changed)
+        ifevent_post(slot, IF_EVENT_VLAN);
+}
+
+/* The VLAN configuration of the port in SLOT changed, it was a member
+   of OLD. */
+static void if_vlan_changed(int slot, const struct vlan_bitmap *old)
+{
+    struct vlan_bitmap member;
+
+    IF_CHANGED(slot);
+    if_vlan_member(slot, &member);
+    if_vlan_move(slot, old, &member);
+}
+
+/* Ports a frame of VLAN VID received on slot INGRESS, or -1, is
+   flooded to: the VLAN's member ports which are up, but INGRESS.
+   PORTS gets a bit per slot, iftable.size of them.  Returns how many
+   ports there are. */
+int if_vlan_flood(unsigned short vid, int ingress, unsigned long *ports)
+{
+    unsigned long *members = iftable.vlan_ports[vid];
+    unsigned int words = iftable.size / VLAN_WORD_BITS;
+    unsigned int w;
+    int count = 0;
+
+    if(members == NULL)
+    {
+        memset(ports, 0, words * sizeof(unsigned long));
+        return 0;
+    }
+
+    for(w = 0; w < words; w++)
+    {
+        ports[w] = members[w] & iftable.up_ports[w];
+        count += __builtin_popcountl(ports[w]);
+    }
+    if(ingress >= 0 && (ports[ingress / VLAN_WORD_BITS]
+        & (1UL << (ingress % VLAN_WORD_BITS))))
+    {
+        ports[ingress / VLAN_WORD_BITS] &= ~(1UL << (ingress % VLAN_WORD_BITS));
+        count--;
+    }
+    return count;
+}
+
+/* Add interface IFINDEX called NAME, returns its slot or -1 when the
+   index or name is taken or the name is too long. */
+int if_create(unsigned int ifindex, const char *name)
+{
+    struct if_info *info;
+    struct vlan_bitmap none;
+    int slot;
+
+    if(if_lookup_by_index(ifindex) >= 0 || if_lookup_by_name(name) >= 0
+        || strlen(name) > RADIX_KEY_MAX)
+        return -1;
+
+    for(slot = iftable.hint; slot < (int)iftable.max; slot++)
+        if(! (iftable.flags[slot] & IF_USED))
+            break;
+    if(slot >= IFSTAT_SLOTS_MAX)
+        return -1;
+    if(slot >= (int)iftable.size)
+        if_table_grow(iftable.size ? iftable.size * 2 : 64);
+    if(slot >= (int)iftable.max)
+        iftable.max = slot + 1;
+    iftable.hint = slot + 1;
+
+    info = XCALLOC(MTYPE_IF, sizeof(struct if_info));
+    info->ifindex = ifindex;
+    info->slot = slot;
+    info->name = intern(name);
+    info->desc = intern("-");
+
+    /* Up from the start, which is no change of link. */
+    iftable.flags[slot] = IF_USED | IF_ADMIN_UP | IF_OPER_UP;
+    iftable.mtu[slot] = 1522;
+    iftable.speed[slot] = 0;
+    iftable.def_vlan[slot] = 1;
+    iftable.info[slot] = info;
+    iftable.count++;
+    IF_CHANGED(slot);
+    ifevent_post(slot, IF_EVENT_CREATE);
+    if_set_oper(slot, 1);
+    ifstat_clear(slot);
+
+    /* An access port in the default VLAN. */
+    vlan_bitmap_zero(&none);
+    if_vlan_changed(slot, &none);
+
+    hash_get(iftable.by_index, info, hash_alloc_intern);
+    radix_insert(iftable.names, info->name, info);
+    skiplist_insert(iftable.ordered, info);
+    if(ifindex > if_ifindex_last)
+        if_ifindex_last = ifindex;
+
+    return slot;
+}
+
+/* Remove the interface in SLOT. */
+void if_delete(int slot)
+{
+    struct if_info *info = iftable.info[slot];
+    struct vlan_bitmap member, none;
+
+    ifevent_post(slot, IF_EVENT_DELETE);
+    if_vlan_member(slot, &member);
+    vlan_bitmap_zero(&none);
+    if_vlan_move(slot, &member, &none);
+    if_set_oper(slot, 0);
+
+    hash_release(iftable.by_index, info);
+    radix_delete(iftable.names, info->name);
+    skiplist_delete(iftable.ordered, info);
+    intern_unref(info->name);
+    intern_unref(info->desc);
+    XFREE(MTYPE_IF, info);
+
+    iftable.flags[slot] = 0;
+    iftable.info[slot] = NULL;
+    iftable.count--;
+    if((unsigned int)slot < iftable.hint)
+        iftable.hint = slot;
+    while(iftable.max && ! (iftable.flags[iftable.max - 1] & IF_USED))
+        iftable.max--;
+}
+
+/* Log the link changes of a batch, a line for all of the ports when
+   there are several. */
+static void if_link_log(const struct ifevent *ev, int n, void *arg)
+{
+    int i, slot, last = -1, up = 0, down = 0;
+
+    for(i = 0; i < n; i++)
+    {
+        slot = if_lookup_by_index(ev[i].ifindex);
+        if(slot < 0)
+            continue;
+        if(iftable.flags[slot] & IF_OPER_UP)
+            up++;
+        else
+            down++;
+        last = slot;
+    }
+
+    if(up + down == 1)
+        zlog_info("Interface %s is %s", iftable.info[last]->name,
+            up ? "up" : (iftable.flags[last] & IF_ADMIN_UP)
+            ? "down" : "administratively down");
+    else if(up + down > 1)
+        zlog_info("%d interfaces changed state, %d up, %d down",
+            up + down, up, down);
+}
+
+/* Update the traffic rates of all ports, called about once a second,
+   and their history each minute, and publish the table for other
+   processes.  With kernel sync on, the counters are the devices'. */
+void if_counters_sample(void)
+{
+    static time_t last;
+    time_t now = time(NULL);
+    int slot;
+
+    if(now - last < IFSTAT_INTERVAL)
+        return;
+    if(last == 0)
+        last = now - IFSTAT_INTERVAL;
+
+    worker_state_lock();
+    ifnl_poll();
+    IF_LOOP(slot)
+        ifstat_rate_update(slot, now - last);
+    if(ifstat_hist_advance(now))
+        IF_LOOP(slot)
+            ifstat_hist_update(slot);
+    ifshm_publish();
+    worker_state_unlock();
+
+    last = now;
+}
+
+/* Slot of interface IFINDEX, or -1. */
+int if_lookup_by_index(unsigned int ifindex)
+{
+    struct if_info key;
+    struct if_info *info;
+
+    key.ifindex = ifindex;
+    info = hash_lookup(iftable.by_index, &key);
+    return info ? info->slot : -1;
+}
+
+/* Slot of the interface called NAME, or -1. */
+int if_lookup_by_name(const char *name)
+{
+    struct if_info *info;
+
+    info = radix_lookup(iftable.names, name);
+    return info ? info->slot : -1;
+}
 
+static void if_name_complete_add(const char *name, void *matchvec)
+{
+    cmd_complete_add(matchvec, name);
+}
+
+/* Completions of an interface name starting with PREFIX.  There is one
+   per branch of the names, however many ports there are. */
+static void if_name_complete(const char *prefix, vector matchvec)
+{
+    worker_state_lock();
+    radix_complete(iftable.names, prefix, if_name_complete_add, matchvec);
+    worker_state_unlock();
+}
+
+/* Walk the slots S of the ports the vty is configuring, P is the
+   walk's position.  Ports removed meanwhile are skipped. */
+#define IF_VTY_LOOP(V,P,S) \
+    for((P) = 0; ((S) = if_vty_next((V), &(P))) >= 0; )
 
+/* Slot of the next port the vty is configuring from position *POS on,
+   or -1. */
+static int if_vty_next(struct vty *vty, unsigned int *pos)
+{
+    unsigned long word;
+    unsigned int ifindex;
+    int slot;
 
+    if(vty->ifrange == NULL)
+    {
+        if(*pos > 0)
+            return -1;
+        *pos = 1;
+        return if_lookup_by_index(vty->ifindex);
+    }
+
+    while(*pos < vty->ifrange_size)
+    {
+        word = vty->ifrange[*pos / VLAN_WORD_BITS]
+            & (~0UL << (*pos % VLAN_WORD_BITS));
+        if(word == 0)
+        {
+            *pos = (*pos / VLAN_WORD_BITS + 1) * VLAN_WORD_BITS;
+            continue;
+        }
+        ifindex = *pos / VLAN_WORD_BITS * VLAN_WORD_BITS
+            + __builtin_ctzl(word);
+        *pos = ifindex + 1;
+        if((slot = if_lookup_by_index(ifindex)) >= 0)
+            return slot;
+    }
+    return -1;
+}
 
-DEFUN(show_interface,
+/* Result of a command on the ports the vty is configuring, N of which
+   were still there. */
+static int if_vty_done(struct vty *vty, int n)
+{
+    if(n == 0)
+    {
+        vty_out(vty, "%% Interface has been removed%s", VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+    return CMD_SUCCESS;
+}
+
+/* Configure one interface from now on. */
+static void if_vty_select(struct vty *vty, unsigned int ifindex)
+{
+    if(vty->ifrange)
+    {
+        XFREE(MTYPE_VTY, vty->ifrange);
+        vty->ifrange = NULL;
+        vty->ifrange_size = 0;
+    }
+    vty->ifindex = ifindex;
+    vty->node = INTERFACE_NODE;
+}
+
+/* Add port IFINDEX to RANGE, a bit per ifindex, of *SIZE bits. */
+static unsigned long *if_range_add(unsigned long *range, unsigned int *size,
+    unsigned int ifindex)
+{
+    unsigned int old = *size;
+    unsigned int size_new = old ? old : 64;
+
+    while(ifindex >= size_new)
+        size_new *= 2;
+    if(size_new != old)
+    {
+        range = XREALLOC(MTYPE_VTY, range, size_new / 8);
+        memset((char *)range + old / 8, 0, (size_new - old) / 8);
+        *size = size_new;
+    }
+    range[ifindex / VLAN_WORD_BITS] |= 1UL << (ifindex % VLAN_WORD_BITS);
+    return range;
+}
+
+/* Read the ports of RANGE, such as "ge1/0/1-48,2/0/1-24,50", into a
+   bitmap of ifindexes.  Each item ends with a port number or a range
+   of them; an item which doesn't start with letters takes them from
+   the item before, one without a '/' all of the name before the port
+   number.  Returns NULL, having said why, when a port doesn't exist. */
+static unsigned long *if_range_parse(struct vty *vty, const char *range,
+    unsigned int *size)
+{
+    unsigned long *ports = NULL;
+    char letters[16] = "";
+    char base[64] = "";
+    char name[80];
+    const char *item, *next, *slash, *p;
+    char *end;
+    long from, to;
+    int len, n, slot;
+
+    *size = 0;
+    for(item = range; item; item = next)
+    {
+        next = strchr(item, ',');
+        len = next ? next - item : (int)strlen(item);
+        if(next)
+            next++;
+
+        /* The name up to the port number. */
+        for(slash = NULL, p = item; p < item + len; p++)
+            if(*p == '/')
+                slash = p;
+        if(slash)
+        {
+            for(n = 0; n < len && isalpha((unsigned char)item[n]); n++)
+                ;
+            if(n > 0)
+                snprintf(letters, sizeof(letters), "%.*s", n, item);
+            snprintf(base, sizeof(base), "%s%.*s", n > 0 ? "" : letters,
+                (int)(slash + 1 - item), item);
+            p = slash + 1;
+        }
+        else
+            p = item;
+        if(base[0] == '\0' || ! isdigit((unsigned char)*p))
+            goto bad;
+
+        from = to = strtol(p, &end, 10);
+        if(*end == '-')
+            to = strtol(end + 1, &end, 10);
+        if(end != item + len || to < from || to - from > 65535)
+            goto bad;
+
+        for(; from <= to; from++)
+        {
+            snprintf(name, sizeof(name), "%s%ld", base, from);
+            if((slot = if_lookup_by_name(name)) < 0)
+            {
+                vty_out(vty, "%% No such interface %s%s", name, VTY_NEWLINE);
+                goto fail;
+            }
+            ports = if_range_add(ports, size, iftable.info[slot]->ifindex);
+        }
+    }
+    return ports;
+
+bad:
+    vty_out(vty, "%% Invalid interface range %s%s", range, VTY_NEWLINE);
+fail:
+    if(ports)
+        XFREE(MTYPE_VTY, ports);
+    *size = 0;
+    return NULL;
+}
+
+/* A line of show interface, rendered when the port has changed since
+   the last one was.  Shows which print it hold a reference, so it may
+   be replaced meanwhile. */
+struct if_line
+{
+    int refcnt;
+    unsigned int gen;
+    int len;
+    char text[1];
+};
+
+/* Line of each slot, guarded by the worker state lock. */
+static struct if_line **if_lines;
+static unsigned int if_lines_size;
+
+/* Lines are written in batches of this many. */
+#define IF_LINE_BATCH 256
+
+static void if_line_unref(struct if_line *line)
+{
+    if(__atomic_sub_fetch(&line->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+        XFREE(MTYPE_IF_LINE, line);
+}
+
+/* Line of the port in SLOT as it is now, with a reference for the
+   caller, who holds the worker state lock. */
+static struct if_line *if_line_get(int slot)
+{
+    struct if_info *info = iftable.info[slot];
+    struct if_line *line;
+    const char *admin, *oper;
+    unsigned int size;
+    int len;
+
+    if(slot >= (int)if_lines_size)
+    {
+        size = iftable.size;
+        if_lines = XREALLOC(MTYPE_IF_LINE, if_lines,
+            sizeof(struct if_line *) * size);
+        memset(if_lines + if_lines_size, 0,
+            sizeof(struct if_line *) * (size - if_lines_size));
+        if_lines_size = size;
+    }
+
+    line = if_lines[slot];
+    if(line == NULL || line->gen != iftable.gen[slot])
+    {
+        if(line)
+            if_line_unref(line);
+
+        admin = (iftable.flags[slot] & IF_ADMIN_UP) ? "up" : "down";
+        oper = (iftable.flags[slot] & IF_OPER_UP) ? "up" : "down";
+        len = snprintf(NULL, 0, "  %-18s%s/%-*s%-10s%s%s", info->name,
+            admin, (int)(12 - strlen(admin) - 1), oper, "bridge", info->desc,
+            VTY_NEWLINE);
+        line = XMALLOC(MTYPE_IF_LINE, sizeof(struct if_line) + len);
+        snprintf(line->text, len + 1, "  %-18s%s/%-*s%-10s%s%s", info->name,
+            admin, (int)(12 - strlen(admin) - 1), oper, "bridge", info->desc,
+            VTY_NEWLINE);
+        line->len = len;
+        line->gen = iftable.gen[slot];
+        line->refcnt = 1;
+        if_lines[slot] = line;
+    }
+
+    __atomic_add_fetch(&line->refcnt, 1, __ATOMIC_RELAXED);
+    return line;
+}
+
+/* Text of show interface, put together from the lines of the ports
+   without formatting any which haven't changed. */
+static void show_interface_text(struct vty *vty)
+{
+    struct if_line **lines;
+    struct iovec iov[IF_LINE_BATCH];
+    struct skiplist_node *node;
+    struct if_info *info;
+    int i, j, n;
+
+    worker_state_lock();
+    lines = XMALLOC(MTYPE_TMP, sizeof(struct if_line *) * (iftable.count + 1));
+    n = 0;
+    SKIPLIST_LOOP(iftable.ordered, info, node)
+        lines[n++] = if_line_get(info->slot);
+    worker_state_unlock();
+
+    vty_out(vty, "  %-18s%-12s%-10s%s%s", "Interface", "State(a/o)", "Mode",
+        "Descr", VTY_NEWLINE);
+    for(i = 0; i < n; i += j)
+    {
+        for(j = 0; j < IF_LINE_BATCH && i + j < n; j++)
+        {
+            iov[j].iov_base = lines[i + j]->text;
+            iov[j].iov_len = lines[i + j]->len;
+        }
+        vty_writev(vty, iov, j);
+    }
+
+    for(i = 0; i < n; i++)
+        if_line_unref(lines[i]);
+    XFREE(MTYPE_TMP, lines);
+}
+
+/* What show interface json prints of a port. */
+struct if_brief
+{
+    char *name;
+    char *desc;
+    unsigned char flags;
+};
+
+static void show_interface_json_vty(struct vty *vty)
+{
+    struct if_brief *port;
+    struct skiplist_node *node;
+    struct if_info *info;
+    int i, n;
+
+    /* Work on a copy, this may run on a worker thread. */
+    worker_state_lock();
+    port = XMALLOC(MTYPE_TMP, sizeof(struct if_brief) * (iftable.count + 1));
+    n = 0;
+    SKIPLIST_LOOP(iftable.ordered, info, node)
+    {
+        port[n].name = intern_ref(info->name);
+        port[n].desc = intern_ref(info->desc);
+        port[n].flags = iftable.flags[info->slot];
+        n++;
+    }
+    worker_state_unlock();
+
+    vty_object_begin(vty, NULL);
+    vty_array_begin(vty, "interfaces");
+    for(i = 0;i < n;i++)
+    {
+        vty_row_begin(vty);
+        vty_field_str(vty, "name", 0, port[i].name);
+        vty_field_str(vty, "adminStatus", 0,
+            (port[i].flags & IF_ADMIN_UP)?"up":"down");
+        vty_field_str(vty, "operStatus", 0,
+            (port[i].flags & IF_OPER_UP)?"up":"down");
+        vty_field_str(vty, "mode", 0, "bridge");
+        vty_field_str(vty, "description", 0, port[i].desc);
+        vty_row_end(vty);
+    }
+    vty_array_end(vty);
+    vty_object_end(vty);
+
+    for(i = 0;i < n;i++)
+    {
+        intern_unref(port[i].name);
+        intern_unref(port[i].desc);
+    }
+    XFREE(MTYPE_TMP, port);
+}
+
+DEFUN_ATTR(show_interface,
     show_interface_cmd,
     "show interface",
     SHOW_STR
-    "The information of specify interface\n")
+    "The information of specify interface\n",
+    CMD_ATTR_READONLY)
+{
+    if(vty->json)
+        show_interface_json_vty(vty);
+    else
+        show_interface_text(vty);
+    return CMD_SUCCESS;
+}
+
+static const char *if_linktype_str[] = { "access", "trunk", "hybrid" };
+
+/* Detail of the interface called NAME. */
+static int show_interface_name_vty(struct vty *vty, const char *name)
 {
-    int ret = 0;
-    char if_str[128] = {0};
-    char descr[128 + 2] = {0};
-    int ifOper = 0;
-    int ifAdmin = 0;
-    int i = 0;
-    int flag = 0;
-    char state_str[32] = {0};
+    struct if_info info;
+    unsigned char flags;
+    unsigned int mtu, speed;
+    unsigned short pvid;
+    char *vlans;
+    int slot;
+
+    worker_state_lock();
+    slot = if_lookup_by_name(name);
+    if(slot >= 0)
+    {
+        info = *iftable.info[slot];
+        intern_ref(info.name);
+        intern_ref(info.desc);
+        flags = iftable.flags[slot];
+        mtu = iftable.mtu[slot];
+        speed = iftable.speed[slot];
+        pvid = iftable.def_vlan[slot];
+    }
+    worker_state_unlock();
 
-    while(i < MAX_ETH_PORT)
+    if(slot < 0)
     {
-        snprintf(state_str,sizeof(state_str)-1,"%s/%s",
-            (eth_port[i].admin_status== 1)?"up":"down",
-            (eth_port[i].oper_status == 1)?"up":"down");
+        vty_out(vty, "%% No such interface%s", VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+
+    vlans = XMALLOC(MTYPE_TMP, VLAN_LIST_MAX);
+
+    vty_object_begin(vty, NULL);
+    vty_field_str(vty, "name", 0, info.name);
+    vty_field_label(vty, 0, " is ");
+    vty_field_str(vty, "adminStatus", 0, (flags & IF_ADMIN_UP) ? "up" : "down");
+    vty_field_label(vty, 0, ", line protocol is ");
+    vty_field_str(vty, "operStatus", 0, (flags & IF_OPER_UP) ? "up" : "down");
+    vty_field_label(vty, 0, VTY_NEWLINE);
+    vty_field_label(vty, 0, "  Description: ");
+    vty_field_str(vty, "description", 0, info.desc);
+    vty_field_label(vty, 0, VTY_NEWLINE);
+    vty_field_label(vty, 0, "  Index ");
+    vty_field_int(vty, "ifindex", 0, info.ifindex);
+    vty_field_label(vty, 0, ", MTU ");
+    vty_field_int(vty, "mtu", 0, mtu);
+    vty_field_label(vty, 0, ", speed ");
+    vty_field_int(vty, "speed", 0, speed);
+    vty_field_label(vty, 0, ", duplex ");
+    vty_field_str(vty, "duplex", 0, info.duplex ? "full" : "half");
+    vty_field_label(vty, 0, VTY_NEWLINE);
+    vty_field_label(vty, 0, "  Link type ");
+    vty_field_str(vty, "linkType", 0, if_linktype_str[info.linktype]);
+    vty_field_label(vty, 0, ", PVID ");
+    vty_field_int(vty, "pvid", 0, pvid);
+    vty_field_label(vty, 0, VTY_NEWLINE);
+    if(info.linktype != IF_LINK_ACCESS)
+    {
+        vty_field_label(vty, 0, "  Tagged VLANs: ");
+        vty_field_str(vty, "tagged", 0,
+            vlan_list_format(&info.tagged, vlans, VLAN_LIST_MAX));
+        vty_field_label(vty, 0, VTY_NEWLINE);
+    }
+    if(info.linktype == IF_LINK_HYBRID)
+    {
+        vty_field_label(vty, 0, "  Untagged VLANs: ");
+        vty_field_str(vty, "untagged", 0,
+            vlan_list_format(&info.untagged, vlans, VLAN_LIST_MAX));
+        vty_field_label(vty, 0, VTY_NEWLINE);
+    }
+    vty_object_end(vty);
 
-        if(flag == 0)
+    XFREE(MTYPE_TMP, vlans);
+    intern_unref(info.name);
+    intern_unref(info.desc);
+    return CMD_SUCCESS;
+}
+
+DEFUN_ATTR(show_interface_name,
+    show_interface_name_cmd,
+    "show interface IFNAME",
+    SHOW_STR
+    "The information of specify interface\n"
+    "Interface name\n",
+    CMD_ATTR_READONLY)
+{
+    return show_interface_name_vty(vty, argv[0]);
+}
+
+DEFUN_ATTR(show_interface_json,
+    show_interface_json_cmd,
+    "show interface json",
+    SHOW_STR
+    "The information of specify interface\n"
+    "JavaScript Object Notation\n",
+    CMD_ATTR_READONLY)
+{
+    vty->json = 1;
+    show_interface_json_vty(vty);
+    vty->json = 0;
+    return CMD_SUCCESS;
+}
+
+/* What show interface counters prints of a port. */
+struct if_counter_row
+{
+    char *name;
+    unsigned long c[IFSTAT_MAX];
+    double rate[IFSTAT_MAX][IFSTAT_WINDOWS];
+};
+
+static void show_interface_counters_vty(struct vty *vty, int rates)
+{
+    static const char *rate_label[IFSTAT_WINDOWS] = { "5s", "5m" };
+    struct if_counter_row *port;
+    struct skiplist_node *node;
+    struct if_info *info;
+    struct ifstat s;
+    struct ifstat_rate r;
+    char label[24], key[24];
+    int i, n, w, slot;
+
+    worker_state_lock();
+    port = XMALLOC(MTYPE_TMP,
+        sizeof(struct if_counter_row) * (iftable.count + 1));
+    n = 0;
+    SKIPLIST_LOOP(iftable.ordered, info, node)
+    {
+        slot = info->slot;
+        port[n].name = intern_ref(info->name);
+        if(rates)
         {
-            vty_out(vty,"  %-18s%-12s%-10s%s%s","Interface","State(a/o)","Mode","Descr",VTY_NEWLINE);
-            flag = 1;
+            ifstat_rate_get(slot, &r);
+            memcpy(port[n].rate, r.rate, sizeof(r.rate));
         }
+        else
+        {
+            ifstat_get(slot, &s);
+            memcpy(port[n].c, s.c, sizeof(s.c));
+        }
+        n++;
+    }
+    worker_state_unlock();
 
-        ret = vty_out(vty,"  %-18s%-12s%-10s%s%s",eth_port[i].name,state_str,"bridge",
-            eth_port[i].desc,VTY_NEWLINE);
-        i++;
+    vty_object_begin(vty, NULL);
+    vty_field_label(vty, 0, "  ");
+    vty_field_label(vty, 12, "Interface");
+    if(rates)
+    {
+        for(w = 0; w < IFSTAT_WINDOWS; w++)
+        {
+            snprintf(label, sizeof(label), "RxPps(%s)", rate_label[w]);
+            vty_field_label(vty, 12, label);
+            snprintf(label, sizeof(label), "RxBps(%s)", rate_label[w]);
+            vty_field_label(vty, 14, label);
+            snprintf(label, sizeof(label), "TxPps(%s)", rate_label[w]);
+            vty_field_label(vty, 12, label);
+            snprintf(label, sizeof(label), "TxBps(%s)", rate_label[w]);
+            vty_field_label(vty, w + 1 < IFSTAT_WINDOWS ? 14 : 0, label);
+        }
     }
+    else
+    {
+        vty_field_label(vty, 14, "RxPkts");
+        vty_field_label(vty, 18, "RxBytes");
+        vty_field_label(vty, 10, "RxErr");
+        vty_field_label(vty, 10, "RxDrop");
+        vty_field_label(vty, 14, "TxPkts");
+        vty_field_label(vty, 18, "TxBytes");
+        vty_field_label(vty, 10, "TxErr");
+        vty_field_label(vty, 0, "TxDrop");
+    }
+    vty_field_label(vty, 0, VTY_NEWLINE);
+
+    vty_array_begin(vty, "interfaces");
+    for(i = 0;i < n;i++)
+    {
+        vty_row_begin(vty);
+        vty_field_label(vty, 0, "  ");
+        vty_field_str(vty, "name", 12, port[i].name);
+        if(rates)
+        {
+            /* Bytes are shown as bits. */
+            for(w = 0; w < IFSTAT_WINDOWS; w++)
+            {
+                snprintf(key, sizeof(key), "rxPps%s", rate_label[w]);
+                vty_field_int(vty, key, 12,
+                    (long)(port[i].rate[IFSTAT_RX_PACKETS][w] + 0.5));
+                snprintf(key, sizeof(key), "rxBps%s", rate_label[w]);
+                vty_field_int(vty, key, 14,
+                    (long)(port[i].rate[IFSTAT_RX_BYTES][w] * 8 + 0.5));
+                snprintf(key, sizeof(key), "txPps%s", rate_label[w]);
+                vty_field_int(vty, key, 12,
+                    (long)(port[i].rate[IFSTAT_TX_PACKETS][w] + 0.5));
+                snprintf(key, sizeof(key), "txBps%s", rate_label[w]);
+                vty_field_int(vty, key, w + 1 < IFSTAT_WINDOWS ? 14 : 0,
+                    (long)(port[i].rate[IFSTAT_TX_BYTES][w] * 8 + 0.5));
+            }
+        }
+        else
+        {
+            vty_field_int(vty, "rxPackets", 14, port[i].c[IFSTAT_RX_PACKETS]);
+            vty_field_int(vty, "rxBytes", 18, port[i].c[IFSTAT_RX_BYTES]);
+            vty_field_int(vty, "rxErrors", 10, port[i].c[IFSTAT_RX_ERRORS]);
+            vty_field_int(vty, "rxDrops", 10, port[i].c[IFSTAT_RX_DROPS]);
+            vty_field_int(vty, "txPackets", 14, port[i].c[IFSTAT_TX_PACKETS]);
+            vty_field_int(vty, "txBytes", 18, port[i].c[IFSTAT_TX_BYTES]);
+            vty_field_int(vty, "txErrors", 10, port[i].c[IFSTAT_TX_ERRORS]);
+            vty_field_int(vty, "txDrops", 0, port[i].c[IFSTAT_TX_DROPS]);
+        }
+        vty_row_end(vty);
+        intern_unref(port[i].name);
+    }
+    vty_array_end(vty);
+    vty_object_end(vty);
+
+    XFREE(MTYPE_TMP, port);
+}
+
+DEFUN_ATTR(show_interface_counters,
+    show_interface_counters_cmd,
+    "show interface counters",
+    SHOW_STR
+    "The information of specify interface\n"
+    "Traffic counters\n",
+    CMD_ATTR_READONLY)
+{
+    show_interface_counters_vty(vty, 0);
+    return CMD_SUCCESS;
+}
+
+DEFUN_ATTR(show_interface_counters_rate,
+    show_interface_counters_rate_cmd,
+    "show interface counters rate",
+    SHOW_STR
+    "The information of specify interface\n"
+    "Traffic counters\n"
+    "Traffic rates over 5 seconds and 5 minutes\n",
+    CMD_ATTR_READONLY)
+{
+    show_interface_counters_vty(vty, 1);
+    return CMD_SUCCESS;
+}
+
+static const char *if_hist_key[IFSTAT_HIST_MAX] =
+{
+    "rxPackets", "rxBytes", "txPackets", "txBytes"
+};
+
+/* Print the N samples of RING, newest first, the newest of which
+   ended at END; they are STEP seconds apart. */
+static void if_hist_rows(struct vty *vty, const char *key,
+    unsigned short (*ring)[IFSTAT_HIST_MAX], int n, time_t end, int step)
+{
+    char buf[16];
+    struct tm tm;
+    time_t t;
+    int i, h;
+
+    vty_array_begin(vty, key);
+    for(i = 0;i < n;i++)
+    {
+        t = end - (time_t)i * step;
+        vty_row_begin(vty);
+        if(vty->json)
+            vty_field_int(vty, "time", 0, t);
+        else
+        {
+            localtime_r(&t, &tm);
+            strftime(buf, sizeof(buf), "%H:%M", &tm);
+            vty_field_label(vty, 0, "  ");
+            vty_field_str(vty, "time", 8, buf);
+        }
+        for(h = 0; h < IFSTAT_HIST_MAX; h++)
+            vty_field_int(vty, if_hist_key[h],
+                h + 1 < IFSTAT_HIST_MAX ? 16 : 0, IFSTAT_UNPACK(ring[i][h]));
+        vty_row_end(vty);
+    }
+    vty_array_end(vty);
+}
+
+static void if_hist_header(struct vty *vty, const char *name,
+    const char *what)
+{
+    vty_field_label(vty, 0, "  Interface ");
+    vty_field_label(vty, 0, name);
+    vty_field_label(vty, 0, what);
+    vty_field_label(vty, 0, VTY_NEWLINE);
+    vty_field_label(vty, 0, "  ");
+    vty_field_label(vty, 8, "Time");
+    vty_field_label(vty, 16, "RxPkts");
+    vty_field_label(vty, 16, "RxBytes");
+    vty_field_label(vty, 16, "TxPkts");
+    vty_field_label(vty, 0, "TxBytes");
+    vty_field_label(vty, 0, VTY_NEWLINE);
+}
+
+DEFUN_ATTR(show_interface_history,
+    show_interface_history_cmd,
+    "show interface IFNAME history",
+    SHOW_STR
+    "The information of specify interface\n"
+    "Interface name\n"
+    "Traffic of each minute of the last hour and hour of the last day\n",
+    CMD_ATTR_READONLY)
+{
+    struct ifstat_hist hist;
+    char *name;
+    int slot;
+
+    worker_state_lock();
+    slot = if_lookup_by_name(argv[0]);
+    if(slot >= 0)
+    {
+        name = intern_ref(iftable.info[slot]->name);
+        ifstat_hist_get(slot, &hist);
+    }
+    worker_state_unlock();
+
+    if(slot < 0)
+    {
+        vty_out(vty, "%% No such interface%s", VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+
+    vty_object_begin(vty, NULL);
+    if(vty->json)
+        vty_field_str(vty, "name", 0, name);
+    if_hist_header(vty, name, ", last hour");
+    if_hist_rows(vty, "minutes", hist.minute, hist.minutes,
+        hist.minute_end, 60);
+    if_hist_header(vty, name, ", last day");
+    if_hist_rows(vty, "hours", hist.hour, hist.hours, hist.hour_end, 3600);
+    vty_object_end(vty);
+
+    intern_unref(name);
     return CMD_SUCCESS;
 }
 
+/* Ports show interface history export takes at a time. */
+#define IF_EXPORT_BATCH 256
+
+struct if_hist_row
+{
+    char *name;
+    struct ifstat_hist hist;
+};
+
+/* Print the samples of RING as arrays of counts. */
+static void if_export_rows(struct vty *vty, const char *key,
+    unsigned short (*ring)[IFSTAT_HIST_MAX], int n)
+{
+    int i, h;
+
+    vty_array_begin(vty, key);
+    for(i = 0;i < n;i++)
+    {
+        vty_array_begin(vty, NULL);
+        for(h = 0; h < IFSTAT_HIST_MAX; h++)
+            vty_field_int(vty, NULL, 0, IFSTAT_UNPACK(ring[i][h]));
+        vty_array_end(vty);
+    }
+    vty_array_end(vty);
+}
+
+DEFUN_ATTR(show_interface_history_export,
+    show_interface_history_export_cmd,
+    "show interface history export",
+    SHOW_STR
+    "The information of specify interface\n"
+    "Traffic of each minute of the last hour and hour of the last day\n"
+    "All interfaces in JavaScript Object Notation\n",
+    CMD_ATTR_READONLY)
+{
+    struct if_hist_row *port;
+    struct skiplist_cursor cursor;
+    struct if_info *info;
+    int i, n;
+    int json = vty->json;
+
+    /* Batches keep the state lock and the copy short.  Ports may come
+       and go between them, the cursor keeps its place. */
+    port = XMALLOC(MTYPE_TMP, sizeof(struct if_hist_row) * IF_EXPORT_BATCH);
+    worker_state_lock();
+    skiplist_cursor_init(iftable.ordered, &cursor);
+    worker_state_unlock();
+
+    vty->json = 1;
+    vty_object_begin(vty, NULL);
+    vty_array_begin(vty, "counters");
+    for(i = 0; i < IFSTAT_HIST_MAX; i++)
+        vty_field_str(vty, NULL, 0, if_hist_key[i]);
+    vty_array_end(vty);
+    vty_array_begin(vty, "interfaces");
+    do
+    {
+        n = 0;
+        worker_state_lock();
+        while(n < IF_EXPORT_BATCH
+            && (info = skiplist_cursor_next(&cursor)) != NULL)
+        {
+            port[n].name = intern_ref(info->name);
+            ifstat_hist_get(info->slot, &port[n].hist);
+            n++;
+        }
+        worker_state_unlock();
+
+        for(i = 0;i < n;i++)
+        {
+            vty_row_begin(vty);
+            vty_field_str(vty, "name", 0, port[i].name);
+            vty_field_int(vty, "minuteEnd", 0, port[i].hist.minute_end);
+            if_export_rows(vty, "minutes", port[i].hist.minute,
+                port[i].hist.minutes);
+            vty_field_int(vty, "hourEnd", 0, port[i].hist.hour_end);
+            if_export_rows(vty, "hours", port[i].hist.hour,
+                port[i].hist.hours);
+            vty_row_end(vty);
+            intern_unref(port[i].name);
+        }
+    }
+    while(n > 0);
+    vty_array_end(vty);
+    vty_object_end(vty);
+    vty->json = json;
+
+    worker_state_lock();
+    skiplist_cursor_done(&cursor);
+    worker_state_unlock();
+
+    XFREE(MTYPE_TMP, port);
+    return CMD_SUCCESS;
+}
 
 DEFUN(config_one_if,
     config_one_if_cmd,
-    "interface (ethernet|fastethernet|gigaethernet) <1-12>",
+    "interface (ethernet|fastethernet|gigaethernet) <1-65535>",
     "The information of specify interface\n"
     "(ethernet|fastethernet|gigaethernet)")
 {
     int ifType = 0;
     int ifIndex = atoi(argv[1]);
 
-    vty->ifindex = ifIndex;
-    vty->node = INTERFACE_NODE;
+    if(if_lookup_by_index(ifIndex) < 0)
+    {
+        vty_out(vty, "%% No such interface%s", VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+
+    if_vty_select(vty, ifIndex);
+
+    return CMD_SUCCESS;
+}
+
+/* Configure interface NAME, which is added when there is none. */
+DEFUN(config_if_name,
+    config_if_name_cmd,
+    "interface IFNAME",
+    "The information of specify interface\n"
+    "Interface name\n")
+{
+    int slot = if_lookup_by_name(argv[0]);
+
+    if(slot < 0)
+        slot = if_create(if_ifindex_last + 1, argv[0]);
+    if(slot < 0)
+    {
+        vty_out(vty, "%% Can't add interface %s%s", argv[0], VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+
+    if_vty_select(vty, iftable.info[slot]->ifindex);
+
+    return CMD_SUCCESS;
+}
+
+/* Remove an interface added by the command above, the front panel
+   ports stay.  This may be one the vty is configuring, whose commands
+   then skip it. */
+DEFUN(no_config_if_name,
+    no_config_if_name_cmd,
+    "no interface IFNAME",
+    NO_STR
+    "The information of specify interface\n"
+    "Interface name\n")
+{
+    int slot = if_lookup_by_name(argv[0]);
+
+    if(slot < 0)
+    {
+        vty_out(vty, "%% No such interface%s", VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+    if(iftable.info[slot]->unit)
+    {
+        vty_out(vty, "%% Front panel ports can't be removed%s", VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+
+    if_delete(slot);
+
+    return CMD_SUCCESS;
+}
+
+DEFUN(config_if_range,
+    config_if_range_cmd,
+    "interface range RANGE",
+    "The information of specify interface\n"
+    "Configure several interfaces at once\n"
+    "Interfaces such as ge1/0/1-48,2/0/1-24\n")
+{
+    unsigned long *ports;
+    unsigned int size;
+
+    ports = if_range_parse(vty, argv[0], &size);
+    if(ports == NULL)
+        return CMD_WARNING;
+
+    if_vty_select(vty, 0);
+    vty->ifrange = ports;
+    vty->ifrange_size = size;
 
     return CMD_SUCCESS;
 }
@@ -109,7 +1270,10 @@ DEFUN(interface_desc,
     "Set interface description\n"
     "Description, the max length is 64\n")
 {
-    int ifIndex = vty->ifindex;
+    unsigned int pos;
+    int slot, n = 0;
+    char *desc, *old;
+
     if(argc > 0)
     {
         if(strlen(argv[0]) > 64)
@@ -118,9 +1282,21 @@ DEFUN(interface_desc,
             return CMD_WARNING;
         }
     }
-    strncpy(eth_port[ifIndex - 1].desc,argv[0],sizeof(eth_port[ifIndex - 1].desc));
 
-    return CMD_SUCCESS;
+    desc = intern(argv[0]);
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        old = iftable.info[slot]->desc;
+        iftable.info[slot]->desc = intern_ref(desc);
+        IF_CHANGED(slot);
+        if(old != desc)
+            ifevent_post(slot, IF_EVENT_DESC);
+        intern_unref(old);
+        n++;
+    }
+    intern_unref(desc);
+
+    return if_vty_done(vty, n);
 }
 
 DEFUN(interface_mtu,
@@ -130,15 +1306,24 @@ DEFUN(interface_mtu,
     "Size in bytes , default value is 1522\n")
 {
     int mtu = 1522;
-    int ifIndex = vty->ifindex;
+    unsigned int pos;
+    int slot, n = 0;
+
     if(argc > 0)
     {
         mtu = atoi(argv[0]);
     }
 
-    eth_port[ifIndex - 1].mtu = mtu;
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        if(iftable.mtu[slot] != (unsigned int)mtu)
+            ifevent_post(slot, IF_EVENT_MTU);
+        iftable.mtu[slot] = mtu;
+        IF_CHANGED(slot);
+        n++;
+    }
 
-    return CMD_SUCCESS;
+    return if_vty_done(vty, n);
 }
 
 
@@ -147,12 +1332,20 @@ DEFUN(shutdown_if,
     "shutdown",
     "Shutdown the interface\n")
 {
-    int ifIndex = vty->ifindex;
+    unsigned int pos;
+    int slot, n = 0;
 
-    eth_port[ifIndex - 1].admin_status = 0;
-    eth_port[ifIndex - 1].oper_status = 0;
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        if(iftable.flags[slot] & IF_ADMIN_UP)
+            ifevent_post(slot, IF_EVENT_LINK);
+        iftable.flags[slot] &= ~IF_ADMIN_UP;
+        IF_CHANGED(slot);
+        if_set_oper(slot, 0);
+        n++;
+    }
 
-    return CMD_SUCCESS;
+    return if_vty_done(vty, n);
 }
 
 DEFUN(no_shutdown_if,
@@ -160,12 +1353,20 @@ DEFUN(no_shutdown_if,
     "no shutdown",
     NO_STR) 
 {
-    int ifIndex = vty->ifindex;
+    unsigned int pos;
+    int slot, n = 0;
 
-    eth_port[ifIndex - 1].admin_status = 1;
-    eth_port[ifIndex - 1].oper_status = 1;
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        if(! (iftable.flags[slot] & IF_ADMIN_UP))
+            ifevent_post(slot, IF_EVENT_LINK);
+        iftable.flags[slot] |= IF_ADMIN_UP;
+        IF_CHANGED(slot);
+        if_set_oper(slot, 1);
+        n++;
+    }
 
-    return CMD_SUCCESS;
+    return if_vty_done(vty, n);
 }
 
 DEFUN(interface_duplex_mode,
@@ -173,14 +1374,18 @@ DEFUN(interface_duplex_mode,
     "duplex (full|half)",
     "Configure duplex mode\n")
 {
-    int ifIndex = vty->ifindex;
+    int duplex = (argv[0][0] == 'f' || argv[0][0] == 'F');
+    unsigned int pos;
+    int slot, n = 0;
 
-    if(argv[0][0] == 'f' || argv[0][0] == 'F')
-        eth_port[ifIndex - 1].duplex = 1;
-    else
-        eth_port[ifIndex - 1].duplex = 0;
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        iftable.info[slot]->duplex = duplex;
+        IF_CHANGED(slot);
+        n++;
+    }
 
-    return CMD_SUCCESS;
+    return if_vty_done(vty, n);
 
 }
 
@@ -190,11 +1395,20 @@ DEFUN(interface_ethif_speed ,
     "speed (10|100|1000|10000)",
     "Set the speed of interface\n")
 {
-    int ifIndex = vty->ifindex;
+    int speed = atoi(argv[0]);
+    unsigned int pos;
+    int slot, n = 0;
 
-    eth_port[ifIndex - 1].speed = atoi(argv[0]);
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        if(iftable.speed[slot] != (unsigned int)speed)
+            ifevent_post(slot, IF_EVENT_SPEED);
+        iftable.speed[slot] = speed;
+        IF_CHANGED(slot);
+        n++;
+    }
 
-    return CMD_SUCCESS;
+    return if_vty_done(vty, n);
 
 }
 
@@ -203,13 +1417,18 @@ DEFUN(interface_flow_ctrl,
     "flow-control (enable|disable)",
     "Flow-control of interface\n")
 {     
-    int ifIndex = vty->ifindex;
-    if(argv[0][0] == 'e' || argv[0][0] == 'E')
-        eth_port[ifIndex - 1].flowctrl = 1;
-    else
-        eth_port[ifIndex - 1].flowctrl = 0;
+    int flowctrl = (argv[0][0] == 'e' || argv[0][0] == 'E');
+    unsigned int pos;
+    int slot, n = 0;
+
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        iftable.info[slot]->flowctrl = flowctrl;
+        IF_CHANGED(slot);
+        n++;
+    }
     
-    return CMD_SUCCESS;
+    return if_vty_done(vty, n);
 
 }
 
@@ -218,13 +1437,18 @@ DEFUN(interface_negotiation_enable,
     "negotiation (enable|disable)",
     "Negotiation of interface \n")
 {     
-    int ifIndex = vty->ifindex;
-    if(argv[0][0] == 'e' || argv[0][0] == 'E')
-        eth_port[ifIndex - 1].negotiation = 1;
-    else
-        eth_port[ifIndex - 1].negotiation = 0;
+    int negotiation = (argv[0][0] == 'e' || argv[0][0] == 'E');
+    unsigned int pos;
+    int slot, n = 0;
 
-    return CMD_SUCCESS;
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        iftable.info[slot]->negotiation = negotiation;
+        IF_CHANGED(slot);
+        n++;
+    }
+
+    return if_vty_done(vty, n);
 
 }
 
@@ -233,15 +1457,27 @@ DEFUN(set_port_type,
     "port link-type (access|trunk|hybrid)",
     "Set the linktype of port\n")
 {
-    int ifIndex = vty->ifindex;
+    struct vlan_bitmap old;
+    int linktype;
+    unsigned int pos;
+    int slot, n = 0;
+
     if(argv[0][0] == 'a' || argv[0][0] == 'A')
-        eth_port[ifIndex - 1].linktype = 0;
+        linktype = IF_LINK_ACCESS;
     else if(argv[0][0] == 't' || argv[0][0] == 'T')
-        eth_port[ifIndex - 1].linktype = 1;
+        linktype = IF_LINK_TRUNK;
     else
-        eth_port[ifIndex - 1].linktype = 2;
+        linktype = IF_LINK_HYBRID;
 
-    return CMD_SUCCESS;
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        if_vlan_member(slot, &old);
+        iftable.info[slot]->linktype = linktype;
+        if_vlan_changed(slot, &old);
+        n++;
+    }
+
+    return if_vty_done(vty, n);
 
 }
 
@@ -250,33 +1486,394 @@ DEFUN(add_access_port_vlan,
     "port default vlan <1-4094>",
     "Vlan property of port\n")
 {
-    int ifIndex = vty->ifindex;
+    struct vlan_bitmap old;
+    int vid = atoi(argv[0]);
+    unsigned int pos;
+    int slot, n = 0;
+
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        if_vlan_member(slot, &old);
+        iftable.def_vlan[slot] = vid;
+        if_vlan_changed(slot, &old);
+        n++;
+    }
+
+    return if_vty_done(vty, n);
+
+}
+
+/* Check that the ports the vty is configuring have link type TYPE, and
+   read the VLAN list in ARG into LIST.  Nothing is changed unless all
+   of them do. */
+static int if_vty_vlan_list(struct vty *vty, int type, const char *arg,
+    struct vlan_bitmap *list)
+{
+    unsigned int pos;
+    int slot, n = 0;
+
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        if(iftable.info[slot]->linktype != type)
+        {
+            vty_out(vty, "%% Port %s link-type is not %s%s",
+                iftable.info[slot]->name,
+                type == IF_LINK_TRUNK ? "trunk" : "hybrid", VTY_NEWLINE);
+            return -1;
+        }
+        n++;
+    }
+    if(if_vty_done(vty, n) != CMD_SUCCESS)
+        return -1;
 
-    eth_port[ifIndex - 1].def_vlan = atoi(argv[0]);
+    vlan_bitmap_zero(list);
+    if(vlan_list_parse(arg, list) < 0)
+    {
+        vty_out(vty, "%% Invalid VLAN list %s%s", arg, VTY_NEWLINE);
+        return -1;
+    }
+    return 0;
+}
+
+DEFUN(port_trunk_allow,
+    port_trunk_allow_cmd,
+    "port trunk allow-pass vlan VLANLIST",
+    "Vlan property of port\n"
+    "Trunk port\n"
+    "Allowed VLANs\n"
+    "VLAN\n"
+    "VLAN list such as 1,10-20, or all\n")
+{
+    struct vlan_bitmap list, old;
+    struct if_info *info;
+    unsigned int pos;
+    int slot;
+
+    if(if_vty_vlan_list(vty, IF_LINK_TRUNK, argv[0], &list) < 0)
+        return CMD_WARNING;
+
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        info = iftable.info[slot];
+        if_vlan_member(slot, &old);
+        vlan_bitmap_or(&info->tagged, &info->tagged, &list);
+        if_vlan_changed(slot, &old);
+    }
 
     return CMD_SUCCESS;
+}
+
+DEFUN(no_port_trunk_allow,
+    no_port_trunk_allow_cmd,
+    "no port trunk allow-pass vlan VLANLIST",
+    NO_STR
+    "Vlan property of port\n"
+    "Trunk port\n"
+    "Allowed VLANs\n"
+    "VLAN\n"
+    "VLAN list such as 1,10-20, or all\n")
+{
+    struct vlan_bitmap list, old;
+    struct if_info *info;
+    unsigned int pos;
+    int slot;
+
+    if(if_vty_vlan_list(vty, IF_LINK_TRUNK, argv[0], &list) < 0)
+        return CMD_WARNING;
 
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        info = iftable.info[slot];
+        if_vlan_member(slot, &old);
+        vlan_bitmap_andnot(&info->tagged, &info->tagged, &list);
+        if_vlan_changed(slot, &old);
+    }
+
+    return CMD_SUCCESS;
+}
+
+DEFUN(port_hybrid_vlan,
+    port_hybrid_vlan_cmd,
+    "port hybrid (tagged|untagged) vlan VLANLIST",
+    "Vlan property of port\n"
+    "Hybrid port\n"
+    "Send frames of the VLANs tagged\n"
+    "Send frames of the VLANs untagged\n"
+    "VLAN\n"
+    "VLAN list such as 1,10-20, or all\n")
+{
+    struct vlan_bitmap list, old;
+    struct if_info *info;
+    unsigned int pos;
+    int slot;
+
+    if(if_vty_vlan_list(vty, IF_LINK_HYBRID, argv[1], &list) < 0)
+        return CMD_WARNING;
+
+    /* A VLAN is sent either tagged or untagged. */
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        info = iftable.info[slot];
+        if_vlan_member(slot, &old);
+        if(argv[0][0] == 't')
+        {
+            vlan_bitmap_or(&info->tagged, &info->tagged, &list);
+            vlan_bitmap_andnot(&info->untagged, &info->untagged, &list);
+        }
+        else
+        {
+            vlan_bitmap_or(&info->untagged, &info->untagged, &list);
+            vlan_bitmap_andnot(&info->tagged, &info->tagged, &list);
+        }
+        if_vlan_changed(slot, &old);
+    }
+
+    return CMD_SUCCESS;
+}
+
+DEFUN(no_port_hybrid_vlan,
+    no_port_hybrid_vlan_cmd,
+    "no port hybrid vlan VLANLIST",
+    NO_STR
+    "Vlan property of port\n"
+    "Hybrid port\n"
+    "VLAN\n"
+    "VLAN list such as 1,10-20, or all\n")
+{
+    struct vlan_bitmap list, old;
+    struct if_info *info;
+    unsigned int pos;
+    int slot;
+
+    if(if_vty_vlan_list(vty, IF_LINK_HYBRID, argv[0], &list) < 0)
+        return CMD_WARNING;
+
+    IF_VTY_LOOP(vty, pos, slot)
+    {
+        info = iftable.info[slot];
+        if_vlan_member(slot, &old);
+        vlan_bitmap_andnot(&info->tagged, &info->tagged, &list);
+        vlan_bitmap_andnot(&info->untagged, &info->untagged, &list);
+        if_vlan_changed(slot, &old);
+    }
+
+    return CMD_SUCCESS;
+}
+
+/* What show vlan prints of a VLAN. */
+struct vlan_brief
+{
+    unsigned short vid;
+    unsigned int ports;
+    unsigned int tagged;
+    unsigned int up;
+};
+
+/* Whether the port in SLOT, a member of VID, sends it tagged. */
+static int if_vlan_tagged(int slot, int vid)
+{
+    struct if_info *info = iftable.info[slot];
+
+    return info->linktype != IF_LINK_ACCESS && VLAN_ISSET(&info->tagged, vid);
+}
+
+static void show_vlan_vty(struct vty *vty)
+{
+    struct vlan_brief *vlan;
+    unsigned long *ports, word;
+    unsigned int w, words;
+    int i, n, vid;
+
+    worker_state_lock();
+    words = iftable.size / VLAN_WORD_BITS;
+    vlan = XMALLOC(MTYPE_TMP, sizeof(struct vlan_brief) * VLAN_BITS);
+    n = 0;
+    for(vid = VLAN_ID_MIN; vid <= VLAN_ID_MAX; vid++)
+    {
+        if((ports = iftable.vlan_ports[vid]) == NULL)
+            continue;
+
+        vlan[n].vid = vid;
+        vlan[n].ports = vlan[n].tagged = vlan[n].up = 0;
+        for(w = 0; w < words; w++)
+        {
+            vlan[n].ports += __builtin_popcountl(ports[w]);
+            vlan[n].up += __builtin_popcountl(ports[w] & iftable.up_ports[w]);
+            for(word = ports[w]; word; word &= word - 1)
+                vlan[n].tagged += if_vlan_tagged(w * VLAN_WORD_BITS
+                    + __builtin_ctzl(word), vid);
+        }
+        if(vlan[n].ports)
+            n++;
+    }
+    worker_state_unlock();
+
+    vty_object_begin(vty, NULL);
+    vty_field_label(vty, 0, "  ");
+    vty_field_label(vty, 8, "VID");
+    vty_field_label(vty, 8, "Ports");
+    vty_field_label(vty, 8, "Tagged");
+    vty_field_label(vty, 0, "Up");
+    vty_field_label(vty, 0, VTY_NEWLINE);
+
+    vty_array_begin(vty, "vlans");
+    for(i = 0;i < n;i++)
+    {
+        vty_row_begin(vty);
+        vty_field_label(vty, 0, "  ");
+        vty_field_int(vty, "vid", 8, vlan[i].vid);
+        vty_field_int(vty, "ports", 8, vlan[i].ports);
+        vty_field_int(vty, "tagged", 8, vlan[i].tagged);
+        vty_field_int(vty, "up", 0, vlan[i].up);
+        vty_row_end(vty);
+    }
+    vty_array_end(vty);
+    vty_object_end(vty);
+
+    XFREE(MTYPE_TMP, vlan);
+}
+
+/* What show vlan VID prints of a member port. */
+struct vlan_port
+{
+    char *name;
+    int tagged;
+    int up;
+};
+
+static void show_vlan_ports_vty(struct vty *vty, int vid)
+{
+    struct vlan_port *port;
+    unsigned long *ports, word;
+    unsigned int w, words;
+    int i, n, slot;
+
+    worker_state_lock();
+    words = iftable.size / VLAN_WORD_BITS;
+    ports = iftable.vlan_ports[vid];
+    n = 0;
+    if(ports)
+        for(w = 0; w < words; w++)
+            n += __builtin_popcountl(ports[w]);
+    port = XMALLOC(MTYPE_TMP, sizeof(struct vlan_port) * (n + 1));
+    n = 0;
+    if(ports)
+        for(w = 0; w < words; w++)
+            for(word = ports[w]; word; word &= word - 1)
+            {
+                slot = w * VLAN_WORD_BITS + __builtin_ctzl(word);
+                port[n].name = intern_ref(iftable.info[slot]->name);
+                port[n].tagged = if_vlan_tagged(slot, vid);
+                port[n].up = (iftable.flags[slot] & IF_OPER_UP) != 0;
+                n++;
+            }
+    worker_state_unlock();
+
+    vty_object_begin(vty, NULL);
+    vty_field_label(vty, 0, "  VLAN ");
+    vty_field_int(vty, "vid", 0, vid);
+    vty_field_label(vty, 0, VTY_NEWLINE);
+    vty_field_label(vty, 0, "  ");
+    vty_field_label(vty, 18, "Interface");
+    vty_field_label(vty, 10, "Mode");
+    vty_field_label(vty, 0, "State");
+    vty_field_label(vty, 0, VTY_NEWLINE);
+
+    vty_array_begin(vty, "ports");
+    for(i = 0;i < n;i++)
+    {
+        vty_row_begin(vty);
+        vty_field_label(vty, 0, "  ");
+        vty_field_str(vty, "name", 18, port[i].name);
+        vty_field_str(vty, "mode", 10, port[i].tagged ? "tagged" : "untagged");
+        vty_field_str(vty, "operStatus", 0, port[i].up ? "up" : "down");
+        vty_row_end(vty);
+        intern_unref(port[i].name);
+    }
+    vty_array_end(vty);
+    vty_object_end(vty);
+
+    XFREE(MTYPE_TMP, port);
+}
+
+DEFUN_ATTR(show_vlan,
+    show_vlan_cmd,
+    "show vlan",
+    SHOW_STR
+    "VLAN member ports\n",
+    CMD_ATTR_READONLY)
+{
+    show_vlan_vty(vty);
+    return CMD_SUCCESS;
+}
+
+DEFUN_ATTR(show_vlan_id,
+    show_vlan_id_cmd,
+    "show vlan <1-4094>",
+    SHOW_STR
+    "VLAN member ports\n"
+    "VLAN ID\n",
+    CMD_ATTR_READONLY)
+{
+    show_vlan_ports_vty(vty, atoi(argv[0]));
+    return CMD_SUCCESS;
 }
 
 
 void nm_if_init()
 {
-    int i;
-    for(i = 0;i < MAX_ETH_PORT;i++)
+    char name[64];
+    int i, slot;
+
+    iftable.by_index = hash_create(if_index_key, if_index_cmp);
+    iftable.names = radix_new();
+    iftable.ordered = skiplist_new(if_name_cmp);
+    ifevent_init();
+    ifevent_subscribe("log", IF_EVENT_LINK, if_link_log, NULL);
+    ifnl_init();
+
+    for(i = 0;i < IF_DEFAULT_PORTS;i++)
     {
-        eth_port[i].unit = i+4096;
-        eth_port[i].admin_status = 1;
-        eth_port[i].oper_status = 1;
-        eth_port[i].def_vlan = 1;
-        sprintf(eth_port[i].name,"ge1/0/%d",i+1);
-        sprintf(eth_port[i].desc,"-");
+        sprintf(name,"ge1/0/%d",i+1);
+        slot = if_create(i+1, name);
+        iftable.info[slot]->unit = i+4096;
     }
+    ifshm_init();
     
     install_element (VIEW_NODE, &show_interface_cmd);
     install_element (ENABLE_NODE, &show_interface_cmd);
     install_element (CONFIG_NODE, &show_interface_cmd);
+    install_element (VIEW_NODE, &show_interface_json_cmd);
+    install_element (ENABLE_NODE, &show_interface_json_cmd);
+    install_element (CONFIG_NODE, &show_interface_json_cmd);
+    install_element (VIEW_NODE, &show_interface_name_cmd);
+    install_element (ENABLE_NODE, &show_interface_name_cmd);
+    install_element (CONFIG_NODE, &show_interface_name_cmd);
+    install_element (VIEW_NODE, &show_interface_counters_cmd);
+    install_element (ENABLE_NODE, &show_interface_counters_cmd);
+    install_element (CONFIG_NODE, &show_interface_counters_cmd);
+    install_element (VIEW_NODE, &show_interface_counters_rate_cmd);
+    install_element (ENABLE_NODE, &show_interface_counters_rate_cmd);
+    install_element (CONFIG_NODE, &show_interface_counters_rate_cmd);
+    install_element (VIEW_NODE, &show_interface_history_cmd);
+    install_element (ENABLE_NODE, &show_interface_history_cmd);
+    install_element (CONFIG_NODE, &show_interface_history_cmd);
+    install_element (VIEW_NODE, &show_interface_history_export_cmd);
+    install_element (ENABLE_NODE, &show_interface_history_export_cmd);
+    install_element (CONFIG_NODE, &show_interface_history_export_cmd);
+    install_element (VIEW_NODE, &show_vlan_cmd);
+    install_element (ENABLE_NODE, &show_vlan_cmd);
+    install_element (CONFIG_NODE, &show_vlan_cmd);
+    install_element (VIEW_NODE, &show_vlan_id_cmd);
+    install_element (ENABLE_NODE, &show_vlan_id_cmd);
+    install_element (CONFIG_NODE, &show_vlan_id_cmd);
     install_element (CONFIG_NODE, &config_one_if_cmd);
+    install_element (CONFIG_NODE, &config_if_name_cmd);
+    install_element (CONFIG_NODE, &no_config_if_name_cmd);
+    install_element (CONFIG_NODE, &config_if_range_cmd);
+    install_completion ("IFNAME", if_name_complete);
 
+    install_element (INTERFACE_NODE, &no_config_if_name_cmd);
     install_element (INTERFACE_NODE, &interface_mtu_cmd);
     install_element (INTERFACE_NODE, &interface_desc_cmd);
     install_element (INTERFACE_NODE, &shutdown_if_cmd);
@@ -287,6 +1884,10 @@ void nm_if_init()
     install_element (INTERFACE_NODE, &interface_duplex_mode_cmd);
     install_element (INTERFACE_NODE, &set_port_type_cmd);
     install_element (INTERFACE_NODE, &add_access_port_vlan_cmd);
+    install_element (INTERFACE_NODE, &port_trunk_allow_cmd);
+    install_element (INTERFACE_NODE, &no_port_trunk_allow_cmd);
+    install_element (INTERFACE_NODE, &port_hybrid_vlan_cmd);
+    install_element (INTERFACE_NODE, &no_port_hybrid_vlan_cmd);
     install_element (INTERFACE_NODE, &config_quit_cmd);
     
 }
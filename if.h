@@ -0,0 +1,124 @@
+/* Interface table.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_IF_H
+#define _ZEBRA_IF_H
+
+#include "vlan.h"
+
+/* Front panel ports created at startup. */
+#define IF_DEFAULT_PORTS 12
+
+/* Link types. */
+#define IF_LINK_ACCESS  0
+#define IF_LINK_TRUNK   1
+#define IF_LINK_HYBRID  2
+
+/* Interface flags. */
+#define IF_USED      0x01
+#define IF_ADMIN_UP  0x02
+#define IF_OPER_UP   0x04
+
+/* Descriptive state of an interface, which only configuration and
+   detailed output look at. */
+struct if_info
+{
+  unsigned int ifindex;
+  int slot;
+  int unit;
+
+  /* Interned strings. */
+  char *name;
+  char *desc;
+
+  int negotiation;
+  int duplex;
+  int linktype;
+  int flowctrl;
+
+  /* VLANs sent tagged and untagged.  A trunk carries its allowed VLANs
+     tagged, an access port only its default VLAN, untagged. */
+  struct vlan_bitmap tagged;
+  struct vlan_bitmap untagged;
+};
+
+/* The interface table.  An interface is a slot; state which is looked
+   at for many interfaces at a time is kept in an array per field,
+   indexed by slot, the rest is in the slot's struct if_info.  Changes
+   are made with the worker state lock held. */
+struct if_table
+{
+  /* Slots allocated, slots up to the last one used, interfaces, and
+     no free slot below HINT. */
+  unsigned int size;
+  unsigned int max;
+  unsigned int count;
+  unsigned int hint;
+
+  unsigned char *flags;
+  unsigned int *mtu;
+  unsigned int *speed;
+  unsigned short *def_vlan;
+
+  /* Bit per slot whose port is operationally up, kept with IF_OPER_UP
+     by if_set_oper (). */
+  unsigned long *up_ports;
+
+  struct if_info **info;
+
+  /* Generation of each slot, bumped by IF_CHANGED () whenever anything
+     of its port changes, so that what was made of the port can be
+     told from stale. */
+  unsigned int *gen;
+
+  /* struct if_info by ifindex, and by name in a radix tree which also
+     completes names. */
+  struct hash *by_index;
+  struct radix *names;
+
+  /* struct if_info in the order of names, numbers in them by value,
+     which is the order ports are shown in. */
+  struct skiplist *ordered;
+
+  /* Member ports of each VLAN, a bit per slot, or NULL while a VLAN
+     never had one. */
+  unsigned long *vlan_ports[VLAN_BITS];
+};
+
+extern struct if_table iftable;
+
+/* Walk the slots S which hold an interface. */
+#define IF_LOOP(S) \
+  for ((S) = 0; (S) < (int) iftable.max; (S)++) \
+    if (iftable.flags[(S)] & IF_USED)
+
+#define IF_CHANGED(S) (iftable.gen[(S)]++)
+
+/* Prototypes. */
+int if_create (unsigned int, const char *);
+void if_delete (int);
+int if_lookup_by_index (unsigned int);
+int if_lookup_by_name (const char *);
+void if_set_oper (int, int);
+void if_vlan_member (int, struct vlan_bitmap *);
+int if_vlan_flood (unsigned short, int, unsigned long *);
+void if_counters_sample (void);
+
+#endif /* _ZEBRA_IF_H */
@@ -0,0 +1,356 @@
+/* Interface event bus.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "command.h"
+#include "memory.h"
+#include "log.h"
+#include "linklist.h"
+#include "worker.h"
+#include "if.h"
+#include "ifevent.h"
+
+struct ifevent_sub
+{
+  const char *name;
+  unsigned int mask;
+  ifevent_func func;
+  void *arg;
+  unsigned long delivered;
+};
+
+/* A batch: the entries and the slot each was posted for. */
+struct ifevent_batch
+{
+  struct ifevent *ev;
+  int *slot;
+  unsigned int count;
+  unsigned int size;
+};
+
+/* Subscribers, only added to at startup. */
+static struct list *ifevent_subs;
+
+/* What follows is guarded by ifevent_mtx.  The batch being gathered,
+   the entry of each slot in it plus one, and when its first change was
+   posted.  SPARE is the batch delivered last, kept for reuse. */
+static pthread_mutex_t ifevent_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct ifevent_batch ifevent_cur;
+static struct ifevent_batch ifevent_spare;
+static unsigned int *ifevent_entry;
+static unsigned int ifevent_entry_size;
+static long ifevent_start;
+static unsigned int ifevent_window = IF_EVENT_WINDOW_DEFAULT;
+
+/* The eventfd has been written and not read since. */
+static int ifevent_signalled;
+static int ifevent_efd = -1;
+
+static unsigned long ifevent_posted;
+static unsigned long ifevent_coalesced;
+static unsigned long ifevent_batches;
+static unsigned int ifevent_largest;
+
+/* Milliseconds of the monotonic clock. */
+static long
+ifevent_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+int
+ifevent_fd (void)
+{
+  return ifevent_efd;
+}
+
+/* Have FUNC called with ARG for the changes in MASK, NAME says who
+   for. */
+void
+ifevent_subscribe (const char *name, unsigned int mask, ifevent_func func,
+                   void *arg)
+{
+  struct ifevent_sub *sub;
+
+  sub = XCALLOC (MTYPE_IF_EVENT, sizeof (struct ifevent_sub));
+  sub->name = name;
+  sub->mask = mask;
+  sub->func = func;
+  sub->arg = arg;
+  listnode_add (ifevent_subs, sub);
+}
+
+static void
+ifevent_batch_grow (struct ifevent_batch *b)
+{
+  b->size = b->size ? b->size * 2 : 64;
+  b->ev = XREALLOC (MTYPE_IF_EVENT, b->ev, sizeof (struct ifevent) * b->size);
+  b->slot = XREALLOC (MTYPE_IF_EVENT, b->slot, sizeof (int) * b->size);
+}
+
+/* Post the changes EVENTS of the port in SLOT, with the worker state
+   lock held.  A port already in the batch only has them added to its
+   entry, so a port flapping within the window costs one entry. */
+void
+ifevent_post (int slot, unsigned int events)
+{
+  struct ifevent_batch *b = &ifevent_cur;
+  unsigned int ifindex = iftable.info[slot]->ifindex;
+  unsigned int size, i;
+  uint64_t one = 1;
+
+  pthread_mutex_lock (&ifevent_mtx);
+  ifevent_posted++;
+
+  if ((unsigned int) slot >= ifevent_entry_size)
+    {
+      size = ifevent_entry_size ? ifevent_entry_size : 64;
+      while ((unsigned int) slot >= size)
+        size *= 2;
+      ifevent_entry = XREALLOC (MTYPE_IF_EVENT, ifevent_entry,
+                                sizeof (unsigned int) * size);
+      memset (ifevent_entry + ifevent_entry_size, 0,
+              sizeof (unsigned int) * (size - ifevent_entry_size));
+      ifevent_entry_size = size;
+    }
+
+  /* The slot may have been given to another port meanwhile, which
+     gets an entry of its own. */
+  i = ifevent_entry[slot];
+  if (i && b->ev[i - 1].ifindex == ifindex)
+    {
+      b->ev[i - 1].events |= events;
+      ifevent_coalesced++;
+      pthread_mutex_unlock (&ifevent_mtx);
+      return;
+    }
+
+  if (b->count == b->size)
+    ifevent_batch_grow (b);
+  b->ev[b->count].ifindex = ifindex;
+  b->ev[b->count].events = events;
+  b->slot[b->count] = slot;
+  ifevent_entry[slot] = ++b->count;
+
+  if (b->count == 1)
+    {
+      ifevent_start = ifevent_now ();
+      if (! ifevent_signalled && ifevent_efd >= 0)
+        {
+          ifevent_signalled = 1;
+          write (ifevent_efd, &one, sizeof (one));
+        }
+    }
+  pthread_mutex_unlock (&ifevent_mtx);
+}
+
+/* Milliseconds until the batch is due, at most MAX. */
+int
+ifevent_timeout (int max)
+{
+  long left;
+
+  pthread_mutex_lock (&ifevent_mtx);
+  if (ifevent_cur.count == 0)
+    left = max;
+  else
+    left = ifevent_start + ifevent_window - ifevent_now ();
+  pthread_mutex_unlock (&ifevent_mtx);
+
+  if (left < 0)
+    return 0;
+  return left < max ? left : max;
+}
+
+/* Deliver the batch when it is due, called by the main loop. */
+void
+ifevent_run (void)
+{
+  struct ifevent_batch b;
+  struct ifevent_sub *sub;
+  struct listnode *node;
+  struct ifevent *ev;
+  uint64_t v;
+  unsigned int i;
+  int n;
+
+  pthread_mutex_lock (&ifevent_mtx);
+  if (ifevent_signalled)
+    {
+      read (ifevent_efd, &v, sizeof (v));
+      ifevent_signalled = 0;
+    }
+  if (ifevent_cur.count == 0
+      || ifevent_now () - ifevent_start < (long) ifevent_window)
+    {
+      pthread_mutex_unlock (&ifevent_mtx);
+      return;
+    }
+
+  b = ifevent_cur;
+  ifevent_cur = ifevent_spare;
+  ifevent_cur.count = 0;
+  for (i = 0; i < b.count; i++)
+    ifevent_entry[b.slot[i]] = 0;
+  ifevent_batches++;
+  if (b.count > ifevent_largest)
+    ifevent_largest = b.count;
+  pthread_mutex_unlock (&ifevent_mtx);
+
+  ev = XMALLOC (MTYPE_TMP, sizeof (struct ifevent) * b.count);
+
+  worker_state_lock ();
+  LIST_LOOP (ifevent_subs, sub, node)
+    {
+      for (i = 0, n = 0; i < b.count; i++)
+        if (b.ev[i].events & sub->mask)
+          {
+            ev[n].ifindex = b.ev[i].ifindex;
+            ev[n].events = b.ev[i].events & sub->mask;
+            n++;
+          }
+      if (n == 0)
+        continue;
+      (*sub->func) (ev, n, sub->arg);
+      sub->delivered += n;
+    }
+  worker_state_unlock ();
+
+  XFREE (MTYPE_TMP, ev);
+
+  pthread_mutex_lock (&ifevent_mtx);
+  ifevent_spare = b;
+  pthread_mutex_unlock (&ifevent_mtx);
+}
+
+void
+ifevent_window_set (unsigned int ms)
+{
+  pthread_mutex_lock (&ifevent_mtx);
+  ifevent_window = ms;
+  pthread_mutex_unlock (&ifevent_mtx);
+}
+
+DEFUN (interface_event_window,
+       interface_event_window_cmd,
+       "interface event-window <0-10000>",
+       "Select an interface to configure\n"
+       "Time changes of ports are gathered for before they are delivered\n"
+       "Milliseconds, default 100\n")
+{
+  ifevent_window_set (atoi (argv[0]));
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_interface_event_window,
+       no_interface_event_window_cmd,
+       "no interface event-window",
+       NO_STR
+       "Select an interface to configure\n"
+       "Time changes of ports are gathered for before they are delivered\n")
+{
+  ifevent_window_set (IF_EVENT_WINDOW_DEFAULT);
+  return CMD_SUCCESS;
+}
+
+DEFUN_ATTR (show_interface_events,
+       show_interface_events_cmd,
+       "show interface events",
+       SHOW_STR
+       "The information of specify interface\n"
+       "Port change events\n",
+       CMD_ATTR_READONLY)
+{
+  struct ifevent_sub *sub;
+  struct listnode *node;
+  unsigned long posted, coalesced, batches;
+  unsigned int window, pending, largest;
+
+  pthread_mutex_lock (&ifevent_mtx);
+  window = ifevent_window;
+  pending = ifevent_cur.count;
+  posted = ifevent_posted;
+  coalesced = ifevent_coalesced;
+  batches = ifevent_batches;
+  largest = ifevent_largest;
+  pthread_mutex_unlock (&ifevent_mtx);
+
+  vty_object_begin (vty, NULL);
+  vty_field_label (vty, 20, "Window(ms):");
+  vty_field_int (vty, "window", 0, window);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 20, "Pending ports:");
+  vty_field_int (vty, "pending", 0, pending);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 20, "Changes posted:");
+  vty_field_int (vty, "posted", 0, posted);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 20, "Changes coalesced:");
+  vty_field_int (vty, "coalesced", 0, coalesced);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 20, "Batches:");
+  vty_field_int (vty, "batches", 0, batches);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 20, "Largest batch:");
+  vty_field_int (vty, "largest", 0, largest);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+
+  vty_field_label (vty, 20, "Subscriber");
+  vty_field_label (vty, 8, "Mask");
+  vty_field_label (vty, 0, "Delivered");
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_array_begin (vty, "subscribers");
+  LIST_LOOP (ifevent_subs, sub, node)
+    {
+      vty_row_begin (vty);
+      vty_field_str (vty, "name", 20, sub->name);
+      vty_field_int (vty, "mask", 8, sub->mask);
+      vty_field_int (vty, "delivered", 0,
+                     __atomic_load_n (&sub->delivered, __ATOMIC_RELAXED));
+      vty_row_end (vty);
+    }
+  vty_array_end (vty);
+  vty_object_end (vty);
+  return CMD_SUCCESS;
+}
+
+void
+ifevent_init (void)
+{
+  ifevent_subs = list_new ();
+
+  ifevent_efd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ifevent_efd < 0)
+    zlog_warn ("interface events: eventfd: %s", strerror (errno));
+
+  install_element (CONFIG_NODE, &interface_event_window_cmd);
+  install_element (CONFIG_NODE, &no_interface_event_window_cmd);
+  install_element (VIEW_NODE, &show_interface_events_cmd);
+  install_element (ENABLE_NODE, &show_interface_events_cmd);
+  install_element (CONFIG_NODE, &show_interface_events_cmd);
+}
@@ -0,0 +1,65 @@
+/* Interface event bus.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_IFEVENT_H
+#define _ZEBRA_IFEVENT_H
+
+/* Changes of a port are posted from wherever they happen and gathered
+   per port: a port which changes again before its batch is delivered
+   only has the new kinds of change added to its entry.  The batch is
+   delivered by the main loop once the window has passed since its
+   first change, each subscriber getting the entries it asked for all
+   at once.  An eventfd wakes the main loop up for the first change. */
+
+/* Kinds of change. */
+#define IF_EVENT_LINK     0x01
+#define IF_EVENT_SPEED    0x02
+#define IF_EVENT_VLAN     0x04
+#define IF_EVENT_CREATE   0x08
+#define IF_EVENT_DELETE   0x10
+#define IF_EVENT_MTU      0x20
+#define IF_EVENT_DESC     0x40
+#define IF_EVENT_ALL      0x7f
+
+/* Default window in milliseconds. */
+#define IF_EVENT_WINDOW_DEFAULT 100
+
+/* The changes of a port in a batch. */
+struct ifevent
+{
+  unsigned int ifindex;
+  unsigned int events;
+};
+
+/* Called with the N entries of a batch the subscriber asked for, in
+   the order the ports first changed, with the worker state lock
+   held. */
+typedef void (*ifevent_func) (const struct ifevent *, int, void *);
+
+/* Prototypes. */
+void ifevent_init (void);
+int ifevent_fd (void);
+void ifevent_subscribe (const char *, unsigned int, ifevent_func, void *);
+void ifevent_post (int, unsigned int);
+int ifevent_timeout (int);
+void ifevent_run (void);
+void ifevent_window_set (unsigned int);
+
+#endif /* _ZEBRA_IFEVENT_H */
@@ -0,0 +1,950 @@
+/* Interface table mirrored onto kernel network devices.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/veth.h>
+
+#include "command.h"
+#include "memory.h"
+#include "log.h"
+#include "hash.h"
+#include "radix.h"
+#include "intern.h"
+#include "ioloop.h"
+#include "worker.h"
+#include "if.h"
+#include "ifevent.h"
+#include "ifstat.h"
+#include "ifnetlink.h"
+
+/* Replies are read this many bytes at a time, a dump's parts are
+   smaller. */
+#define IFNL_BUF_SIZE    65536
+
+/* Requests are sent this many bytes at a time, well within the
+   socket's send buffer, and the longest a request gets. */
+#define IFNL_BATCH_SIZE  32768
+#define IFNL_MSG_MAX     1024
+#define IFNL_BATCH_MSGS \
+  (IFNL_BATCH_SIZE / NLMSG_SPACE (sizeof (struct ifinfomsg)))
+
+/* Longest device description plus one, IFALIASZ of <linux/if.h>,
+   which can't be had along with <net/if.h>. */
+#define IFNL_ALIAS_SIZE  256
+
+/* Room for the link events of thousands of ports changing at once. */
+#define IFNL_RCVBUF      (4 * 1024 * 1024)
+
+/* The device of a port. */
+struct ifnl_port
+{
+  unsigned int ifindex;
+  char kname[IFNAMSIZ];
+
+  /* The device as last heard of, or as last asked for, KINDEX is 0
+     while there is none.  KALIAS is interned. */
+  int kindex;
+  unsigned int kflags;
+  unsigned int kmtu;
+  char *kalias;
+
+  /* The device has been asked for and not heard of yet. */
+  int creating;
+
+  /* The device was heard of and may need fixing. */
+  int dirty;
+
+  /* Counters of the device KSTATS_INDEX as last heard of, the traffic
+     since is added to the port's. */
+  int kstats_index;
+  unsigned long kstats[IFSTAT_MAX];
+};
+
+/* Socket for requests and socket of the link multicast group, both -1
+   while disabled. */
+static int ifnl_req = -1;
+static int ifnl_mc = -1;
+static unsigned int ifnl_seq;
+
+/* Kind of device made for ports which have none, or NULL. */
+static const char *ifnl_create;
+
+/* Ports by ifindex and by device name. */
+static struct hash *ifnl_ports;
+static struct radix *ifnl_names;
+
+/* A request of the batch: its port, and the state of the device once
+   it's done.  ALIAS is interned. */
+struct ifnl_request
+{
+  unsigned int ifindex;
+  int create;
+  int failed;
+  unsigned int flags;
+  unsigned int mtu;
+  char *alias;
+};
+
+/* Requests not sent yet. */
+static char *ifnl_batch;
+static size_t ifnl_batch_len;
+static struct nlmsghdr *ifnl_batch_last;
+static unsigned int ifnl_batch_first;
+static unsigned int ifnl_batch_count;
+static struct ifnl_request ifnl_batch_req[IFNL_BATCH_MSGS];
+
+static char *ifnl_rbuf;
+
+/* Ports heard of while reading, by ifindex.  They are fixed once the
+   read is over, as sending from within it would reuse the receive
+   buffer. */
+static unsigned int *ifnl_dirty;
+static unsigned int ifnl_dirty_count;
+static unsigned int ifnl_dirty_size;
+
+static unsigned long ifnl_requests;
+static unsigned long ifnl_sends;
+static unsigned long ifnl_errors;
+static unsigned long ifnl_events;
+static unsigned long ifnl_dumps;
+static unsigned long ifnl_overruns;
+static long ifnl_reconcile_ms;
+
+static unsigned int
+ifnl_port_key (void *data)
+{
+  return ((struct ifnl_port *) data)->ifindex;
+}
+
+static int
+ifnl_port_cmp (void *a, void *b)
+{
+  struct ifnl_port *pa = a;
+  struct ifnl_port *pb = b;
+
+  return pa->ifindex == pb->ifindex;
+}
+
+/* Device name of port NAME, -1 when it's too long for one. */
+static int
+ifnl_kname (const char *name, char *kname)
+{
+  size_t i, len = strlen (name);
+
+  if (len >= IFNAMSIZ)
+    return -1;
+  for (i = 0; i <= len; i++)
+    kname[i] = name[i] == '/' ? '-' : name[i];
+  return 0;
+}
+
+static void
+ifnl_port_free (void *data)
+{
+  struct ifnl_port *port = data;
+
+  radix_delete (ifnl_names, port->kname);
+  if (port->kalias)
+    intern_unref (port->kalias);
+  XFREE (MTYPE_IF_NETLINK, port);
+}
+
+/* The device of the port in SLOT, made up when the port is new or was
+   renamed. */
+static struct ifnl_port *
+ifnl_port_get (int slot)
+{
+  struct if_info *info = iftable.info[slot];
+  struct ifnl_port key;
+  struct ifnl_port *port;
+  char kname[IFNAMSIZ];
+
+  if (ifnl_kname (info->name, kname) < 0)
+    return NULL;
+
+  key.ifindex = info->ifindex;
+  port = hash_lookup (ifnl_ports, &key);
+  if (port && strcmp (port->kname, kname) == 0)
+    return port;
+  if (port)
+    ifnl_port_free (hash_release (ifnl_ports, port));
+
+  port = XCALLOC (MTYPE_IF_NETLINK, sizeof (struct ifnl_port));
+  port->ifindex = info->ifindex;
+  strcpy (port->kname, kname);
+  if (radix_insert (ifnl_names, kname, port) < 0)
+    {
+      /* Another port has the name. */
+      XFREE (MTYPE_IF_NETLINK, port);
+      return NULL;
+    }
+  hash_get (ifnl_ports, port, hash_alloc_intern);
+  return port;
+}
+
+/* Milliseconds of the monotonic clock. */
+static long
+ifnl_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/* Add attribute TYPE to request H. */
+static struct rtattr *
+ifnl_attr (struct nlmsghdr *h, int type, const void *data, size_t len)
+{
+  struct rtattr *rta;
+
+  rta = (struct rtattr *) ((char *) h + NLMSG_ALIGN (h->nlmsg_len));
+  rta->rta_type = type;
+  rta->rta_len = RTA_LENGTH (len);
+  if (len)
+    memcpy (RTA_DATA (rta), data, len);
+  h->nlmsg_len = NLMSG_ALIGN (h->nlmsg_len) + RTA_ALIGN (rta->rta_len);
+  return rta;
+}
+
+/* End attribute NEST of H, which holds those added since. */
+static void
+ifnl_nest_end (struct nlmsghdr *h, struct rtattr *nest)
+{
+  nest->rta_len = (char *) h + h->nlmsg_len - (char *) nest;
+}
+
+static void ifnl_flush (void);
+
+/* Start a request of the port IFINDEX in the batch. */
+static struct nlmsghdr *
+ifnl_msg (unsigned int ifindex, int flags)
+{
+  struct ifnl_request *req;
+  struct nlmsghdr *h;
+
+  if (ifnl_batch_len + IFNL_MSG_MAX > IFNL_BATCH_SIZE)
+    ifnl_flush ();
+
+  h = (struct nlmsghdr *) (ifnl_batch + ifnl_batch_len);
+  memset (h, 0, NLMSG_SPACE (sizeof (struct ifinfomsg)));
+  h->nlmsg_len = NLMSG_LENGTH (sizeof (struct ifinfomsg));
+  h->nlmsg_type = RTM_NEWLINK;
+  h->nlmsg_flags = NLM_F_REQUEST | flags;
+  h->nlmsg_seq = ++ifnl_seq;
+  if (ifnl_batch_len == 0)
+    ifnl_batch_first = h->nlmsg_seq;
+
+  req = &ifnl_batch_req[ifnl_batch_count];
+  memset (req, 0, sizeof (struct ifnl_request));
+  req->ifindex = ifindex;
+  req->create = (flags & NLM_F_CREATE) != 0;
+  return h;
+}
+
+static void
+ifnl_msg_end (struct nlmsghdr *h)
+{
+  ifnl_batch_len += NLMSG_ALIGN (h->nlmsg_len);
+  ifnl_batch_last = h;
+  ifnl_batch_count++;
+  ifnl_requests++;
+}
+
+/* Say why request SEQ of the batch failed. */
+static void
+ifnl_error (unsigned int seq, int error)
+{
+  struct ifnl_request *req;
+  const char *name = "?";
+  int slot;
+
+  ifnl_errors++;
+  if (seq - ifnl_batch_first < ifnl_batch_count)
+    {
+      req = &ifnl_batch_req[seq - ifnl_batch_first];
+      req->failed = 1;
+      slot = if_lookup_by_index (req->ifindex);
+      if (slot >= 0)
+        name = iftable.info[slot]->name;
+    }
+  zlog_warn ("Interface %s: kernel refused the change: %s", name,
+             strerror (-error));
+}
+
+/* Read the answers to request SEQ, passing links to FUNC, until its
+   ack or end.  Requests before it are only answered when they
+   failed.  Returns -1 when the answers can't be read. */
+static int
+ifnl_recv (unsigned int seq, void (*func) (struct nlmsghdr *))
+{
+  struct nlmsghdr *h;
+  struct nlmsgerr *err;
+  int len;
+
+  while (1)
+    {
+      len = recv (ifnl_req, ifnl_rbuf, IFNL_BUF_SIZE, 0);
+      if (len < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          zlog_warn ("netlink: %s", strerror (errno));
+          return -1;
+        }
+
+      for (h = (struct nlmsghdr *) ifnl_rbuf; NLMSG_OK (h, len);
+           h = NLMSG_NEXT (h, len))
+        {
+          if (h->nlmsg_type == NLMSG_ERROR)
+            {
+              err = NLMSG_DATA (h);
+              if (err->error)
+                ifnl_error (h->nlmsg_seq, err->error);
+              if (h->nlmsg_seq == seq)
+                return 0;
+            }
+          else if (h->nlmsg_type == NLMSG_DONE)
+            {
+              if (h->nlmsg_seq == seq)
+                return 0;
+            }
+          else if (func && h->nlmsg_seq == seq)
+            (*func) (h);
+        }
+    }
+}
+
+/* Take what the requests of the batch which were done asked for as
+   the state of their devices.  The others are asked for again the next
+   time their ports are synced. */
+static void
+ifnl_batch_done (int answered)
+{
+  struct ifnl_request *req;
+  struct ifnl_port key;
+  struct ifnl_port *port;
+  unsigned int i;
+
+  for (i = 0; i < ifnl_batch_count; i++)
+    {
+      req = &ifnl_batch_req[i];
+      key.ifindex = req->ifindex;
+      port = hash_lookup (ifnl_ports, &key);
+      if (port && (! answered || req->failed))
+        {
+          if (req->create)
+            port->creating = 0;
+        }
+      else if (port && ! req->create)
+        {
+          port->kflags = (port->kflags & ~IFF_UP) | req->flags;
+          port->kmtu = req->mtu;
+          if (port->kalias)
+            intern_unref (port->kalias);
+          port->kalias = intern_ref (req->alias);
+        }
+      if (req->alias)
+        intern_unref (req->alias);
+    }
+  ifnl_batch_count = 0;
+  ifnl_batch_len = 0;
+}
+
+/* Send the batch, with an ack asked for its last request only. */
+static void
+ifnl_flush (void)
+{
+  struct sockaddr_nl snl;
+  int answered = 0;
+
+  if (ifnl_batch_len == 0)
+    return;
+
+  ifnl_batch_last->nlmsg_flags |= NLM_F_ACK;
+  memset (&snl, 0, sizeof (snl));
+  snl.nl_family = AF_NETLINK;
+  if (sendto (ifnl_req, ifnl_batch, ifnl_batch_len, 0,
+              (struct sockaddr *) &snl, sizeof (snl)) < 0)
+    {
+      zlog_warn ("netlink: %s", strerror (errno));
+      ifnl_errors++;
+    }
+  else
+    {
+      ifnl_sends++;
+      answered = ifnl_recv (ifnl_batch_last->nlmsg_seq, NULL) == 0;
+    }
+  ifnl_batch_done (answered);
+}
+
+/* Add what it takes to make the device of the port in SLOT match the
+   port to the batch. */
+static void
+ifnl_sync (struct ifnl_port *port, int slot)
+{
+  struct if_info *info = iftable.info[slot];
+  struct ifinfomsg *ifi;
+  struct ifinfomsg peer_ifi;
+  struct nlmsghdr *h;
+  struct rtattr *linkinfo;
+  struct rtattr *data;
+  struct rtattr *peer;
+  struct ifnl_request *req;
+  char peer_name[IFNAMSIZ];
+  char alias[IFNL_ALIAS_SIZE];
+  unsigned int up, mtu;
+  size_t len;
+
+  up = (iftable.flags[slot] & IF_ADMIN_UP) ? IFF_UP : 0;
+  mtu = iftable.mtu[slot] - IFNL_MTU_OVERHEAD;
+  if (mtu < IFNL_MTU_MIN)
+    mtu = IFNL_MTU_MIN;
+  snprintf (alias, sizeof (alias), "%s",
+            strcmp (info->desc, "-") ? info->desc : "");
+
+  if (port->kindex == 0)
+    {
+      if (ifnl_create == NULL || port->creating)
+        return;
+
+      h = ifnl_msg (port->ifindex, NLM_F_CREATE | NLM_F_EXCL);
+      ifi = NLMSG_DATA (h);
+      ifi->ifi_flags = up;
+      ifi->ifi_change = IFF_UP;
+      ifnl_attr (h, IFLA_IFNAME, port->kname, strlen (port->kname) + 1);
+      ifnl_attr (h, IFLA_MTU, &mtu, sizeof (mtu));
+      linkinfo = ifnl_attr (h, IFLA_LINKINFO, NULL, 0);
+      ifnl_attr (h, IFLA_INFO_KIND, ifnl_create, strlen (ifnl_create));
+      len = strlen (port->kname);
+      if (strcmp (ifnl_create, "veth") == 0 && len + 1 < IFNAMSIZ)
+        {
+          /* The peer is the far end of the port's link. */
+          memcpy (peer_name, port->kname, len);
+          strcpy (peer_name + len, "p");
+          memset (&peer_ifi, 0, sizeof (peer_ifi));
+          data = ifnl_attr (h, IFLA_INFO_DATA, NULL, 0);
+          peer = ifnl_attr (h, VETH_INFO_PEER, &peer_ifi, sizeof (peer_ifi));
+          ifnl_attr (h, IFLA_IFNAME, peer_name, strlen (peer_name) + 1);
+          ifnl_nest_end (h, peer);
+          ifnl_nest_end (h, data);
+        }
+      ifnl_nest_end (h, linkinfo);
+      ifnl_msg_end (h);
+
+      /* The description is set once the device is heard of. */
+      port->creating = 1;
+      return;
+    }
+
+  if ((port->kflags & IFF_UP) == up && port->kmtu == mtu
+      && strcmp (port->kalias ? port->kalias : "", alias) == 0)
+    return;
+
+  h = ifnl_msg (port->ifindex, 0);
+  ifi = NLMSG_DATA (h);
+  ifi->ifi_index = port->kindex;
+  ifi->ifi_flags = up;
+  ifi->ifi_change = IFF_UP;
+  if (port->kmtu != mtu)
+    ifnl_attr (h, IFLA_MTU, &mtu, sizeof (mtu));
+  if (strcmp (port->kalias ? port->kalias : "", alias) != 0)
+    ifnl_attr (h, IFLA_IFALIAS, alias, strlen (alias));
+
+  /* Taken as the device's state once the batch is acked. */
+  req = &ifnl_batch_req[ifnl_batch_count];
+  req->flags = up;
+  req->mtu = mtu;
+  req->alias = intern (alias);
+  ifnl_msg_end (h);
+}
+
+/* Add the traffic the device of the port in SLOT saw since it was
+   last heard of, from its counters STATS, to the port's counters. */
+static void
+ifnl_stats (struct ifnl_port *port, int slot, int kindex,
+            const struct rtnl_link_stats64 *stats)
+{
+  unsigned long c[IFSTAT_MAX];
+  int i;
+
+  c[IFSTAT_RX_PACKETS] = stats->rx_packets;
+  c[IFSTAT_RX_BYTES] = stats->rx_bytes;
+  c[IFSTAT_RX_ERRORS] = stats->rx_errors;
+  c[IFSTAT_RX_DROPS] = stats->rx_dropped;
+  c[IFSTAT_TX_PACKETS] = stats->tx_packets;
+  c[IFSTAT_TX_BYTES] = stats->tx_bytes;
+  c[IFSTAT_TX_ERRORS] = stats->tx_errors;
+  c[IFSTAT_TX_DROPS] = stats->tx_dropped;
+
+  /* A new device starts from what it has. */
+  if (port->kstats_index == kindex)
+    for (i = 0; i < IFSTAT_MAX; i++)
+      if (c[i] > port->kstats[i])
+        ifstat_add (slot, i, c[i] - port->kstats[i]);
+
+  port->kstats_index = kindex;
+  memcpy (port->kstats, c, sizeof (c));
+}
+
+/* A device as the kernel has it, from a dump or an event. */
+static void
+ifnl_link (struct nlmsghdr *h)
+{
+  struct ifinfomsg *ifi = NLMSG_DATA (h);
+  struct ifnl_port *port;
+  struct rtattr *rta;
+  struct rtnl_link_stats64 stats;
+  const char *name = NULL;
+  char alias[IFNL_ALIAS_SIZE] = "";
+  unsigned int mtu = 0;
+  int len, slot, changed, has_stats = 0;
+
+  if (h->nlmsg_type != RTM_NEWLINK && h->nlmsg_type != RTM_DELLINK)
+    return;
+
+  len = IFLA_PAYLOAD (h);
+  for (rta = IFLA_RTA (ifi); RTA_OK (rta, len); rta = RTA_NEXT (rta, len))
+    switch (rta->rta_type)
+      {
+      case IFLA_IFNAME:
+        name = RTA_DATA (rta);
+        break;
+      case IFLA_MTU:
+        mtu = *(unsigned int *) RTA_DATA (rta);
+        break;
+      case IFLA_IFALIAS:
+        snprintf (alias, sizeof (alias), "%.*s", (int) RTA_PAYLOAD (rta),
+                  (char *) RTA_DATA (rta));
+        break;
+      case IFLA_STATS64:
+        /* Older kernels send less of it, and it may be unaligned. */
+        memset (&stats, 0, sizeof (stats));
+        memcpy (&stats, RTA_DATA (rta),
+                RTA_PAYLOAD (rta) < sizeof (stats)
+                ? RTA_PAYLOAD (rta) : sizeof (stats));
+        has_stats = 1;
+        break;
+      }
+
+  if (name == NULL || (port = radix_lookup (ifnl_names, name)) == NULL)
+    return;
+  slot = if_lookup_by_index (port->ifindex);
+  if (slot < 0)
+    return;
+
+  if (h->nlmsg_type == RTM_DELLINK)
+    {
+      port->kindex = 0;
+      port->creating = 0;
+      if_set_oper (slot, 0);
+      return;
+    }
+
+  if (has_stats)
+    ifnl_stats (port, slot, ifi->ifi_index, &stats);
+
+  changed = port->kindex != ifi->ifi_index
+    || ((port->kflags ^ ifi->ifi_flags) & IFF_UP) || port->kmtu != mtu
+    || strcmp (port->kalias ? port->kalias : "", alias) != 0;
+  port->kindex = ifi->ifi_index;
+  port->kflags = ifi->ifi_flags;
+  port->kmtu = mtu;
+  port->creating = 0;
+  if (port->kalias)
+    intern_unref (port->kalias);
+  port->kalias = intern (alias);
+
+  if (iftable.flags[slot] & IF_ADMIN_UP)
+    if_set_oper (slot, (ifi->ifi_flags & IFF_UP)
+                 && (ifi->ifi_flags & IFF_RUNNING));
+
+  /* What was changed behind our back is put back by
+     ifnl_sync_dirty (). */
+  if (changed && ! port->dirty)
+    {
+      if (ifnl_dirty_count == ifnl_dirty_size)
+        {
+          ifnl_dirty_size = ifnl_dirty_size ? ifnl_dirty_size * 2 : 64;
+          ifnl_dirty = XREALLOC (MTYPE_IF_NETLINK, ifnl_dirty,
+                                 sizeof (unsigned int) * ifnl_dirty_size);
+        }
+      ifnl_dirty[ifnl_dirty_count++] = port->ifindex;
+      port->dirty = 1;
+    }
+}
+
+/* Fix the devices of the ports heard of, and send the batch. */
+static void
+ifnl_sync_dirty (void)
+{
+  struct ifnl_port key;
+  struct ifnl_port *port;
+  unsigned int i;
+  int slot;
+
+  for (i = 0; i < ifnl_dirty_count; i++)
+    {
+      key.ifindex = ifnl_dirty[i];
+      if ((port = hash_lookup (ifnl_ports, &key)) == NULL)
+        continue;
+      port->dirty = 0;
+      if ((slot = if_lookup_by_index (port->ifindex)) >= 0)
+        ifnl_sync (port, slot);
+    }
+  ifnl_dirty_count = 0;
+  ifnl_flush ();
+}
+
+static void
+ifnl_port_forget (void *data, void *arg)
+{
+  struct ifnl_port *port = data;
+
+  port->kindex = 0;
+  port->creating = 0;
+}
+
+/* Learn all devices with one dump. */
+static int
+ifnl_dump (void)
+{
+  struct {
+    struct nlmsghdr h;
+    struct ifinfomsg ifi;
+  } req;
+  struct sockaddr_nl snl;
+
+  memset (&req, 0, sizeof (req));
+  req.h.nlmsg_len = sizeof (req);
+  req.h.nlmsg_type = RTM_GETLINK;
+  req.h.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  req.h.nlmsg_seq = ++ifnl_seq;
+  req.ifi.ifi_family = AF_UNSPEC;
+  memset (&snl, 0, sizeof (snl));
+  snl.nl_family = AF_NETLINK;
+
+  if (sendto (ifnl_req, &req, sizeof (req), 0, (struct sockaddr *) &snl,
+              sizeof (snl)) < 0)
+    {
+      zlog_warn ("netlink: %s", strerror (errno));
+      return -1;
+    }
+  ifnl_dumps++;
+  return ifnl_recv (req.h.nlmsg_seq, ifnl_link);
+}
+
+/* Learn all devices afresh, and make them match the table. */
+static void
+ifnl_reconcile (void)
+{
+  struct ifnl_port *port;
+  long start = ifnl_now ();
+  int slot;
+
+  IF_LOOP (slot)
+    ifnl_port_get (slot);
+  hash_iterate (ifnl_ports, ifnl_port_forget, NULL);
+
+  if (ifnl_dump () < 0)
+    return;
+  ifnl_sync_dirty ();
+
+  /* Ports whose devices weren't in the dump. */
+  IF_LOOP (slot)
+    if ((port = ifnl_port_get (slot)) && port->kindex == 0)
+      ifnl_sync (port, slot);
+  ifnl_flush ();
+
+  ifnl_reconcile_ms = ifnl_now () - start;
+}
+
+/* Learn the devices' counters, and what was missed of them, called
+   every second. */
+void
+ifnl_poll (void)
+{
+  if (ifnl_req < 0)
+    return;
+  if (ifnl_dump () < 0)
+    return;
+  ifnl_sync_dirty ();
+}
+
+int
+ifnl_fd (void)
+{
+  return ifnl_mc;
+}
+
+/* Take in the link events, called by the main loop. */
+void
+ifnl_read (void)
+{
+  struct nlmsghdr *h;
+  int len;
+
+  worker_state_lock ();
+  while (ifnl_mc >= 0)
+    {
+      len = recv (ifnl_mc, ifnl_rbuf, IFNL_BUF_SIZE, MSG_DONTWAIT);
+      if (len < 0 && errno == ENOBUFS)
+        {
+          /* Events were lost, learn the devices afresh. */
+          ifnl_overruns++;
+          ifnl_reconcile ();
+          continue;
+        }
+      if (len <= 0)
+        break;
+
+      for (h = (struct nlmsghdr *) ifnl_rbuf; NLMSG_OK (h, len);
+           h = NLMSG_NEXT (h, len))
+        {
+          ifnl_events++;
+          ifnl_link (h);
+        }
+    }
+  ifnl_sync_dirty ();
+  worker_state_unlock ();
+}
+
+/* Changes of the table, delivered in batches by the event bus. */
+static void
+ifnl_changed (const struct ifevent *ev, int n, void *arg)
+{
+  struct ifnl_port key;
+  struct ifnl_port *port;
+  int i, slot;
+
+  if (ifnl_req < 0)
+    return;
+
+  for (i = 0; i < n; i++)
+    {
+      slot = if_lookup_by_index (ev[i].ifindex);
+      if (slot < 0)
+        {
+          /* The device stays, it's only no port's anymore. */
+          key.ifindex = ev[i].ifindex;
+          if ((port = hash_release (ifnl_ports, &key)))
+            ifnl_port_free (port);
+          continue;
+        }
+      if ((port = ifnl_port_get (slot)))
+        ifnl_sync (port, slot);
+    }
+  ifnl_flush ();
+}
+
+static int
+ifnl_socket (unsigned int groups)
+{
+  struct sockaddr_nl snl;
+  int fd, one = 1;
+
+  fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+  if (fd < 0)
+    return -1;
+
+  /* Errors needn't carry the request back. */
+  setsockopt (fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof (one));
+
+  memset (&snl, 0, sizeof (snl));
+  snl.nl_family = AF_NETLINK;
+  snl.nl_groups = groups;
+  if (bind (fd, (struct sockaddr *) &snl, sizeof (snl)) < 0)
+    {
+      close (fd);
+      return -1;
+    }
+  return fd;
+}
+
+static int
+ifnl_enable (struct vty *vty)
+{
+  struct timeval tv = { 2, 0 };
+  int size = IFNL_RCVBUF;
+
+  if (ifnl_req < 0)
+    {
+      ifnl_req = ifnl_socket (0);
+      ifnl_mc = ifnl_socket (RTMGRP_LINK);
+      if (ifnl_req < 0 || ifnl_mc < 0)
+        {
+          vty_out (vty, "%% Can't open netlink socket: %s%s",
+                   strerror (errno), VTY_NEWLINE);
+          if (ifnl_req >= 0)
+            close (ifnl_req);
+          if (ifnl_mc >= 0)
+            close (ifnl_mc);
+          ifnl_req = ifnl_mc = -1;
+          return CMD_WARNING;
+        }
+
+      /* The kernel answers before sendto () returns, this only guards
+         against waiting forever. */
+      setsockopt (ifnl_req, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+      if (setsockopt (ifnl_mc, SOL_SOCKET, SO_RCVBUFFORCE, &size,
+                      sizeof (size)) < 0)
+        setsockopt (ifnl_mc, SOL_SOCKET, SO_RCVBUF, &size, sizeof (size));
+      io_add (ifnl_mc, 0);
+
+      if (ifnl_batch == NULL)
+        {
+          ifnl_batch = XMALLOC (MTYPE_IF_NETLINK, IFNL_BATCH_SIZE);
+          ifnl_rbuf = XMALLOC (MTYPE_IF_NETLINK, IFNL_BUF_SIZE);
+          ifnl_ports = hash_create (ifnl_port_key, ifnl_port_cmp);
+          ifnl_names = radix_new ();
+        }
+    }
+
+  ifnl_reconcile ();
+  return CMD_SUCCESS;
+}
+
+DEFUN (interface_kernel_sync,
+       interface_kernel_sync_cmd,
+       "interface kernel-sync",
+       "Select an interface to configure\n"
+       "Mirror the interfaces onto kernel network devices\n")
+{
+  ifnl_create = NULL;
+  return ifnl_enable (vty);
+}
+
+DEFUN (interface_kernel_sync_create,
+       interface_kernel_sync_create_cmd,
+       "interface kernel-sync create (dummy|veth)",
+       "Select an interface to configure\n"
+       "Mirror the interfaces onto kernel network devices\n"
+       "Make the devices which are missing\n"
+       "Dummy devices\n"
+       "Veth pairs, the peer of ge1-0-1 is ge1-0-1p\n")
+{
+  ifnl_create = argv[0][0] == 'd' ? "dummy" : "veth";
+  return ifnl_enable (vty);
+}
+
+DEFUN (no_interface_kernel_sync,
+       no_interface_kernel_sync_cmd,
+       "no interface kernel-sync",
+       NO_STR
+       "Select an interface to configure\n"
+       "Mirror the interfaces onto kernel network devices\n")
+{
+  if (ifnl_req < 0)
+    return CMD_SUCCESS;
+
+  io_del (ifnl_mc);
+  close (ifnl_mc);
+  close (ifnl_req);
+  ifnl_req = ifnl_mc = -1;
+  hash_clean (ifnl_ports, ifnl_port_free);
+  ifnl_dirty_count = 0;
+  return CMD_SUCCESS;
+}
+
+static void
+ifnl_port_count (void *data, void *arg)
+{
+  if (((struct ifnl_port *) data)->kindex)
+    (*(int *) arg)++;
+}
+
+DEFUN_ATTR (show_interface_kernel_sync,
+       show_interface_kernel_sync_cmd,
+       "show interface kernel-sync",
+       SHOW_STR
+       "The information of specify interface\n"
+       "Mirroring onto kernel network devices\n",
+       CMD_ATTR_READONLY)
+{
+  unsigned long stats[6];
+  const char *state;
+  long ms;
+  int devices = 0, ports;
+
+  worker_state_lock ();
+  state = ifnl_req < 0 ? "disabled" : ifnl_create ? ifnl_create : "enabled";
+  if (ifnl_req >= 0)
+    hash_iterate (ifnl_ports, ifnl_port_count, &devices);
+  ports = iftable.count;
+  stats[0] = ifnl_requests;
+  stats[1] = ifnl_sends;
+  stats[2] = ifnl_errors;
+  stats[3] = ifnl_events;
+  stats[4] = ifnl_dumps;
+  stats[5] = ifnl_overruns;
+  ms = ifnl_reconcile_ms;
+  worker_state_unlock ();
+
+  vty_object_begin (vty, NULL);
+  vty_field_label (vty, 22, "Kernel sync:");
+  vty_field_str (vty, "state", 0, state);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Ports with a device:");
+  vty_field_int (vty, "devices", 0, devices);
+  vty_field_label (vty, 0, " of ");
+  vty_field_int (vty, "ports", 0, ports);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Requests:");
+  vty_field_int (vty, "requests", 0, stats[0]);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Batches sent:");
+  vty_field_int (vty, "batches", 0, stats[1]);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Refused:");
+  vty_field_int (vty, "errors", 0, stats[2]);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Link events:");
+  vty_field_int (vty, "events", 0, stats[3]);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Dumps:");
+  vty_field_int (vty, "dumps", 0, stats[4]);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Event overruns:");
+  vty_field_int (vty, "overruns", 0, stats[5]);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_field_label (vty, 22, "Last reconcile (ms):");
+  vty_field_int (vty, "reconcileMs", 0, ms);
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_object_end (vty);
+  return CMD_SUCCESS;
+}
+
+void
+ifnl_init (void)
+{
+  ifevent_subscribe ("kernel", IF_EVENT_LINK | IF_EVENT_MTU | IF_EVENT_DESC
+                     | IF_EVENT_CREATE | IF_EVENT_DELETE, ifnl_changed, NULL);
+
+  install_element (CONFIG_NODE, &interface_kernel_sync_cmd);
+  install_element (CONFIG_NODE, &interface_kernel_sync_create_cmd);
+  install_element (CONFIG_NODE, &no_interface_kernel_sync_cmd);
+  install_element (VIEW_NODE, &show_interface_kernel_sync_cmd);
+  install_element (ENABLE_NODE, &show_interface_kernel_sync_cmd);
+  install_element (CONFIG_NODE, &show_interface_kernel_sync_cmd);
+}
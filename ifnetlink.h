@@ -0,0 +1,46 @@
+/* Interface table mirrored onto kernel network devices.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_IFNETLINK_H
+#define _ZEBRA_IFNETLINK_H
+
+/* When enabled, each port is mirrored onto the network device named
+   like it with '/' turned into '-', ge1/0/1 onto ge1-0-1.  The table
+   owns the admin state, MTU and description of the device; the device
+   owns the port's operational state.  Devices are learnt with one
+   dump, changes are pushed with batches of rtnetlink requests, of
+   which only the last asks for an ack, and changes made to the devices
+   are heard on the link multicast group. */
+
+/* What the kernel's MTU lacks of ours: Ethernet header, VLAN tag and
+   FCS, so that the default 1522 is 1500. */
+#define IFNL_MTU_OVERHEAD 22
+
+/* Smallest MTU the kernel takes for an Ethernet device, smaller MTUs
+   of ports are raised to it. */
+#define IFNL_MTU_MIN 68
+
+/* Prototypes. */
+void ifnl_init (void);
+int ifnl_fd (void);
+void ifnl_read (void);
+void ifnl_poll (void);
+
+#endif /* _ZEBRA_IFNETLINK_H */
@@ -0,0 +1,177 @@
+/* Interface state in shared memory, the writer's side.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <sys/mman.h>
+
+#include "log.h"
+#include "if.h"
+#include "ifstat.h"
+#include "ifshm.h"
+
+static int ifshm_fd = -1;
+static struct ifshm_header *ifshm_hdr;
+static size_t ifshm_len;
+
+static size_t
+ifshm_size (unsigned int ports)
+{
+  return sizeof (struct ifshm_header) + ports * sizeof (struct ifshm_port);
+}
+
+static struct ifshm_port *
+ifshm_port (unsigned int slot)
+{
+  return (struct ifshm_port *) (ifshm_hdr + 1) + slot;
+}
+
+/* Start a change of what sequence count SEQ guards. */
+static void
+ifshm_write_begin (uint32_t *seq)
+{
+  __atomic_store_n (seq, *seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+static void
+ifshm_write_end (uint32_t *seq)
+{
+  __atomic_store_n (seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Make room for PORTS records.  Readers map the segment again when
+   they find it has grown, the records stay where they are. */
+static int
+ifshm_grow (unsigned int ports)
+{
+  size_t len = ifshm_size (ports);
+  void *p;
+
+  if (ftruncate (ifshm_fd, len) < 0)
+    return -1;
+  p = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, ifshm_fd, 0);
+  if (p == MAP_FAILED)
+    return -1;
+  if (ifshm_hdr)
+    munmap (ifshm_hdr, ifshm_len);
+  ifshm_hdr = p;
+  ifshm_len = len;
+
+  ifshm_write_begin (&ifshm_hdr->seq);
+  ifshm_hdr->size = ports;
+  ifshm_write_end (&ifshm_hdr->seq);
+  return 0;
+}
+
+/* Create the segment afresh.  Readers of one left by an earlier run
+   keep their mapping of it, which is no longer updated. */
+int
+ifshm_init (void)
+{
+  shm_unlink (IFSHM_NAME);
+  ifshm_fd = shm_open (IFSHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (ifshm_fd < 0)
+    {
+      zlog_warn ("shm_open %s: %s", IFSHM_NAME, strerror (errno));
+      return -1;
+    }
+
+  if (ifshm_grow (iftable.size ? iftable.size : 64) < 0)
+    {
+      zlog_warn ("shared interface state: %s", strerror (errno));
+      close (ifshm_fd);
+      ifshm_fd = -1;
+      return -1;
+    }
+
+  ifshm_hdr->magic = IFSHM_MAGIC;
+  ifshm_hdr->version = IFSHM_VERSION;
+  ifshm_hdr->header_size = sizeof (struct ifshm_header);
+  ifshm_hdr->port_size = sizeof (struct ifshm_port);
+  return 0;
+}
+
+/* Record of SLOT as it is now. */
+static void
+ifshm_fill (int slot, struct ifshm_port *v)
+{
+  struct if_info *info = iftable.info[slot];
+  struct ifstat s;
+  int i;
+
+  memset (v, 0, sizeof (struct ifshm_port));
+  if (! (iftable.flags[slot] & IF_USED))
+    return;
+
+  v->ifindex = info->ifindex;
+  v->flags = iftable.flags[slot];
+  v->duplex = info->duplex;
+  v->linktype = info->linktype;
+  v->mtu = iftable.mtu[slot];
+  v->speed = iftable.speed[slot];
+  v->def_vlan = iftable.def_vlan[slot];
+  snprintf (v->name, sizeof (v->name), "%s", info->name);
+
+  ifstat_get (slot, &s);
+  for (i = 0; i < IFSHM_COUNTERS; i++)
+    v->counters[i] = s.c[i];
+}
+
+/* Bring the segment up to date with the interface table, with the
+   worker state lock held.  Records which haven't changed aren't
+   written, so readers of them never retry. */
+void
+ifshm_publish (void)
+{
+  struct ifshm_port v;
+  struct ifshm_port *p;
+  unsigned int slot, max;
+
+  if (ifshm_hdr == NULL)
+    return;
+  if (iftable.size > ifshm_hdr->size && ifshm_grow (iftable.size) < 0)
+    return;
+
+  /* Slots past the table's end may have been freed since. */
+  max = iftable.max > ifshm_hdr->max ? iftable.max : ifshm_hdr->max;
+  for (slot = 0; slot < max; slot++)
+    {
+      p = ifshm_port (slot);
+      ifshm_fill (slot, &v);
+      if (memcmp ((char *) p + sizeof (p->seq), (char *) &v + sizeof (v.seq),
+                  sizeof (v) - sizeof (v.seq)) == 0)
+        continue;
+
+      ifshm_write_begin (&p->seq);
+      memcpy ((char *) p + sizeof (p->seq), (char *) &v + sizeof (v.seq),
+              sizeof (v) - sizeof (v.seq));
+      ifshm_write_end (&p->seq);
+    }
+
+  if (ifshm_hdr->max != iftable.max)
+    {
+      ifshm_write_begin (&ifshm_hdr->seq);
+      ifshm_hdr->max = iftable.max;
+      ifshm_write_end (&ifshm_hdr->seq);
+    }
+  __atomic_store_n (&ifshm_hdr->updated, (uint64_t) time (NULL),
+                    __ATOMIC_RELAXED);
+}
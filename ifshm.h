@@ -0,0 +1,111 @@
+/* Interface state in shared memory.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_IFSHM_H
+#define _ZEBRA_IFSHM_H
+
+/* The interface table is published in a POSIX shared memory segment
+   for other processes to read.  The segment is a header followed by a
+   record per interface table slot.  Each record, and the size fields
+   of the header, is guarded by a sequence count which is odd while it
+   is being written; a reader copies a record and retries when the
+   count was odd or has moved meanwhile.  Readers never write to the
+   segment and need no system call once it's mapped.
+
+   This file is all a reader needs besides ifshm_read.c, it doesn't
+   depend on the rest of the tree. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define IFSHM_NAME      "/switch-ifstate"
+#define IFSHM_MAGIC     0x49465348
+#define IFSHM_VERSION   1
+
+#define IFSHM_NAMSIZ    32
+
+/* Flags of a record, the same as the interface table's. */
+#define IFSHM_USED      0x01
+#define IFSHM_ADMIN_UP  0x02
+#define IFSHM_OPER_UP   0x04
+
+/* Counters of a record. */
+#define IFSHM_RX_PACKETS  0
+#define IFSHM_RX_BYTES    1
+#define IFSHM_RX_ERRORS   2
+#define IFSHM_RX_DROPS    3
+#define IFSHM_TX_PACKETS  4
+#define IFSHM_TX_BYTES    5
+#define IFSHM_TX_ERRORS   6
+#define IFSHM_TX_DROPS    7
+#define IFSHM_COUNTERS    8
+
+struct ifshm_port
+{
+  uint32_t seq;
+  uint32_t ifindex;
+  uint8_t flags;
+  uint8_t duplex;
+  uint8_t linktype;
+  uint8_t pad;
+  uint32_t mtu;
+  uint32_t speed;
+  uint32_t def_vlan;
+  char name[IFSHM_NAMSIZ];
+  uint64_t counters[IFSHM_COUNTERS];
+} __attribute__ ((aligned (64)));
+
+struct ifshm_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t port_size;
+
+  /* Records the segment has room for and records up to the last one
+     in use, guarded by SEQ. */
+  uint32_t seq;
+  uint32_t size;
+  uint32_t max;
+  uint32_t pad;
+
+  /* When the table was last published, in seconds since the epoch. */
+  uint64_t updated;
+} __attribute__ ((aligned (64)));
+
+/* A reader's mapping of the segment. */
+struct ifshm_reader
+{
+  int fd;
+  const struct ifshm_header *hdr;
+  size_t len;
+};
+
+/* Reader prototypes, ifshm_read.c. */
+int ifshm_open (struct ifshm_reader *);
+void ifshm_close (struct ifshm_reader *);
+unsigned int ifshm_max (struct ifshm_reader *);
+int ifshm_read (struct ifshm_reader *, unsigned int, struct ifshm_port *);
+
+/* Writer prototypes, ifshm.c. */
+int ifshm_init (void);
+void ifshm_publish (void);
+
+#endif /* _ZEBRA_IFSHM_H */
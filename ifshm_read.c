@@ -0,0 +1,163 @@
+/* Interface state in shared memory, the reader's side.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* This builds on its own into an agent, with nothing but ifshm.h. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ifshm.h"
+
+/* Tries at a record which is being written before giving up, the
+   writer may have died halfway. */
+#define IFSHM_RETRIES 100000
+
+static int
+ifshm_map (struct ifshm_reader *r)
+{
+  struct stat st;
+  void *p;
+
+  if (fstat (r->fd, &st) < 0)
+    return -1;
+  if ((size_t) st.st_size < sizeof (struct ifshm_header))
+    {
+      errno = EAGAIN;
+      return -1;
+    }
+
+  p = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, r->fd, 0);
+  if (p == MAP_FAILED)
+    return -1;
+
+  if (r->hdr)
+    munmap ((void *) r->hdr, r->len);
+  r->hdr = p;
+  r->len = st.st_size;
+  return 0;
+}
+
+/* Map the segment.  Returns -1 with errno set when it isn't there or
+   has a layout this reader doesn't know. */
+int
+ifshm_open (struct ifshm_reader *r)
+{
+  r->hdr = NULL;
+  r->len = 0;
+  r->fd = shm_open (IFSHM_NAME, O_RDONLY, 0);
+  if (r->fd < 0)
+    return -1;
+
+  if (ifshm_map (r) < 0)
+    goto fail;
+  if (r->hdr->magic != IFSHM_MAGIC || r->hdr->version != IFSHM_VERSION
+      || r->hdr->port_size < sizeof (struct ifshm_port))
+    {
+      errno = EPROTO;
+      goto fail;
+    }
+  return 0;
+
+fail:
+  ifshm_close (r);
+  return -1;
+}
+
+void
+ifshm_close (struct ifshm_reader *r)
+{
+  if (r->hdr)
+    munmap ((void *) r->hdr, r->len);
+  if (r->fd >= 0)
+    close (r->fd);
+  r->hdr = NULL;
+  r->fd = -1;
+}
+
+/* Copy LEN bytes at SRC, which are guarded by sequence count *SEQ, to
+   DST.  Returns -1 when no consistent copy could be had. */
+static int
+ifshm_copy (const uint32_t *seq, void *dst, const void *src, size_t len)
+{
+  uint32_t s;
+  int i;
+
+  for (i = 0; i < IFSHM_RETRIES; i++)
+    {
+      s = __atomic_load_n (seq, __ATOMIC_ACQUIRE);
+      if (s & 1)
+        continue;
+      memcpy (dst, src, len);
+      __atomic_thread_fence (__ATOMIC_ACQUIRE);
+      if (__atomic_load_n (seq, __ATOMIC_RELAXED) == s)
+        return 0;
+    }
+  errno = EAGAIN;
+  return -1;
+}
+
+/* Records up to the last one in use. */
+unsigned int
+ifshm_max (struct ifshm_reader *r)
+{
+  uint32_t sizes[2];
+
+  if (ifshm_copy (&r->hdr->seq, sizes, &r->hdr->size, sizeof (sizes)) < 0)
+    return 0;
+  return sizes[1];
+}
+
+/* Copy record SLOT to PORT.  Returns -1 when there's no interface in
+   it.  The segment is mapped again only when the table has grown past
+   what is mapped. */
+int
+ifshm_read (struct ifshm_reader *r, unsigned int slot, struct ifshm_port *port)
+{
+  const char *p;
+  uint32_t sizes[2];
+  size_t end;
+
+  if (ifshm_copy (&r->hdr->seq, sizes, &r->hdr->size, sizeof (sizes)) < 0)
+    return -1;
+  if (slot >= sizes[1])
+    {
+      errno = ENOENT;
+      return -1;
+    }
+
+  end = r->hdr->header_size + (size_t) (slot + 1) * r->hdr->port_size;
+  if (end > r->len && (ifshm_map (r) < 0 || end > r->len))
+    return -1;
+
+  p = (const char *) r->hdr + r->hdr->header_size
+      + (size_t) slot * r->hdr->port_size;
+  if (ifshm_copy ((const uint32_t *) p, port, p, sizeof (*port)) < 0)
+    return -1;
+  if (! (port->flags & IFSHM_USED))
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  return 0;
+}
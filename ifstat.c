@@ -0,0 +1,464 @@
+/* Interface traffic counters.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <pthread.h>
+
+#include "memory.h"
+#include "ifstat.h"
+
+/* A thread counts into its own block, so updates need neither a lock
+   nor an atomic read-modify-write, and no two threads write the same
+   cache line.  Readers add up all blocks.  Counts are never reset, a
+   slot's counters are relative to a base taken when its interface was
+   created. */
+
+/* Weight of a new sample in each average, 1 - exp (-IFSTAT_INTERVAL /
+   window). */
+static const double ifstat_alpha[IFSTAT_WINDOWS] =
+{
+  [IFSTAT_5SEC] = 0.181269247,
+  [IFSTAT_5MIN] = 0.003327784,
+};
+
+/* Counters of one thread, or a sum of them. */
+struct ifstat_block
+{
+  struct ifstat_block *next;
+  struct ifstat *chunk[IFSTAT_CHUNKS];
+
+  /* As allocated, before alignment. */
+  void *raw[IFSTAT_CHUNKS];
+};
+
+static __thread struct ifstat_block *ifstat_local;
+
+/* Threads with counters, what exited threads have left behind, and
+   the counts slots had when their interfaces were created. */
+static struct ifstat_block *ifstat_threads;
+static struct ifstat_block ifstat_retired;
+static struct ifstat_block ifstat_base;
+static pthread_mutex_t ifstat_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t ifstat_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ifstat_key;
+
+/* Rates of a slot and the counts they were last sampled from, and its
+   history: the rings, the counts of the history's last sample, and
+   what the current hour has seen so far. */
+struct ifstat_sample
+{
+  unsigned long last[IFSTAT_MAX];
+  struct ifstat_rate rate;
+
+  struct ifstat_hist hist;
+  unsigned long hist_last[IFSTAT_HIST_MAX];
+  unsigned long hist_acc[IFSTAT_HIST_MAX];
+};
+
+static struct ifstat_sample *ifstat_samples[IFSTAT_CHUNKS];
+
+const int ifstat_hist_counter[IFSTAT_HIST_MAX] =
+{
+  IFSTAT_RX_PACKETS, IFSTAT_RX_BYTES, IFSTAT_TX_PACKETS, IFSTAT_TX_BYTES
+};
+
+/* All ports' history is sampled at once, so the rings of all of them
+   have the newest sample at the same position.  The last advance
+   added NEW_MINUTES and NEW_HOURS samples. */
+static int ifstat_minute_pos;
+static int ifstat_hour_pos;
+static time_t ifstat_minute_end;
+static time_t ifstat_hour_end;
+static int ifstat_new_minutes;
+static int ifstat_new_hours;
+
+/* Chunk INDEX of block B.  A new chunk is published only once it's
+   zeroed, readers may look at it right away. */
+static struct ifstat *
+ifstat_chunk_get (struct ifstat_block *b, int index)
+{
+  struct ifstat *chunk = __atomic_load_n (&b->chunk[index], __ATOMIC_ACQUIRE);
+  unsigned long p;
+
+  if (chunk)
+    return chunk;
+
+  b->raw[index] = XCALLOC (MTYPE_IF_STAT, sizeof (struct ifstat)
+                           * IFSTAT_CHUNK_SIZE + IFSTAT_CACHE_LINE - 1);
+  p = ((unsigned long) b->raw[index] + IFSTAT_CACHE_LINE - 1)
+      & ~(unsigned long) (IFSTAT_CACHE_LINE - 1);
+  chunk = (struct ifstat *) p;
+  __atomic_store_n (&b->chunk[index], chunk, __ATOMIC_RELEASE);
+  return chunk;
+}
+
+static void
+ifstat_chunk_free (struct ifstat_block *b)
+{
+  int i;
+
+  for (i = 0; i < IFSTAT_CHUNKS; i++)
+    if (b->raw[i])
+      XFREE (MTYPE_IF_STAT, b->raw[i]);
+}
+
+static void
+ifstat_thread_exit (void *arg)
+{
+  struct ifstat_block *t = arg;
+  struct ifstat_block **tp;
+  struct ifstat *chunk;
+  int i, j, k;
+
+  pthread_mutex_lock (&ifstat_mtx);
+  for (tp = &ifstat_threads; *tp; tp = &(*tp)->next)
+    if (*tp == t)
+      {
+        *tp = t->next;
+        break;
+      }
+  for (i = 0; i < IFSTAT_CHUNKS; i++)
+    if (t->chunk[i])
+      {
+        chunk = ifstat_chunk_get (&ifstat_retired, i);
+        for (j = 0; j < IFSTAT_CHUNK_SIZE; j++)
+          for (k = 0; k < IFSTAT_MAX; k++)
+            chunk[j].c[k] += t->chunk[i][j].c[k];
+      }
+  pthread_mutex_unlock (&ifstat_mtx);
+
+  ifstat_chunk_free (t);
+  XFREE (MTYPE_IF_STAT, t);
+}
+
+static void
+ifstat_init_once (void)
+{
+  pthread_key_create (&ifstat_key, ifstat_thread_exit);
+}
+
+/* Counters of the calling thread. */
+static struct ifstat_block *
+ifstat_thread_get (void)
+{
+  struct ifstat_block *t;
+
+  if (ifstat_local)
+    return ifstat_local;
+
+  t = XCALLOC (MTYPE_IF_STAT, sizeof (struct ifstat_block));
+
+  pthread_once (&ifstat_once, ifstat_init_once);
+  pthread_setspecific (ifstat_key, t);
+
+  pthread_mutex_lock (&ifstat_mtx);
+  t->next = ifstat_threads;
+  ifstat_threads = t;
+  pthread_mutex_unlock (&ifstat_mtx);
+
+  ifstat_local = t;
+  return t;
+}
+
+/* The calling thread's counters of SLOT. */
+static struct ifstat *
+ifstat_slot (int slot)
+{
+  struct ifstat_block *t = ifstat_local;
+  struct ifstat *chunk;
+
+  if (t == NULL)
+    t = ifstat_thread_get ();
+  chunk = t->chunk[slot >> IFSTAT_CHUNK_SHIFT];
+  if (chunk == NULL)
+    chunk = ifstat_chunk_get (t, slot >> IFSTAT_CHUNK_SHIFT);
+  return &chunk[slot & (IFSTAT_CHUNK_SIZE - 1)];
+}
+
+/* Add N to COUNTER of SLOT.  This is for the data plane, any thread
+   may call it at any time. */
+void
+ifstat_add (int slot, int counter, unsigned long n)
+{
+  struct ifstat *s = ifstat_slot (slot);
+
+  __atomic_store_n (&s->c[counter], s->c[counter] + n, __ATOMIC_RELAXED);
+}
+
+/* Count PACKETS of BYTES in all in packet counter COUNTER of SLOT and
+   the byte counter after it. */
+void
+ifstat_packets (int slot, int counter, unsigned long packets,
+                unsigned long bytes)
+{
+  struct ifstat *s = ifstat_slot (slot);
+
+  __atomic_store_n (&s->c[counter], s->c[counter] + packets,
+                    __ATOMIC_RELAXED);
+  __atomic_store_n (&s->c[counter + 1], s->c[counter + 1] + bytes,
+                    __ATOMIC_RELAXED);
+}
+
+/* Add SLOT's counters in block B to S. */
+static void
+ifstat_sum (struct ifstat_block *b, int slot, struct ifstat *s)
+{
+  struct ifstat *chunk;
+  int i;
+
+  chunk = __atomic_load_n (&b->chunk[slot >> IFSTAT_CHUNK_SHIFT],
+                           __ATOMIC_ACQUIRE);
+  if (chunk == NULL)
+    return;
+  chunk += slot & (IFSTAT_CHUNK_SIZE - 1);
+  for (i = 0; i < IFSTAT_MAX; i++)
+    s->c[i] += __atomic_load_n (&chunk->c[i], __ATOMIC_RELAXED);
+}
+
+/* Counts of SLOT from all threads. */
+static void
+ifstat_total (int slot, struct ifstat *s)
+{
+  struct ifstat_block *t;
+
+  memset (s, 0, sizeof (struct ifstat));
+  pthread_mutex_lock (&ifstat_mtx);
+  ifstat_sum (&ifstat_retired, slot, s);
+  for (t = ifstat_threads; t; t = t->next)
+    ifstat_sum (t, slot, s);
+  pthread_mutex_unlock (&ifstat_mtx);
+}
+
+/* Counters of SLOT's interface.  The base and rates are only changed
+   with the worker state lock held, which the caller holds too. */
+void
+ifstat_get (int slot, struct ifstat *s)
+{
+  struct ifstat *base;
+  int i;
+
+  ifstat_total (slot, s);
+  base = ifstat_base.chunk[slot >> IFSTAT_CHUNK_SHIFT];
+  if (base == NULL)
+    return;
+  base += slot & (IFSTAT_CHUNK_SIZE - 1);
+  for (i = 0; i < IFSTAT_MAX; i++)
+    s->c[i] -= base->c[i];
+}
+
+static struct ifstat_sample *
+ifstat_sample_get (int slot)
+{
+  struct ifstat_sample **chunk = &ifstat_samples[slot >> IFSTAT_CHUNK_SHIFT];
+
+  if (*chunk == NULL)
+    *chunk = XCALLOC (MTYPE_IF_STAT,
+                      sizeof (struct ifstat_sample) * IFSTAT_CHUNK_SIZE);
+  return &(*chunk)[slot & (IFSTAT_CHUNK_SIZE - 1)];
+}
+
+/* Start SLOT's counters and rates over, for a new interface. */
+void
+ifstat_clear (int slot)
+{
+  struct ifstat *base;
+
+  base = ifstat_chunk_get (&ifstat_base, slot >> IFSTAT_CHUNK_SHIFT);
+  ifstat_total (slot, &base[slot & (IFSTAT_CHUNK_SIZE - 1)]);
+  memset (ifstat_sample_get (slot), 0, sizeof (struct ifstat_sample));
+}
+
+/* Sample SLOT's counters, SECONDS after the last sample.  Samples
+   which were missed are taken to have seen the same rate. */
+void
+ifstat_rate_update (int slot, unsigned int seconds)
+{
+  struct ifstat_sample *sample = ifstat_sample_get (slot);
+  struct ifstat s;
+  double rate;
+  unsigned int n;
+  int i, w;
+
+  if (seconds == 0)
+    return;
+
+  ifstat_get (slot, &s);
+  for (i = 0; i < IFSTAT_MAX; i++)
+    {
+      rate = (double) (s.c[i] - sample->last[i]) / seconds;
+      sample->last[i] = s.c[i];
+
+      for (w = 0; w < IFSTAT_WINDOWS; w++)
+        for (n = 0; n < seconds / IFSTAT_INTERVAL && n < 300; n++)
+          sample->rate.rate[i][w] += ifstat_alpha[w]
+                                     * (rate - sample->rate.rate[i][w]);
+    }
+}
+
+void
+ifstat_rate_get (int slot, struct ifstat_rate *rate)
+{
+  *rate = ifstat_sample_get (slot)->rate;
+}
+
+/* COUNT as a 16-bit float, rounded to nearest. */
+static unsigned short
+ifstat_pack (unsigned long count)
+{
+  unsigned long m;
+  int e = 0;
+
+  if (count < 0x400)
+    return count;
+  while ((count >> e) >= 0x800)
+    e++;
+  m = e ? (count >> e) + ((count >> (e - 1)) & 1) : count;
+
+  /* Rounded up to the next power of two, unless that's 1 << 64. */
+  if (m == 0x800 && e == 53)
+    m = 0x7ff;
+  else if (m == 0x800)
+    {
+      m = 0x400;
+      e++;
+    }
+  return ((e + 1) << 10) | (m & 0x3ff);
+}
+
+/* Start history samples which end at NOW, when a minute has passed
+   since the last ones.  Returns whether every port's history is to be
+   updated with ifstat_hist_update () now. */
+int
+ifstat_hist_advance (time_t now)
+{
+  time_t minute = now - now % 60;
+  time_t hour = now - now % 3600;
+
+  if (ifstat_minute_end == 0)
+    {
+      ifstat_minute_end = minute;
+      ifstat_hour_end = hour;
+      return 0;
+    }
+  if (minute == ifstat_minute_end)
+    return 0;
+
+  /* The clock may have been set back. */
+  if (minute < ifstat_minute_end || hour < ifstat_hour_end)
+    {
+      ifstat_new_minutes = 1;
+      ifstat_new_hours = 0;
+    }
+  else
+    {
+      ifstat_new_minutes = (minute - ifstat_minute_end) / 60;
+      ifstat_new_hours = (hour - ifstat_hour_end) / 3600;
+    }
+  if (ifstat_new_minutes > IFSTAT_HIST_MINUTES)
+    ifstat_new_minutes = IFSTAT_HIST_MINUTES;
+  if (ifstat_new_hours > IFSTAT_HIST_HOURS)
+    ifstat_new_hours = IFSTAT_HIST_HOURS;
+
+  ifstat_minute_pos = (ifstat_minute_pos + ifstat_new_minutes)
+                      % IFSTAT_HIST_MINUTES;
+  ifstat_minute_end = minute;
+  if (ifstat_new_hours)
+    {
+      ifstat_hour_pos = (ifstat_hour_pos + ifstat_new_hours)
+                        % IFSTAT_HIST_HOURS;
+      ifstat_hour_end = hour;
+    }
+  return 1;
+}
+
+/* Put COUNT, seen over the N intervals up to the one at POS, evenly
+   into counter H of those intervals of RING, which has SIZE. */
+static void
+ifstat_hist_spread (unsigned short (*ring)[IFSTAT_HIST_MAX], int size,
+                    int pos, int n, int h, unsigned long count)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    ring[(pos - i + size) % size][h] =
+      ifstat_pack (count / n + (i == 0 ? count % n : 0));
+}
+
+/* Add the samples ifstat_hist_advance () started to SLOT's history. */
+void
+ifstat_hist_update (int slot)
+{
+  struct ifstat_sample *sample = ifstat_sample_get (slot);
+  struct ifstat_hist *hist = &sample->hist;
+  struct ifstat s;
+  unsigned long delta;
+  int h;
+
+  ifstat_get (slot, &s);
+  for (h = 0; h < IFSTAT_HIST_MAX; h++)
+    {
+      delta = s.c[ifstat_hist_counter[h]] - sample->hist_last[h];
+      sample->hist_last[h] = s.c[ifstat_hist_counter[h]];
+
+      ifstat_hist_spread (hist->minute, IFSTAT_HIST_MINUTES,
+                          ifstat_minute_pos, ifstat_new_minutes, h, delta);
+      sample->hist_acc[h] += delta;
+      if (ifstat_new_hours)
+        {
+          ifstat_hist_spread (hist->hour, IFSTAT_HIST_HOURS,
+                              ifstat_hour_pos, ifstat_new_hours, h,
+                              sample->hist_acc[h]);
+          sample->hist_acc[h] = 0;
+        }
+    }
+
+  if (hist->minutes + ifstat_new_minutes < IFSTAT_HIST_MINUTES)
+    hist->minutes += ifstat_new_minutes;
+  else
+    hist->minutes = IFSTAT_HIST_MINUTES;
+  if (hist->hours + ifstat_new_hours < IFSTAT_HIST_HOURS)
+    hist->hours += ifstat_new_hours;
+  else
+    hist->hours = IFSTAT_HIST_HOURS;
+}
+
+/* SLOT's history, newest sample first. */
+void
+ifstat_hist_get (int slot, struct ifstat_hist *hist)
+{
+  struct ifstat_hist *ring = &ifstat_sample_get (slot)->hist;
+  int i;
+
+  for (i = 0; i < IFSTAT_HIST_MINUTES; i++)
+    memcpy (hist->minute[i],
+            ring->minute[(ifstat_minute_pos - i + IFSTAT_HIST_MINUTES)
+                         % IFSTAT_HIST_MINUTES],
+            sizeof (hist->minute[i]));
+  for (i = 0; i < IFSTAT_HIST_HOURS; i++)
+    memcpy (hist->hour[i],
+            ring->hour[(ifstat_hour_pos - i + IFSTAT_HIST_HOURS)
+                       % IFSTAT_HIST_HOURS],
+            sizeof (hist->hour[i]));
+  hist->minutes = ring->minutes;
+  hist->hours = ring->hours;
+  hist->minute_end = ifstat_minute_end;
+  hist->hour_end = ifstat_hour_end;
+}
@@ -0,0 +1,105 @@
+/* Interface traffic counters.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_IFSTAT_H
+#define _ZEBRA_IFSTAT_H
+
+/* Counters of a port.  Each packet counter is followed by its byte
+   counter. */
+#define IFSTAT_RX_PACKETS  0
+#define IFSTAT_RX_BYTES    1
+#define IFSTAT_RX_ERRORS   2
+#define IFSTAT_RX_DROPS    3
+#define IFSTAT_TX_PACKETS  4
+#define IFSTAT_TX_BYTES    5
+#define IFSTAT_TX_ERRORS   6
+#define IFSTAT_TX_DROPS    7
+#define IFSTAT_MAX         8
+
+/* Counters are kept per thread in chunks of slots, which stay where
+   they are as the interface table grows. */
+#define IFSTAT_CHUNK_SHIFT 8
+#define IFSTAT_CHUNK_SIZE  (1 << IFSTAT_CHUNK_SHIFT)
+#define IFSTAT_CHUNKS      4096
+#define IFSTAT_SLOTS_MAX   (IFSTAT_CHUNKS * IFSTAT_CHUNK_SIZE)
+
+#define IFSTAT_CACHE_LINE  64
+
+/* Counters of a slot, a cache line of them. */
+struct ifstat
+{
+  unsigned long c[IFSTAT_MAX];
+} __attribute__ ((aligned (IFSTAT_CACHE_LINE)));
+
+/* Rates are sampled every IFSTAT_INTERVAL seconds and averaged over
+   5 seconds and 5 minutes. */
+#define IFSTAT_INTERVAL    1
+#define IFSTAT_5SEC        0
+#define IFSTAT_5MIN        1
+#define IFSTAT_WINDOWS     2
+
+/* Per second rates of the counters of a slot. */
+struct ifstat_rate
+{
+  double rate[IFSTAT_MAX][IFSTAT_WINDOWS];
+};
+
+/* History of a port: the packets and bytes received and sent in each
+   of the last 60 minutes and 24 hours. */
+#define IFSTAT_HIST_MINUTES 60
+#define IFSTAT_HIST_HOURS   24
+#define IFSTAT_HIST_MAX     4
+
+/* A count of the history, a 16-bit float: a 6-bit exponent and a
+   10-bit mantissa with its leading 1 implied, within 1/2048 of the
+   count and covering all of 64 bits.  Exponent 0 is for counts below
+   1024, which are kept as they are. */
+#define IFSTAT_UNPACK(x) \
+  ((x) >> 10 \
+   ? (unsigned long) (0x400 | ((x) & 0x3ff)) << (((x) >> 10) - 1) \
+   : (unsigned long) (x))
+
+struct ifstat_hist
+{
+  /* Newest first, MINUTES and HOURS of them are there.  The newest
+     minute ended at MINUTE_END and the newest hour at HOUR_END. */
+  unsigned short minute[IFSTAT_HIST_MINUTES][IFSTAT_HIST_MAX];
+  unsigned short hour[IFSTAT_HIST_HOURS][IFSTAT_HIST_MAX];
+  unsigned char minutes;
+  unsigned char hours;
+  time_t minute_end;
+  time_t hour_end;
+};
+
+/* Counters kept in the history, in order. */
+extern const int ifstat_hist_counter[IFSTAT_HIST_MAX];
+
+/* Prototypes. */
+void ifstat_add (int, int, unsigned long);
+void ifstat_packets (int, int, unsigned long, unsigned long);
+void ifstat_get (int, struct ifstat *);
+void ifstat_clear (int);
+void ifstat_rate_update (int, unsigned int);
+void ifstat_rate_get (int, struct ifstat_rate *);
+int ifstat_hist_advance (time_t);
+void ifstat_hist_update (int);
+void ifstat_hist_get (int, struct ifstat_hist *);
+
+#endif /* _ZEBRA_IFSTAT_H */
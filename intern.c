@@ -0,0 +1,226 @@
+/* Interned strings.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "memory.h"
+#include "vty.h"
+#include "intern.h"
+
+/* A string and its references, the caller sees STR only. */
+struct intern_entry
+{
+  struct intern_entry *next;
+  unsigned int hash;
+  unsigned int refcnt;
+  size_t len;
+  char str[1];
+};
+
+#define INTERN_ENTRY(s) \
+  ((struct intern_entry *) ((s) - offsetof (struct intern_entry, str)))
+
+#define INTERN_HASH_MIN 256
+
+static struct intern_entry **intern_hash;
+static unsigned int intern_size;
+static unsigned int intern_count;
+static unsigned long intern_refs;
+static pthread_mutex_t intern_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/* FNV-1a. */
+static unsigned int
+intern_hash_str (const char *str, size_t len)
+{
+  unsigned int h = 2166136261U;
+
+  while (len--)
+    {
+      h ^= (unsigned char) *str++;
+      h *= 16777619U;
+    }
+  return h;
+}
+
+static void
+intern_grow (void)
+{
+  struct intern_entry **hash;
+  struct intern_entry *e;
+  struct intern_entry *next;
+  unsigned int size;
+  unsigned int i;
+
+  size = intern_size ? intern_size * 2 : INTERN_HASH_MIN;
+  hash = XCALLOC (MTYPE_INTERN, sizeof (struct intern_entry *) * size);
+
+  for (i = 0; i < intern_size; i++)
+    for (e = intern_hash[i]; e; e = next)
+      {
+        next = e->next;
+        e->next = hash[e->hash & (size - 1)];
+        hash[e->hash & (size - 1)] = e;
+      }
+
+  if (intern_hash)
+    XFREE (MTYPE_INTERN, intern_hash);
+  intern_hash = hash;
+  intern_size = size;
+}
+
+/* Find STR of LEN bytes, with intern_mtx held. */
+static struct intern_entry *
+intern_find (const char *str, size_t len, unsigned int hash)
+{
+  struct intern_entry *e;
+
+  if (intern_size == 0)
+    return NULL;
+
+  for (e = intern_hash[hash & (intern_size - 1)]; e; e = e->next)
+    if (e->hash == hash && e->len == len && memcmp (e->str, str, len) == 0)
+      return e;
+  return NULL;
+}
+
+/* Intern the first LEN bytes of STR. */
+char *
+intern_n (const char *str, size_t len)
+{
+  struct intern_entry *e;
+  unsigned int hash;
+
+  hash = intern_hash_str (str, len);
+
+  pthread_mutex_lock (&intern_mtx);
+  e = intern_find (str, len, hash);
+  if (e == NULL)
+    {
+      if (intern_count >= intern_size)
+        intern_grow ();
+
+      e = XMALLOC (MTYPE_INTERN, sizeof (struct intern_entry) + len);
+      e->hash = hash;
+      e->refcnt = 0;
+      e->len = len;
+      memcpy (e->str, str, len);
+      e->str[len] = '\0';
+
+      e->next = intern_hash[hash & (intern_size - 1)];
+      intern_hash[hash & (intern_size - 1)] = e;
+      intern_count++;
+    }
+  e->refcnt++;
+  intern_refs++;
+  pthread_mutex_unlock (&intern_mtx);
+
+  return e->str;
+}
+
+/* Intern STR, the result holds a reference. */
+char *
+intern (const char *str)
+{
+  return intern_n (str, strlen (str));
+}
+
+/* Take another reference to interned string S. */
+char *
+intern_ref (char *s)
+{
+  pthread_mutex_lock (&intern_mtx);
+  INTERN_ENTRY (s)->refcnt++;
+  intern_refs++;
+  pthread_mutex_unlock (&intern_mtx);
+
+  return s;
+}
+
+/* Drop a reference to interned string S. */
+void
+intern_unref (char *s)
+{
+  struct intern_entry *e;
+  struct intern_entry **ep;
+
+  if (s == NULL)
+    return;
+
+  e = INTERN_ENTRY (s);
+
+  pthread_mutex_lock (&intern_mtx);
+  intern_refs--;
+  if (--e->refcnt == 0)
+    {
+      for (ep = &intern_hash[e->hash & (intern_size - 1)]; *ep;
+           ep = &(*ep)->next)
+        if (*ep == e)
+          {
+            *ep = e->next;
+            break;
+          }
+      intern_count--;
+      XFREE (MTYPE_INTERN, e);
+    }
+  pthread_mutex_unlock (&intern_mtx);
+}
+
+/* The interned copy of STR if there is one.  No reference is taken,
+   it's meant for comparing against strings known to be held. */
+char *
+intern_lookup (const char *str)
+{
+  struct intern_entry *e;
+  size_t len = strlen (str);
+  unsigned int hash;
+
+  hash = intern_hash_str (str, len);
+
+  pthread_mutex_lock (&intern_mtx);
+  e = intern_find (str, len, hash);
+  pthread_mutex_unlock (&intern_mtx);
+
+  return e ? e->str : NULL;
+}
+
+void
+intern_show (struct vty *vty)
+{
+  struct intern_entry *e;
+  unsigned long bytes = 0;
+  unsigned long saved = 0;
+  unsigned int i;
+
+  pthread_mutex_lock (&intern_mtx);
+  for (i = 0; i < intern_size; i++)
+    for (e = intern_hash[i]; e; e = e->next)
+      {
+        bytes += e->len + 1;
+        saved += (e->refcnt - 1) * (e->len + 1);
+      }
+  vty_out (vty, "Strings:     %u%s", intern_count, VTY_NEWLINE);
+  vty_out (vty, "References:  %lu%s", intern_refs, VTY_NEWLINE);
+  vty_out (vty, "Bytes:       %lu%s", bytes, VTY_NEWLINE);
+  vty_out (vty, "Bytes saved: %lu%s", saved, VTY_NEWLINE);
+  pthread_mutex_unlock (&intern_mtx);
+}
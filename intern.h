@@ -0,0 +1,38 @@
+/* Interned strings.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_INTERN_H
+#define _ZEBRA_INTERN_H
+
+/* An interned string exists once, equal strings are the same pointer.
+   It's shared, so it must never be written to, and it's given back
+   with intern_unref () instead of XFREE (). */
+
+struct vty;
+
+/* Prototypes. */
+char *intern (const char *);
+char *intern_n (const char *, size_t);
+char *intern_ref (char *);
+void intern_unref (char *);
+char *intern_lookup (const char *);
+void intern_show (struct vty *);
+
+#endif /* _ZEBRA_INTERN_H */
@@ -0,0 +1,1110 @@
+/* I/O backends of the vty event loop.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <poll.h>
+#include <sys/select.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#define HAVE_EPOLL
+#endif /* __linux__ */
+#if defined (__linux__) && defined (__has_include)
+#if __has_include (<linux/io_uring.h>)
+#include <linux/io_uring.h>
+/* Multishot recv and single issuer rings are 6.0 features, provided
+   buffer rings and fd cancellation 5.19 ones and the wait timeout
+   argument 5.11.  Older headers fall back to epoll. */
+#if defined (IORING_RECV_MULTISHOT) && defined (IORING_SETUP_SINGLE_ISSUER) \
+  && defined (IORING_ASYNC_CANCEL_ALL) && defined (IORING_ENTER_EXT_ARG)
+#define HAVE_IO_URING
+#endif
+#endif
+#endif
+
+#include "memory.h"
+#include "log.h"
+#include "command.h"
+#include "ioloop.h"
+
+/* State of a descriptor known to the event loop. */
+struct io_fd
+{
+  unsigned char used;
+
+  /* Backend may read data of this descriptor itself. */
+  unsigned char stream;
+
+  /* Caller wants to hear about input. */
+  unsigned char on;
+
+  /* Input arrived while ON was off, or for streams: the read has to
+     be armed again. */
+  unsigned char ready;
+
+  /* Bumped when the descriptor goes away, completions of the previous
+     user are recognized by it. */
+  unsigned int gen;
+
+  /* io_uring write slots: being filled and being written, and the
+     output which is waiting for a slot behind them. */
+  int fill;
+  int flight;
+  unsigned char *spill;
+  size_t spill_len;
+  size_t spill_size;
+};
+
+struct io_backend
+{
+  const char *name;
+  int (*init) (void);
+  void (*add) (int, struct io_fd *);
+  void (*del) (int, struct io_fd *);
+  void (*enable) (int, struct io_fd *);
+  int (*wait) (struct io_event *, int, int);
+  void (*done) (struct io_event *);
+  ssize_t (*writev) (int, const struct iovec *, int);
+};
+
+static struct io_backend *io_backend;
+
+/* Descriptor table indexed by fd. */
+static struct io_fd *io_fds;
+static int io_fds_max;
+
+/* Counters for "show io". */
+static struct
+{
+  unsigned long waits;
+  unsigned long events;
+  unsigned long syscalls;
+  unsigned long submits;
+} io_stat;
+
+static struct io_fd *
+io_fd_lookup (int fd)
+{
+  if (fd < 0 || fd >= io_fds_max || ! io_fds[fd].used)
+    return NULL;
+  return &io_fds[fd];
+}
+
+static struct io_fd *
+io_fd_get (int fd)
+{
+  int max;
+
+  if (fd >= io_fds_max)
+    {
+      max = io_fds_max ? io_fds_max : 64;
+      while (max <= fd)
+        max *= 2;
+      io_fds = XREALLOC (MTYPE_THREAD_MASTER, io_fds,
+                         sizeof (struct io_fd) * max);
+      memset (io_fds + io_fds_max, 0,
+              sizeof (struct io_fd) * (max - io_fds_max));
+      io_fds_max = max;
+    }
+  return &io_fds[fd];
+}
+
+/* select () backend. */
+static int
+select_init (void)
+{
+  return 0;
+}
+
+static int
+select_wait (struct io_event *ev, int max, int msec)
+{
+  struct timeval tv;
+  fd_set set;
+  int fd, maxfd, n, ret;
+
+  FD_ZERO (&set);
+  maxfd = -1;
+  for (fd = 0; fd < io_fds_max && fd < FD_SETSIZE; fd++)
+    if (io_fds[fd].used && io_fds[fd].on)
+      {
+        FD_SET (fd, &set);
+        maxfd = fd;
+      }
+
+  tv.tv_sec = msec / 1000;
+  tv.tv_usec = (msec % 1000) * 1000;
+  io_stat.syscalls++;
+  ret = select (maxfd + 1, &set, NULL, NULL, &tv);
+  if (ret <= 0)
+    return 0;
+
+  for (n = 0, fd = 0; fd <= maxfd && n < max; fd++)
+    if (FD_ISSET (fd, &set))
+      {
+        memset (&ev[n], 0, sizeof (struct io_event));
+        ev[n].fd = fd;
+        ev[n].bid = -1;
+        n++;
+      }
+  return n;
+}
+
+static struct io_backend io_select =
+{
+  "select",
+  select_init,
+  NULL,
+  NULL,
+  NULL,
+  select_wait,
+  NULL,
+  NULL,
+};
+
+#ifdef HAVE_EPOLL
+/* epoll backend, interest only changes when a session is paused. */
+static int epoll_fd = -1;
+
+static int
+epoll_init (void)
+{
+  epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  return epoll_fd < 0 ? -1 : 0;
+}
+
+static void
+epoll_ctl_fd (int op, int fd, struct io_fd *f)
+{
+  struct epoll_event ee;
+
+  memset (&ee, 0, sizeof ee);
+  ee.events = f->on ? EPOLLIN : 0;
+  ee.data.fd = fd;
+  io_stat.syscalls++;
+  if (epoll_ctl (epoll_fd, op, fd, &ee) < 0)
+    zlog_warn ("epoll_ctl fd %d: %s", fd, strerror (errno));
+}
+
+static void
+epoll_add (int fd, struct io_fd *f)
+{
+  epoll_ctl_fd (EPOLL_CTL_ADD, fd, f);
+}
+
+static void
+epoll_del (int fd, struct io_fd *f)
+{
+  epoll_ctl_fd (EPOLL_CTL_DEL, fd, f);
+}
+
+static void
+epoll_enable (int fd, struct io_fd *f)
+{
+  epoll_ctl_fd (EPOLL_CTL_MOD, fd, f);
+}
+
+static int
+epoll_wait_events (struct io_event *ev, int max, int msec)
+{
+  struct epoll_event ee[IO_EVENTS_MAX];
+  int i, n;
+
+  if (max > IO_EVENTS_MAX)
+    max = IO_EVENTS_MAX;
+
+  io_stat.syscalls++;
+  n = epoll_wait (epoll_fd, ee, max, msec);
+  for (i = 0; i < n; i++)
+    {
+      memset (&ev[i], 0, sizeof (struct io_event));
+      ev[i].fd = ee[i].data.fd;
+      ev[i].bid = -1;
+    }
+  return n < 0 ? 0 : n;
+}
+
+static struct io_backend io_epoll =
+{
+  "epoll",
+  epoll_init,
+  epoll_add,
+  epoll_del,
+  epoll_enable,
+  epoll_wait_events,
+  NULL,
+  NULL,
+};
+#endif /* HAVE_EPOLL */
+
+#ifdef HAVE_IO_URING
+/* io_uring backend.  Sessions are read with multishot recv into a
+   ring of provided buffers, other descriptors are watched with
+   multishot poll.  Session output is copied into registered buffers
+   and written with WRITE_FIXED; everything queued during a loop
+   iteration goes to the kernel with the wait in one io_uring_enter.
+   Output never waits for the kernel: what doesn't fit in a session's
+   slots is kept behind them until they are written. */
+
+#define URING_ENTRIES   256
+#define URING_RBUFS     64
+#define URING_RBUF_SIZE 1024
+#define URING_WSLOTS    64
+#define URING_WSLOT_SIZE 8192
+#define URING_BGID      0
+
+/* Completion kinds, kept in user_data with the descriptor and its
+   generation. */
+#define URING_RECV   1
+#define URING_POLL   2
+#define URING_WRITE  3
+#define URING_CANCEL 4
+
+#define URING_DATA(gen,kind,id) \
+  (((__u64) (gen) << 32) | ((__u64) (kind) << 24) | (__u64) (id))
+#define URING_GEN(data)  ((unsigned int) ((data) >> 32))
+#define URING_KIND(data) ((int) (((data) >> 24) & 0xff))
+#define URING_ID(data)   ((int) ((data) & 0xffffff))
+
+static int uring_fd = -1;
+
+static struct
+{
+  unsigned int *khead;
+  unsigned int *ktail;
+  unsigned int mask;
+  unsigned int entries;
+  unsigned int *array;
+  struct io_uring_sqe *sqes;
+  unsigned int tail;
+  unsigned int submitted;
+} uring_sq;
+
+static struct
+{
+  unsigned int *khead;
+  unsigned int *ktail;
+  unsigned int mask;
+  struct io_uring_cqe *cqes;
+} uring_cq;
+
+static void *uring_ring;
+static size_t uring_ring_size;
+static size_t uring_sqes_size;
+
+/* Provided receive buffers. */
+static struct io_uring_buf_ring *uring_br;
+static unsigned char *uring_rbufs;
+
+/* Registered write buffers. */
+static unsigned char *uring_wbufs;
+static struct
+{
+  int fd;
+  unsigned int gen;
+  unsigned int len;
+  unsigned int off;
+  int next_free;
+} uring_wslot[URING_WSLOTS];
+static int uring_wfree = -1;
+
+/* Events reaped but not handed out yet. */
+static struct io_event *uring_evq;
+static int uring_evq_head;
+static int uring_evq_len;
+static int uring_evq_size;
+
+static int
+uring_enter (unsigned int submit, unsigned int wait, unsigned int flags,
+             void *arg, size_t argsz)
+{
+  io_stat.syscalls++;
+  return syscall (__NR_io_uring_enter, uring_fd, submit, wait, flags,
+                  arg, argsz);
+}
+
+static int
+uring_submit (unsigned int wait, unsigned int flags, void *arg,
+              size_t argsz)
+{
+  unsigned int submit;
+  int ret;
+
+  __atomic_store_n (uring_sq.ktail, uring_sq.tail, __ATOMIC_RELEASE);
+  submit = uring_sq.tail - uring_sq.submitted;
+  ret = uring_enter (submit, wait, flags, arg, argsz);
+  if (ret > 0)
+    {
+      uring_sq.submitted += ret;
+      io_stat.submits += ret;
+    }
+  return ret;
+}
+
+static struct io_uring_sqe *
+uring_sqe (void)
+{
+  struct io_uring_sqe *sqe;
+  unsigned int head;
+  unsigned int idx;
+
+  head = __atomic_load_n (uring_sq.khead, __ATOMIC_ACQUIRE);
+  if (uring_sq.tail - head == uring_sq.entries)
+    {
+      uring_submit (0, 0, NULL, 0);
+      head = __atomic_load_n (uring_sq.khead, __ATOMIC_ACQUIRE);
+      if (uring_sq.tail - head == uring_sq.entries)
+        return NULL;
+    }
+
+  idx = uring_sq.tail & uring_sq.mask;
+  sqe = &uring_sq.sqes[idx];
+  memset (sqe, 0, sizeof (struct io_uring_sqe));
+  uring_sq.array[idx] = idx;
+  uring_sq.tail++;
+  return sqe;
+}
+
+static void
+uring_arm (int fd, struct io_fd *f)
+{
+  struct io_uring_sqe *sqe;
+
+  sqe = uring_sqe ();
+  if (sqe == NULL)
+    return;
+
+  sqe->fd = fd;
+  if (f->stream)
+    {
+      sqe->opcode = IORING_OP_RECV;
+      sqe->ioprio = IORING_RECV_MULTISHOT;
+      sqe->flags = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = URING_BGID;
+      sqe->user_data = URING_DATA (f->gen, URING_RECV, fd);
+    }
+  else
+    {
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->poll32_events = POLLIN;
+      sqe->len = IORING_POLL_ADD_MULTI;
+      sqe->user_data = URING_DATA (f->gen, URING_POLL, fd);
+    }
+}
+
+static void
+uring_rbuf_put (int bid)
+{
+  struct io_uring_buf *buf;
+  unsigned short tail;
+
+  tail = uring_br->tail;
+  buf = &uring_br->bufs[tail & (URING_RBUFS - 1)];
+  buf->addr = (__u64) (unsigned long) (uring_rbufs + bid * URING_RBUF_SIZE);
+  buf->len = URING_RBUF_SIZE;
+  buf->bid = bid;
+  __atomic_store_n (&uring_br->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void
+uring_evq_push (int fd, unsigned int gen, unsigned char *data, int len,
+                int bid)
+{
+  struct io_event *ev;
+
+  if (uring_evq_head + uring_evq_len == uring_evq_size)
+    {
+      if (uring_evq_head)
+        {
+          memmove (uring_evq, uring_evq + uring_evq_head,
+                   sizeof (struct io_event) * uring_evq_len);
+          uring_evq_head = 0;
+        }
+      else
+        {
+          uring_evq_size = uring_evq_size ? uring_evq_size * 2 : 64;
+          uring_evq = XREALLOC (MTYPE_THREAD_MASTER, uring_evq,
+                                sizeof (struct io_event) * uring_evq_size);
+        }
+    }
+
+  ev = &uring_evq[uring_evq_head + uring_evq_len++];
+  ev->fd = fd;
+  ev->data = data;
+  ev->len = len;
+  ev->bid = bid;
+  ev->gen = gen;
+}
+
+static void
+uring_write_slot (int slot)
+{
+  struct io_uring_sqe *sqe;
+
+  sqe = uring_sqe ();
+  if (sqe == NULL)
+    return;
+
+  sqe->opcode = IORING_OP_WRITE_FIXED;
+  sqe->fd = uring_wslot[slot].fd;
+  sqe->off = (__u64) -1;
+  sqe->addr = (__u64) (unsigned long) (uring_wbufs + slot * URING_WSLOT_SIZE
+                                       + uring_wslot[slot].off);
+  sqe->len = uring_wslot[slot].len - uring_wslot[slot].off;
+  sqe->buf_index = slot;
+  sqe->user_data = URING_DATA (uring_wslot[slot].gen, URING_WRITE, slot);
+}
+
+static void
+uring_wslot_put (int slot)
+{
+  uring_wslot[slot].next_free = uring_wfree;
+  uring_wfree = slot;
+}
+
+/* Slot FD's output is copied into, a free one is taken when there is
+   none.  Returns -1 when all are in use. */
+static int
+uring_fill_get (int fd, struct io_fd *f)
+{
+  int slot;
+
+  if (f->fill >= 0 || uring_wfree < 0)
+    return f->fill;
+
+  slot = uring_wfree;
+  uring_wfree = uring_wslot[slot].next_free;
+  uring_wslot[slot].fd = fd;
+  uring_wslot[slot].gen = f->gen;
+  uring_wslot[slot].len = 0;
+  uring_wslot[slot].off = 0;
+  f->fill = slot;
+  return slot;
+}
+
+/* Move what waits for a slot into the one being filled. */
+static void
+uring_spill_move (int fd, struct io_fd *f)
+{
+  size_t n;
+  int slot;
+
+  if (f->spill_len == 0 || (slot = uring_fill_get (fd, f)) < 0)
+    return;
+
+  n = URING_WSLOT_SIZE - uring_wslot[slot].len;
+  if (n > f->spill_len)
+    n = f->spill_len;
+  memcpy (uring_wbufs + slot * URING_WSLOT_SIZE + uring_wslot[slot].len,
+          f->spill, n);
+  uring_wslot[slot].len += n;
+  f->spill_len -= n;
+  memmove (f->spill, f->spill + n, f->spill_len);
+}
+
+/* Start writing the slot being filled unless one is being written. */
+static void
+uring_write_start (int fd, struct io_fd *f)
+{
+  if (f->fill < 0 || f->flight >= 0)
+    return;
+  f->flight = f->fill;
+  f->fill = -1;
+  uring_write_slot (f->flight);
+  uring_spill_move (fd, f);
+}
+
+/* Drop all output of FD but the slot being written, which the kernel
+   may still read. */
+static void
+uring_write_drop (struct io_fd *f)
+{
+  if (f->fill >= 0)
+    {
+      uring_wslot_put (f->fill);
+      f->fill = -1;
+    }
+  if (f->spill)
+    XFREE (MTYPE_THREAD_MASTER, f->spill);
+  f->spill = NULL;
+  f->spill_len = f->spill_size = 0;
+}
+
+static void
+uring_write_done (int slot, int res)
+{
+  struct io_fd *f;
+  int fd = uring_wslot[slot].fd;
+  unsigned int gen = uring_wslot[slot].gen;
+
+  /* The session has gone, or the write was cancelled with it. */
+  f = io_fd_lookup (fd);
+  if (f == NULL || f->gen != gen || f->flight != slot)
+    {
+      uring_wslot_put (slot);
+      return;
+    }
+
+  /* Short write, go on with the rest. */
+  if (res > 0 && uring_wslot[slot].off + res < uring_wslot[slot].len)
+    {
+      uring_wslot[slot].off += res;
+      uring_write_slot (slot);
+      return;
+    }
+  if (res == -EAGAIN || res == -EINTR)
+    {
+      uring_write_slot (slot);
+      return;
+    }
+
+  f->flight = -1;
+  uring_wslot_put (slot);
+
+  /* The session is gone, drop what's queued behind and have it closed
+     like at the end of its input. */
+  if (res <= 0)
+    {
+      uring_write_drop (f);
+      uring_evq_push (fd, gen, (unsigned char *) "", res ? res : -EPIPE, -1);
+      return;
+    }
+
+  uring_spill_move (fd, f);
+  uring_write_start (fd, f);
+}
+
+/* Move completions to the event queue. */
+static void
+uring_reap (void)
+{
+  struct io_uring_cqe *cqe;
+  struct io_fd *f;
+  unsigned int head, tail;
+  __u64 data;
+  int fd, bid;
+
+  head = *uring_cq.khead;
+  tail = __atomic_load_n (uring_cq.ktail, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; head++)
+    {
+      cqe = &uring_cq.cqes[head & uring_cq.mask];
+      data = cqe->user_data;
+      fd = URING_ID (data);
+
+      switch (URING_KIND (data))
+        {
+        case URING_WRITE:
+          uring_write_done (fd, cqe->res);
+          break;
+        case URING_RECV:
+          bid = (cqe->flags & IORING_CQE_F_BUFFER)
+            ? (int) (cqe->flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+          f = io_fd_lookup (fd);
+          if (f == NULL || f->gen != URING_GEN (data))
+            {
+              if (bid >= 0)
+                uring_rbuf_put (bid);
+              break;
+            }
+          if (cqe->res == -ENOBUFS)
+            f->ready = 1;
+          else if (bid >= 0)
+            uring_evq_push (fd, f->gen, uring_rbufs + bid * URING_RBUF_SIZE,
+                            cqe->res, bid);
+          else
+            uring_evq_push (fd, f->gen, (unsigned char *) "", cqe->res, -1);
+
+          /* Re-arm unless the stream has ended. */
+          if (! (cqe->flags & IORING_CQE_F_MORE) && cqe->res > 0)
+            uring_arm (fd, f);
+          break;
+        case URING_POLL:
+          f = io_fd_lookup (fd);
+          if (f == NULL || f->gen != URING_GEN (data))
+            break;
+          if (f->on)
+            uring_evq_push (fd, f->gen, NULL, 0, -1);
+          else
+            f->ready = 1;
+          if (! (cqe->flags & IORING_CQE_F_MORE) && cqe->res != -ECANCELED)
+            uring_arm (fd, f);
+          break;
+        default:
+          break;
+        }
+    }
+
+  __atomic_store_n (uring_cq.khead, head, __ATOMIC_RELEASE);
+}
+
+/* Queue output for FD, which is never refused: what doesn't fit in
+   the slot being filled waits behind it. */
+static ssize_t
+uring_writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct io_fd *f;
+  unsigned char *p;
+  size_t total;
+  int i, slot = -1;
+
+  f = io_fd_lookup (fd);
+  if (f == NULL || ! f->stream)
+    {
+      io_stat.syscalls++;
+      return writev (fd, iov, iovcnt);
+    }
+
+  for (total = 0, i = 0; i < iovcnt; i++)
+    total += iov[i].iov_len;
+
+  if (f->spill_len == 0 && (slot = uring_fill_get (fd, f)) >= 0
+      && uring_wslot[slot].len + total > URING_WSLOT_SIZE)
+    slot = -1;
+
+  if (slot >= 0)
+    p = uring_wbufs + slot * URING_WSLOT_SIZE + uring_wslot[slot].len;
+  else
+    {
+      if (f->spill_len + total > f->spill_size)
+        {
+          while (f->spill_len + total > f->spill_size)
+            f->spill_size = f->spill_size ? f->spill_size * 2
+              : URING_WSLOT_SIZE;
+          f->spill = XREALLOC (MTYPE_THREAD_MASTER, f->spill, f->spill_size);
+        }
+      p = f->spill + f->spill_len;
+    }
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      memcpy (p, iov[i].iov_base, iov[i].iov_len);
+      p += iov[i].iov_len;
+    }
+  if (slot >= 0)
+    uring_wslot[slot].len += total;
+  else
+    {
+      f->spill_len += total;
+      uring_spill_move (fd, f);
+    }
+  return total;
+}
+
+static int
+uring_probe (void)
+{
+  struct io_uring_probe *probe;
+  size_t size;
+  int ops[] = { IORING_OP_RECV, IORING_OP_POLL_ADD, IORING_OP_WRITE_FIXED,
+                IORING_OP_ASYNC_CANCEL };
+  int i, ret;
+
+  size = sizeof (struct io_uring_probe)
+    + 256 * sizeof (struct io_uring_probe_op);
+  probe = XCALLOC (MTYPE_TMP, size);
+  ret = syscall (__NR_io_uring_register, uring_fd, IORING_REGISTER_PROBE,
+                 probe, 256);
+  for (i = 0; ret >= 0 && i < sizeof ops / sizeof ops[0]; i++)
+    if (ops[i] > probe->last_op
+        || ! (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+      ret = -1;
+  XFREE (MTYPE_TMP, probe);
+  return ret < 0 ? -1 : 0;
+}
+
+static int
+uring_init (void)
+{
+  struct io_uring_params p;
+  struct io_uring_buf_reg reg;
+  struct iovec iov[URING_WSLOTS];
+  unsigned char *ring;
+  void *sqes;
+  int i;
+
+  memset (&p, 0, sizeof p);
+  p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+  uring_fd = syscall (__NR_io_uring_setup, URING_ENTRIES, &p);
+  if (uring_fd < 0 && errno == EINVAL)
+    {
+      memset (&p, 0, sizeof p);
+      uring_fd = syscall (__NR_io_uring_setup, URING_ENTRIES, &p);
+    }
+  if (uring_fd < 0)
+    return -1;
+
+  if (! (p.features & IORING_FEAT_SINGLE_MMAP)
+      || ! (p.features & IORING_FEAT_EXT_ARG)
+      || uring_probe () < 0)
+    goto fail;
+
+  uring_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned int);
+  if (p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe)
+      > uring_ring_size)
+    uring_ring_size = p.cq_off.cqes
+      + p.cq_entries * sizeof (struct io_uring_cqe);
+  uring_ring = mmap (NULL, uring_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, uring_fd, IORING_OFF_SQ_RING);
+  if (uring_ring == MAP_FAILED)
+    goto fail;
+  uring_sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  sqes = mmap (NULL, uring_sqes_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, uring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+    goto fail;
+
+  ring = uring_ring;
+  uring_sq.khead = (unsigned int *) (ring + p.sq_off.head);
+  uring_sq.ktail = (unsigned int *) (ring + p.sq_off.tail);
+  uring_sq.mask = *(unsigned int *) (ring + p.sq_off.ring_mask);
+  uring_sq.entries = *(unsigned int *) (ring + p.sq_off.ring_entries);
+  uring_sq.array = (unsigned int *) (ring + p.sq_off.array);
+  uring_sq.sqes = sqes;
+  uring_sq.tail = uring_sq.submitted = *uring_sq.ktail;
+  uring_cq.khead = (unsigned int *) (ring + p.cq_off.head);
+  uring_cq.ktail = (unsigned int *) (ring + p.cq_off.tail);
+  uring_cq.mask = *(unsigned int *) (ring + p.cq_off.ring_mask);
+  uring_cq.cqes = (struct io_uring_cqe *) (ring + p.cq_off.cqes);
+
+  /* Receive buffers. */
+  uring_br = mmap (NULL, URING_RBUFS * sizeof (struct io_uring_buf),
+                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  uring_rbufs = mmap (NULL, URING_RBUFS * URING_RBUF_SIZE,
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+  if (uring_br == MAP_FAILED || uring_rbufs == MAP_FAILED)
+    goto fail;
+  memset (&reg, 0, sizeof reg);
+  reg.ring_addr = (__u64) (unsigned long) uring_br;
+  reg.ring_entries = URING_RBUFS;
+  reg.bgid = URING_BGID;
+  if (syscall (__NR_io_uring_register, uring_fd, IORING_REGISTER_PBUF_RING,
+               &reg, 1) < 0)
+    goto fail;
+  for (i = 0; i < URING_RBUFS; i++)
+    uring_rbuf_put (i);
+
+  /* Write buffers. */
+  uring_wbufs = mmap (NULL, URING_WSLOTS * URING_WSLOT_SIZE,
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+  if (uring_wbufs == MAP_FAILED)
+    goto fail;
+  for (i = 0; i < URING_WSLOTS; i++)
+    {
+      iov[i].iov_base = uring_wbufs + i * URING_WSLOT_SIZE;
+      iov[i].iov_len = URING_WSLOT_SIZE;
+      uring_wslot[i].next_free = uring_wfree;
+      uring_wfree = i;
+    }
+  if (syscall (__NR_io_uring_register, uring_fd, IORING_REGISTER_BUFFERS,
+               iov, URING_WSLOTS) < 0)
+    goto fail;
+
+  return 0;
+
+ fail:
+  /* Closing the ring releases everything registered with it, the
+     mappings are only a few pages and stay. */
+  close (uring_fd);
+  uring_fd = -1;
+  return -1;
+}
+
+static void
+uring_add (int fd, struct io_fd *f)
+{
+  uring_arm (fd, f);
+}
+
+static void
+uring_del (int fd, struct io_fd *f)
+{
+  struct io_uring_sqe *sqe;
+
+  /* Output not written yet is dropped, the write under way is
+     cancelled with the rest and its slot freed when it completes. */
+  uring_write_drop (f);
+  f->flight = -1;
+
+  sqe = uring_sqe ();
+  if (sqe)
+    {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = fd;
+      sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+      sqe->user_data = URING_DATA (f->gen, URING_CANCEL, fd);
+    }
+
+  /* The descriptor is closed next, the cancel must reach the kernel
+     before. */
+  uring_submit (0, 0, NULL, 0);
+}
+
+/* Streams keep being read, the caller holds on to the data. */
+static void
+uring_enable (int fd, struct io_fd *f)
+{
+  if (! f->stream && f->on && f->ready)
+    {
+      f->ready = 0;
+      uring_evq_push (fd, f->gen, NULL, 0, -1);
+    }
+}
+
+static int
+uring_wait (struct io_event *ev, int max, int msec)
+{
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  struct io_event *e;
+  struct io_fd *f;
+  int fd, n;
+
+  /* Start writing what has been queued since the last wait, receives
+     which ran out of buffers go on now they have been given back. */
+  for (fd = 0; fd < io_fds_max; fd++)
+    {
+      f = &io_fds[fd];
+      if (! f->used)
+        continue;
+      uring_spill_move (fd, f);
+      uring_write_start (fd, f);
+      if (f->stream && f->ready)
+        {
+          f->ready = 0;
+          uring_arm (fd, f);
+        }
+    }
+
+  if (uring_evq_len)
+    {
+      if (uring_sq.tail != uring_sq.submitted)
+        uring_submit (0, 0, NULL, 0);
+    }
+  else
+    {
+      memset (&arg, 0, sizeof arg);
+      ts.tv_sec = msec / 1000;
+      ts.tv_nsec = (msec % 1000) * 1000000L;
+      arg.ts = (__u64) (unsigned long) &ts;
+      uring_submit (1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                    &arg, sizeof arg);
+    }
+  uring_reap ();
+
+  for (n = 0; n < max && uring_evq_len; )
+    {
+      e = &uring_evq[uring_evq_head++];
+      uring_evq_len--;
+
+      /* Completions for a descriptor which has gone meanwhile. */
+      f = io_fd_lookup (e->fd);
+      if (f == NULL || f->gen != e->gen)
+        {
+          if (e->bid >= 0)
+            uring_rbuf_put (e->bid);
+          continue;
+        }
+      ev[n++] = *e;
+    }
+  if (uring_evq_len == 0)
+    uring_evq_head = 0;
+
+  return n;
+}
+
+static void
+uring_done (struct io_event *ev)
+{
+  if (ev->bid >= 0)
+    uring_rbuf_put (ev->bid);
+  ev->bid = -1;
+}
+
+static struct io_backend io_uring =
+{
+  "io_uring",
+  uring_init,
+  uring_add,
+  uring_del,
+  uring_enable,
+  uring_wait,
+  uring_done,
+  uring_writev,
+};
+#endif /* HAVE_IO_URING */
+
+static struct io_backend *io_backends[] =
+{
+#ifdef HAVE_IO_URING
+  &io_uring,
+#endif /* HAVE_IO_URING */
+#ifdef HAVE_EPOLL
+  &io_epoll,
+#endif /* HAVE_EPOLL */
+  &io_select,
+  NULL
+};
+
+/* Select the backend called NAME, or the best one which works when
+   NAME is NULL or can't be used. */
+int
+io_init (const char *name)
+{
+  int i;
+
+  if (name)
+    for (i = 0; io_backends[i]; i++)
+      if (strcmp (io_backends[i]->name, name) == 0)
+        {
+          if ((*io_backends[i]->init) () == 0)
+            {
+              io_backend = io_backends[i];
+              return 0;
+            }
+          zlog_warn ("I/O backend %s isn't available", name);
+          break;
+        }
+
+  for (i = 0; io_backends[i]; i++)
+    if ((*io_backends[i]->init) () == 0)
+      {
+        io_backend = io_backends[i];
+        return 0;
+      }
+  return -1;
+}
+
+const char *
+io_name (void)
+{
+  return io_backend ? io_backend->name : "none";
+}
+
+/* Watch FD for input.  STREAM descriptors may be read by the backend
+   itself. */
+void
+io_add (int fd, int stream)
+{
+  struct io_fd *f;
+
+  f = io_fd_get (fd);
+  f->used = 1;
+  f->stream = stream;
+  f->on = 1;
+  f->ready = 0;
+  f->fill = f->flight = -1;
+  if (io_backend->add)
+    (*io_backend->add) (fd, f);
+}
+
+/* Forget FD, called before it's closed. */
+void
+io_del (int fd)
+{
+  struct io_fd *f;
+
+  f = io_fd_lookup (fd);
+  if (f == NULL)
+    return;
+  if (io_backend->del)
+    (*io_backend->del) (fd, f);
+  f->used = 0;
+  f->gen++;
+}
+
+/* Turn reporting of input on FD on or off. */
+void
+io_enable (int fd, int on)
+{
+  struct io_fd *f;
+
+  f = io_fd_lookup (fd);
+  if (f == NULL || f->on == on)
+    return;
+  f->on = on;
+  if (io_backend->enable)
+    (*io_backend->enable) (fd, f);
+}
+
+/* Wait up to MSEC milliseconds and return the events, at most MAX. */
+int
+io_wait (struct io_event *ev, int max, int msec)
+{
+  int n;
+
+  n = (*io_backend->wait) (ev, max, msec);
+  io_stat.waits++;
+  io_stat.events += n;
+  return n;
+}
+
+/* Give back the data of an event. */
+void
+io_done (struct io_event *ev)
+{
+  if (io_backend->done)
+    (*io_backend->done) (ev);
+}
+
+ssize_t
+io_read (int fd, void *buf, size_t len)
+{
+  io_stat.syscalls++;
+  return read (fd, buf, len);
+}
+
+ssize_t
+io_writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  if (io_backend && io_backend->writev)
+    return (*io_backend->writev) (fd, iov, iovcnt);
+  io_stat.syscalls++;
+  return writev (fd, iov, iovcnt);
+}
+
+DEFUN (show_io,
+       show_io_cmd,
+       "show io",
+       SHOW_STR
+       "Event loop I/O\n")
+{
+  vty_out (vty, "Backend:       %s%s", io_name (), VTY_NEWLINE);
+  vty_out (vty, "Waits:         %lu%s", io_stat.waits, VTY_NEWLINE);
+  vty_out (vty, "Events:        %lu%s", io_stat.events, VTY_NEWLINE);
+  vty_out (vty, "System calls:  %lu%s", io_stat.syscalls, VTY_NEWLINE);
+#ifdef HAVE_IO_URING
+  if (io_backend == &io_uring)
+    vty_out (vty, "Submissions:   %lu%s", io_stat.submits, VTY_NEWLINE);
+#endif /* HAVE_IO_URING */
+  return CMD_SUCCESS;
+}
+
+void
+io_cmd_init (void)
+{
+  install_element (VIEW_NODE, &show_io_cmd);
+  install_element (ENABLE_NODE, &show_io_cmd);
+}
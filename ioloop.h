@@ -0,0 +1,56 @@
+/* I/O backends of the vty event loop.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_IOLOOP_H
+#define _ZEBRA_IOLOOP_H
+
+#include <sys/uio.h>
+
+/* Something happened on a descriptor.  DATA is NULL when FD is just
+   readable, otherwise the backend has read LEN bytes itself (0 at end
+   of file, a negative errno on error) and DATA must be given back
+   with io_done (). */
+struct io_event
+{
+  int fd;
+  unsigned char *data;
+  int len;
+
+  /* Backend private. */
+  int bid;
+  unsigned int gen;
+};
+
+/* Maximum events handed out by one io_wait (). */
+#define IO_EVENTS_MAX 64
+
+/* Prototypes. */
+int io_init (const char *);
+const char *io_name (void);
+void io_add (int, int);
+void io_del (int);
+void io_enable (int, int);
+int io_wait (struct io_event *, int, int);
+void io_done (struct io_event *);
+ssize_t io_read (int, void *, size_t);
+ssize_t io_writev (int, const struct iovec *, int);
+void io_cmd_init (void);
+
+#endif /* _ZEBRA_IOLOOP_H */
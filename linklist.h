@@ -98,4 +98,77 @@ void list_add_list (list, list);
       (L)->tail = (N)->prev; \
   } while (0)
 
+/* Intrusive list.  The link is a struct dlink member of the element
+   itself, so adding needs no allocation, removing an element is O(1)
+   and walking the list touches only the elements. */
+struct dlink
+{
+  struct dlink *next;
+  struct dlink *prev;
+};
+
+/* The head is a link of its own, the list is a ring through it. */
+struct dlist
+{
+  struct dlink head;
+  unsigned int count;
+};
+
+#define dlist_count(L) ((L)->count)
+#define dlist_isempty(L) ((L)->head.next == &(L)->head)
+#define dlist_linked(N) ((N)->next != NULL)
+
+/* Element of type TYPE whose MEMBER is link N. */
+#define dlist_entry(N,TYPE,MEMBER) \
+  ((TYPE *) ((char *) (N) - offsetof (TYPE, MEMBER)))
+
+/* First element of L, or NULL. */
+#define dlist_first(L,TYPE,MEMBER) \
+  (dlist_isempty (L) ? NULL : dlist_entry ((L)->head.next, TYPE, MEMBER))
+
+#define DLIST_INIT(L) \
+  do { \
+    (L)->head.next = (L)->head.prev = &(L)->head; \
+    (L)->count = 0; \
+  } while (0)
+
+/* Insert link N after link P.  P is taken once, it may be a link
+   this changes, such as the head's prev. */
+#define DLINK_ADD_AFTER(P,N) \
+  do { \
+    struct dlink *dlink_p_ = (P); \
+    (N)->prev = dlink_p_; \
+    (N)->next = dlink_p_->next; \
+    dlink_p_->next->prev = (N); \
+    dlink_p_->next = (N); \
+  } while (0)
+
+#define DLIST_ADD_HEAD(L,N) \
+  do { \
+    DLINK_ADD_AFTER (&(L)->head, (N)); \
+    (L)->count++; \
+  } while (0)
+
+#define DLIST_ADD_TAIL(L,N) \
+  do { \
+    DLINK_ADD_AFTER ((L)->head.prev, (N)); \
+    (L)->count++; \
+  } while (0)
+
+/* Remove link N from L, N must be on L. */
+#define DLIST_DELETE(L,N) \
+  do { \
+    (N)->prev->next = (N)->next; \
+    (N)->next->prev = (N)->prev; \
+    (N)->next = (N)->prev = NULL; \
+    (L)->count--; \
+  } while (0)
+
+/* Walk the elements V of type TYPE on L, linked through MEMBER.  N
+   keeps the next link, so V may be removed while walking. */
+#define DLIST_LOOP(L,V,N,TYPE,MEMBER) \
+  for ((V) = dlist_entry ((L)->head.next, TYPE, MEMBER); \
+       &(V)->MEMBER != &(L)->head && ((N) = (V)->MEMBER.next, 1); \
+       (V) = dlist_entry ((N), TYPE, MEMBER))
+
 #endif /* _ZEBRA_LINKLIST_H */
@@ -22,11 +22,20 @@
 
 #include <common.h>
 
+#include <malloc.h>
+#include <math.h>
+#include <pthread.h>
+
 #include "log.h"
 #include "memory.h"
+#include "slab.h"
+#include "hugepage.h"
+#include "intern.h"
 
-void alloc_inc (int);
-void alloc_dec (int);
+static void alloc_inc (int, void *);
+static void alloc_dec (int, void *);
+static void alloc_resize (int, long, long);
+static size_t zsize (void *);
 
 struct message mstr [] =
 {
@@ -38,6 +47,42 @@ struct message mstr [] =
   { 0, NULL },
 };
 
+/* Types whose objects are small and many, these are served from the
+   slab caches. */
+static const char mtype_slab[MTYPE_MAX] =
+{
+  [MTYPE_STRVEC] = 1,
+  [MTYPE_INTERN] = 1,
+  [MTYPE_VECTOR] = 1,
+  [MTYPE_VECTOR_INDEX] = 1,
+  [MTYPE_LINK_LIST] = 1,
+  [MTYPE_LINK_NODE] = 1,
+  [MTYPE_SKIPLIST_NODE] = 1,
+  [MTYPE_RADIX_NODE] = 1,
+  [MTYPE_THREAD] = 1,
+  [MTYPE_VTY_HIST] = 1,
+  [MTYPE_VTY_LOG] = 1,
+  [MTYPE_BUFFER] = 1,
+  [MTYPE_BUFFER_DATA] = 1,
+  [MTYPE_DESC] = 1,
+};
+
+/* Types of large, lookup-heavy tables and the hugepage arena each is
+   kept in. */
+static const char mtype_huge[MTYPE_MAX] =
+{
+  [MTYPE_IF] = HUGE_ARENA_IF,
+  [MTYPE_CONNECTED] = HUGE_ARENA_IF,
+  [MTYPE_VLAN] = HUGE_ARENA_IF,
+  [MTYPE_HASH] = HUGE_ARENA_TABLE,
+  [MTYPE_HASH_INDEX] = HUGE_ARENA_TABLE,
+  [MTYPE_HASH_BACKET] = HUGE_ARENA_TABLE,
+  [MTYPE_ROUTE_TABLE] = HUGE_ARENA_ROUTE,
+  [MTYPE_ROUTE_NODE] = HUGE_ARENA_ROUTE,
+  [MTYPE_RIB] = HUGE_ARENA_ROUTE,
+  [MTYPE_NEXTHOP] = HUGE_ARENA_ROUTE,
+};
+
 /* Fatal memory allocation error occured. */
 static void
 zerror (const char *fname, int type, size_t size)
@@ -51,14 +96,19 @@ zerror (const char *fname, int type, size_t size)
 void *
 zmalloc (int type, size_t size)
 {
-  void *memory;
+  void *memory = NULL;
 
-  memory = malloc (size);
+  if (mtype_slab[type])
+    memory = slab_alloc (size);
+  else if (mtype_huge[type])
+    memory = huge_alloc (mtype_huge[type], size);
+  if (memory == NULL)
+    memory = malloc (size);
 
   if (memory == NULL)
     zerror ("malloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, memory);
 
   return memory;
 }
@@ -67,14 +117,20 @@ zmalloc (int type, size_t size)
 void *
 zcalloc (int type, size_t size)
 {
-  void *memory;
+  void *memory = NULL;
 
-  memory = calloc (1, size);
+  if (mtype_slab[type] && (memory = slab_alloc (size)) != NULL)
+    memset (memory, 0, size);
+  else if (mtype_huge[type]
+           && (memory = huge_alloc (mtype_huge[type], size)) != NULL)
+    memset (memory, 0, size);
+  if (memory == NULL)
+    memory = calloc (1, size);
 
   if (memory == NULL)
     zerror ("calloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, memory);
 
   return memory;
 }
@@ -83,11 +139,51 @@ zcalloc (int type, size_t size)
 void *
 zrealloc (int type, void *ptr, size_t size)
 {
-  void *memory;
+  void *memory = NULL;
+  size_t old;
+
+  if (! SLAB_OWNS (ptr) && ! HUGE_OWNS (ptr))
+    {
+      old = ptr ? malloc_usable_size (ptr) : 0;
 
-  memory = realloc (ptr, size);
+      /* A table which has grown large enough moves to its arena. */
+      if (mtype_huge[type]
+          && (memory = huge_alloc (mtype_huge[type], size)) != NULL)
+        {
+          if (ptr)
+            memcpy (memory, ptr, old < size ? old : size);
+          free (ptr);
+          alloc_resize (type, ptr == NULL, (long) zsize (memory) - (long) old);
+          return memory;
+        }
+
+      memory = realloc (ptr, size);
+      if (memory == NULL)
+        zerror ("realloc", type, size);
+      alloc_resize (type, ptr == NULL,
+                    (long) malloc_usable_size (memory) - (long) old);
+      return memory;
+    }
+
+  /* Slab and arena blocks stay where they are as long as they fit. */
+  old = zsize (ptr);
+  if (size <= old)
+    return ptr;
+
+  if (mtype_slab[type])
+    memory = slab_alloc (size);
+  else if (mtype_huge[type])
+    memory = huge_alloc (mtype_huge[type], size);
+  if (memory == NULL)
+    memory = malloc (size);
   if (memory == NULL)
     zerror ("realloc", type, size);
+  memcpy (memory, ptr, old);
+  if (SLAB_OWNS (ptr))
+    slab_free (ptr);
+  else
+    huge_free (ptr);
+  alloc_resize (type, 0, (long) zsize (memory) - (long) old);
   return memory;
 }
 
@@ -95,44 +191,472 @@ zrealloc (int type, void *ptr, size_t size)
 void
 zfree (int type, void *ptr)
 {
-  alloc_dec (type);
-  free (ptr);
+  if (ptr == NULL)
+    return;
+
+  alloc_dec (type, ptr);
+  if (SLAB_OWNS (ptr))
+    slab_free (ptr);
+  else if (HUGE_OWNS (ptr))
+    huge_free (ptr);
+  else
+    free (ptr);
 }
 
 /* String duplication. */
 char *
 zstrdup (int type, char *str)
 {
-  void *dup;
+  void *dup = NULL;
+  size_t len;
 
-  dup = strdup (str);
+  if (mtype_slab[type])
+    {
+      len = strlen (str) + 1;
+      if ((dup = slab_alloc (len)) != NULL)
+        memcpy (dup, str, len);
+    }
+  if (dup == NULL)
+    dup = strdup (str);
   if (dup == NULL)
     zerror ("strdup", type, strlen (str));
-  alloc_inc (type);
+  alloc_inc (type, dup);
   return dup;
 }
 
 
-struct 
+/* Counters of one thread.  Only the thread itself writes them, so
+   updates need no atomic read-modify-write; readers add up all
+   threads.  HIGH is the most BYTES has been since EPOCH began. */
+struct mstat_thread
 {
-  char *name;
-  unsigned long alloc;
+  struct mstat_thread *next;
+  unsigned long epoch;
+  struct
+  {
+    long count;
+    long bytes;
+    long high;
+    unsigned long allocs;
+  } m[MTYPE_MAX];
+};
+
+static __thread struct mstat_thread *mstat_local;
+
+/* Threads with counters, and what exited threads have left behind. */
+static struct mstat_thread *mstat_threads;
+static struct mstat_thread mstat_retired;
+static pthread_mutex_t mstat_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t mstat_once = PTHREAD_ONCE_INIT;
+static pthread_key_t mstat_key;
+
+/* Totals as of the last memory_sample (). */
+struct
+{
+  long count;
+  long bytes;
+  long peak;
+  unsigned long allocs;
+  unsigned long allocs_prev;
+  unsigned long rate;
 } mstat [MTYPE_MAX];
 
-/* Increment allocation counter. */
+static time_t mstat_time;
+
+/* Bumped each time the counters are added up, threads then start
+   their high-water marks afresh. */
+static unsigned long mstat_epoch;
+
+#define MSTAT_ADD(var, val) \
+  __atomic_store_n (&(var), (var) + (val), __ATOMIC_RELAXED)
+
+static void
+mstat_thread_exit (void *arg)
+{
+  struct mstat_thread *t = arg;
+  struct mstat_thread **tp;
+  int i;
+
+  pthread_mutex_lock (&mstat_mtx);
+  for (tp = &mstat_threads; *tp; tp = &(*tp)->next)
+    if (*tp == t)
+      {
+        *tp = t->next;
+        break;
+      }
+  for (i = 0; i < MTYPE_MAX; i++)
+    {
+      mstat_retired.m[i].count += t->m[i].count;
+      mstat_retired.m[i].bytes += t->m[i].bytes;
+      mstat_retired.m[i].allocs += t->m[i].allocs;
+    }
+  pthread_mutex_unlock (&mstat_mtx);
+
+  free (t);
+}
+
+static void
+mstat_init_once (void)
+{
+  pthread_key_create (&mstat_key, mstat_thread_exit);
+}
+
+/* Counters of the calling thread.  They are allocated with calloc (),
+   the allocator can't count itself. */
+static struct mstat_thread *
+mstat_thread_get (void)
+{
+  struct mstat_thread *t;
+
+  if (mstat_local)
+    return mstat_local;
+
+  t = calloc (1, sizeof (struct mstat_thread));
+  if (t == NULL)
+    zerror ("calloc", MTYPE_TMP, sizeof (struct mstat_thread));
+
+  pthread_once (&mstat_once, mstat_init_once);
+  pthread_setspecific (mstat_key, t);
+
+  pthread_mutex_lock (&mstat_mtx);
+  t->next = mstat_threads;
+  mstat_threads = t;
+  pthread_mutex_unlock (&mstat_mtx);
+
+  mstat_local = t;
+  return t;
+}
+
+/* Usable size of allocated memory PTR. */
+static size_t
+zsize (void *ptr)
+{
+  if (SLAB_OWNS (ptr))
+    return slab_size (ptr);
+  if (HUGE_OWNS (ptr))
+    return huge_size (ptr);
+  return malloc_usable_size (ptr);
+}
+
+/* Account for an object which has changed by COUNT objects and BYTES
+   bytes. */
+static void
+alloc_resize (int type, long count, long bytes)
+{
+  struct mstat_thread *t = mstat_thread_get ();
+  unsigned long epoch = __atomic_load_n (&mstat_epoch, __ATOMIC_RELAXED);
+  int i;
+
+  if (t->epoch != epoch)
+    {
+      for (i = 0; i < MTYPE_MAX; i++)
+        __atomic_store_n (&t->m[i].high, t->m[i].bytes, __ATOMIC_RELAXED);
+      __atomic_store_n (&t->epoch, epoch, __ATOMIC_RELAXED);
+    }
+
+  MSTAT_ADD (t->m[type].count, count);
+  MSTAT_ADD (t->m[type].bytes, bytes);
+  if (t->m[type].bytes > t->m[type].high)
+    __atomic_store_n (&t->m[type].high, t->m[type].bytes, __ATOMIC_RELAXED);
+  if (count > 0)
+    MSTAT_ADD (t->m[type].allocs, count);
+}
+
+/* Count new object PTR. */
+static void
+alloc_inc (int type, void *ptr)
+{
+  alloc_resize (type, 1, zsize (ptr));
+}
+
+/* Count object PTR which is about to be freed. */
+static void
+alloc_dec (int type, void *ptr)
+{
+  alloc_resize (type, -1, - (long) zsize (ptr));
+}
+
+/* Add up the counters of all threads, with mstat_mtx held.  The
+   allocation rate is taken over at least a second.  The peak adds up
+   the threads' high-water marks, which may count memory one thread
+   took while another freed it, but never misses a peak between two
+   calls. */
+static void
+mstat_sum (time_t now)
+{
+  struct mstat_thread *t;
+  unsigned long epoch = mstat_epoch;
+  long count, bytes, high;
+  unsigned long allocs;
+  int i;
+
+  for (i = 0; i < MTYPE_MAX; i++)
+    {
+      count = mstat_retired.m[i].count;
+      bytes = mstat_retired.m[i].bytes;
+      high = bytes;
+      allocs = mstat_retired.m[i].allocs;
+      for (t = mstat_threads; t; t = t->next)
+        {
+          count += __atomic_load_n (&t->m[i].count, __ATOMIC_RELAXED);
+          bytes += __atomic_load_n (&t->m[i].bytes, __ATOMIC_RELAXED);
+          allocs += __atomic_load_n (&t->m[i].allocs, __ATOMIC_RELAXED);
+          if (__atomic_load_n (&t->epoch, __ATOMIC_RELAXED) == epoch)
+            high += __atomic_load_n (&t->m[i].high, __ATOMIC_RELAXED);
+          else
+            high += __atomic_load_n (&t->m[i].bytes, __ATOMIC_RELAXED);
+        }
+
+      mstat[i].count = count;
+      mstat[i].bytes = bytes;
+      mstat[i].allocs = allocs;
+      if (high < bytes)
+        high = bytes;
+      if (high > mstat[i].peak)
+        mstat[i].peak = high;
+      if (now > mstat_time && mstat_time)
+        mstat[i].rate = (allocs - mstat[i].allocs_prev) / (now - mstat_time);
+      if (now > mstat_time)
+        mstat[i].allocs_prev = allocs;
+    }
+
+  if (now > mstat_time)
+    mstat_time = now;
+  __atomic_store_n (&mstat_epoch, epoch + 1, __ATOMIC_RELAXED);
+}
+
+/* Take a sample of the counters, called about once a second to keep
+   the rate up to date. */
 void
-alloc_inc (int type)
+memory_sample (void)
+{
+  time_t now = time (NULL);
+
+  if (now == __atomic_load_n (&mstat_time, __ATOMIC_RELAXED))
+    return;
+
+  pthread_mutex_lock (&mstat_mtx);
+  mstat_sum (now);
+  pthread_mutex_unlock (&mstat_mtx);
+}
+
+#ifdef MEMORY_LOG
+/* Sampling heap profiler.  Each thread counts down the bytes it
+   allocates and records the allocation which reaches zero, so about
+   one allocation per MEMORY_SAMPLE_BYTES bytes is looked at.  The
+   countdowns are exponential, so an allocation of SIZE bytes is
+   sampled with chance 1 - exp (-SIZE / MEMORY_SAMPLE_BYTES) whatever
+   came before it, and a sample stands for SIZE over that chance, which
+   makes the totals per call site an unbiased estimate.  Frees only
+   look further when a filter bit for the pointer is set. */
+
+/* A call site, which is a FILE:LINE and memory type. */
+struct mlog_site
+{
+  const char *file;
+  int line;
+  int type;
+  unsigned long live;
+  unsigned long objects;
+  unsigned long total;
+};
+
+/* A sampled object which hasn't been freed yet. */
+struct mlog_obj
+{
+  struct mlog_obj *next;
+  void *ptr;
+  struct mlog_site *site;
+  unsigned long weight;
+  unsigned long objects;
+};
+
+#define MLOG_SITES        1024
+#define MLOG_OBJ_HASH     4096
+#define MLOG_FILTER_BITS  (1 << 16)
+
+static struct mlog_site mlog_sites[MLOG_SITES];
+static int mlog_site_count;
+static struct mlog_obj *mlog_objs[MLOG_OBJ_HASH];
+static unsigned char mlog_filter[MLOG_FILTER_BITS / 8];
+static pthread_mutex_t mlog_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread long mlog_countdown;
+static __thread unsigned int mlog_seed;
+
+static unsigned int
+mlog_hash (const void *ptr)
+{
+  return (unsigned int) (((unsigned long) ptr >> 4) * 2654435761UL);
+}
+
+/* Bytes until the next sample, exponential with a mean of
+   MEMORY_SAMPLE_BYTES. */
+static long
+mlog_interval (void)
+{
+  double u;
+
+  if (mlog_seed == 0)
+    mlog_seed = (unsigned int) (unsigned long) &mlog_seed ^ time (NULL);
+  u = (rand_r (&mlog_seed) + 1.0) / ((double) RAND_MAX + 2.0);
+  return 1 + (long) (-log (u) * MEMORY_SAMPLE_BYTES);
+}
+
+static struct mlog_site *
+mlog_site_get (const char *file, int line, int type)
+{
+  unsigned int h;
+  struct mlog_site *site;
+
+  h = (mlog_hash (file) ^ (line * 31) ^ type) % MLOG_SITES;
+  while (mlog_sites[h].file)
+    {
+      site = &mlog_sites[h];
+      if (site->file == file && site->line == line && site->type == type)
+        return site;
+      h = (h + 1) % MLOG_SITES;
+    }
+
+  /* Keep a free slot so lookups end. */
+  if (mlog_site_count >= MLOG_SITES - 1)
+    return NULL;
+
+  site = &mlog_sites[h];
+  site->file = file;
+  site->line = line;
+  site->type = type;
+  mlog_site_count++;
+  return site;
+}
+
+/* SIZE bytes have been allocated at PTR, record it if it's the turn of
+   this allocation. */
+static void
+mlog_alloc (const char *file, int line, int type, void *ptr, size_t size)
 {
-  mstat[type].alloc++;
+  struct mlog_site *site;
+  struct mlog_obj *obj;
+  unsigned int h;
+
+  mlog_countdown -= size;
+  if (mlog_countdown > 0)
+    return;
+  mlog_countdown = mlog_interval ();
+
+  obj = malloc (sizeof (struct mlog_obj));
+  if (obj == NULL)
+    return;
+  obj->ptr = ptr;
+  obj->weight = size ? size / -expm1 (-(double) size / MEMORY_SAMPLE_BYTES)
+                     : MEMORY_SAMPLE_BYTES;
+  obj->objects = size ? obj->weight / size : 1;
+
+  pthread_mutex_lock (&mlog_mtx);
+  site = mlog_site_get (file, line, type);
+  if (site == NULL)
+    {
+      pthread_mutex_unlock (&mlog_mtx);
+      free (obj);
+      return;
+    }
+  obj->site = site;
+  site->live += obj->weight;
+  site->objects += obj->objects;
+  site->total += obj->weight;
+
+  h = mlog_hash (ptr);
+  obj->next = mlog_objs[h % MLOG_OBJ_HASH];
+  mlog_objs[h % MLOG_OBJ_HASH] = obj;
+  __atomic_fetch_or (&mlog_filter[(h % MLOG_FILTER_BITS) / 8],
+                     1 << (h % 8), __ATOMIC_RELAXED);
+  pthread_mutex_unlock (&mlog_mtx);
+}
+
+/* PTR is about to be freed. */
+static void
+mlog_free (void *ptr)
+{
+  struct mlog_obj **op;
+  struct mlog_obj *obj = NULL;
+  unsigned int h;
+
+  if (ptr == NULL)
+    return;
+
+  h = mlog_hash (ptr);
+  if (! (__atomic_load_n (&mlog_filter[(h % MLOG_FILTER_BITS) / 8],
+                          __ATOMIC_RELAXED) & (1 << (h % 8))))
+    return;
+
+  pthread_mutex_lock (&mlog_mtx);
+  for (op = &mlog_objs[h % MLOG_OBJ_HASH]; *op; op = &(*op)->next)
+    if ((*op)->ptr == ptr)
+      {
+        obj = *op;
+        *op = obj->next;
+        obj->site->live -= obj->weight;
+        obj->site->objects -= obj->objects;
+        break;
+      }
+  pthread_mutex_unlock (&mlog_mtx);
+
+  free (obj);
+}
+
+void *
+mtype_zmalloc (const char *file, int line, int type, size_t size)
+{
+  void *memory;
+
+  memory = zmalloc (type, size);
+  mlog_alloc (file, line, type, memory, size);
+
+  return memory;
+}
+
+void *
+mtype_zcalloc (const char *file, int line, int type, size_t size)
+{
+  void *memory;
+
+  memory = zcalloc (type, size);
+  mlog_alloc (file, line, type, memory, size);
+
+  return memory;
+}
+
+void *
+mtype_zrealloc (const char *file, int line, int type, void *ptr, size_t size)
+{
+  void *memory;
+
+  mlog_free (ptr);
+  memory = zrealloc (type, ptr, size);
+  mlog_alloc (file, line, type, memory, size);
+
+  return memory;
 }
 
-/* Decrement allocation counter. */
 void
-alloc_dec (int type)
+mtype_zfree (const char *file, int line, int type, void *ptr)
 {
-  mstat[type].alloc--;
+  mlog_free (ptr);
+  zfree (type, ptr);
 }
-
+
+char *
+mtype_zstrdup (const char *file, int line, int type, char *str)
+{
+  char *memory;
+
+  memory = zstrdup (type, str);
+  mlog_alloc (file, line, type, memory, strlen (str) + 1);
+
+  return memory;
+}
+#endif /* MEMORY_LOG */
+
 /* Looking up memory status from vty interface. */
 #include "vector.h"
 #include "vty.h"
@@ -148,83 +672,395 @@ struct memory_list
 struct memory_list memory_list_lib[] =
 {
   { MTYPE_TMP,                "Temporary memory" },
-  { MTYPE_ROUTE_TABLE,        "Route table     " },
-  { MTYPE_ROUTE_NODE,         "Route node      " },
-  { MTYPE_RIB,                "RIB             " },
-  { MTYPE_NEXTHOP,            "Nexthop         " },
-  { MTYPE_LINK_LIST,          "Link List       " },
-  { MTYPE_LINK_NODE,          "Link Node       " },
-  { MTYPE_HASH,               "Hash            " },
-  { MTYPE_HASH_BACKET,        "Hash Bucket     " },
-  { MTYPE_ACCESS_LIST,        "Access List     " },
-  { MTYPE_ACCESS_LIST_STR,    "Access List Str " },
-  { MTYPE_ACCESS_FILTER,      "Access Filter   " },
-  { MTYPE_PREFIX_LIST,        "Prefix List     " },
-  { MTYPE_PREFIX_LIST_STR,    "Prefix List Str " },
-  { MTYPE_PREFIX_LIST_ENTRY,  "Prefix List Entry "},
-  { MTYPE_ROUTE_MAP,          "Route map       " },
-  { MTYPE_ROUTE_MAP_NAME,     "Route map name  " },
-  { MTYPE_ROUTE_MAP_INDEX,    "Route map index " },
-  { MTYPE_ROUTE_MAP_RULE,     "Route map rule  " },
+  { MTYPE_ROUTE_TABLE,        "Route table" },
+  { MTYPE_ROUTE_NODE,         "Route node" },
+  { MTYPE_RIB,                "RIB" },
+  { MTYPE_NEXTHOP,            "Nexthop" },
+  { MTYPE_LINK_LIST,          "Link List" },
+  { MTYPE_LINK_NODE,          "Link Node" },
+  { MTYPE_SKIPLIST,           "Skip list" },
+  { MTYPE_SKIPLIST_NODE,      "Skip list node" },
+  { MTYPE_RADIX,              "Radix tree" },
+  { MTYPE_RADIX_NODE,         "Radix tree node" },
+  { MTYPE_HASH,               "Hash" },
+  { MTYPE_HASH_BACKET,        "Hash Bucket" },
+  { MTYPE_ACCESS_LIST,        "Access List" },
+  { MTYPE_ACCESS_LIST_STR,    "Access List Str" },
+  { MTYPE_ACCESS_FILTER,      "Access Filter" },
+  { MTYPE_PREFIX_LIST,        "Prefix List" },
+  { MTYPE_PREFIX_LIST_STR,    "Prefix List Str" },
+  { MTYPE_PREFIX_LIST_ENTRY,  "Prefix List Entry"},
+  { MTYPE_ROUTE_MAP,          "Route map" },
+  { MTYPE_ROUTE_MAP_NAME,     "Route map name" },
+  { MTYPE_ROUTE_MAP_INDEX,    "Route map index" },
+  { MTYPE_ROUTE_MAP_RULE,     "Route map rule" },
   { MTYPE_ROUTE_MAP_RULE_STR, "Route map rule str" },
-  { MTYPE_DESC,               "Command desc    " },
-  { MTYPE_BUFFER,             "Buffer          " },
-  { MTYPE_BUFFER_DATA,        "Buffer data     " },
-  { MTYPE_STREAM,             "Stream          " },
-  { MTYPE_KEYCHAIN,           "Key chain       " },
-  { MTYPE_KEY,                "Key             " },
-  { MTYPE_VTY,                "VTY             " },
+  { MTYPE_DESC,               "Command desc" },
+  { MTYPE_INTERN,             "Interned string" },
+  { MTYPE_BUFFER,             "Buffer" },
+  { MTYPE_BUFFER_DATA,        "Buffer data" },
+  { MTYPE_STREAM,             "Stream" },
+  { MTYPE_KEYCHAIN,           "Key chain" },
+  { MTYPE_KEY,                "Key" },
+  { MTYPE_VTY,                "VTY" },
+  { MTYPE_VTY_LOG,            "VTY log" },
+  { MTYPE_VTY_ARENA,          "VTY arena" },
   { -1, NULL }
 };
 
 
+struct memory_list memory_list_all[] =
+{
+  { MTYPE_TMP,                    "Temporary memory" },
+  { MTYPE_STRVEC,                 "String vector" },
+  { MTYPE_INTERN,                 "Interned string" },
+  { MTYPE_VECTOR,                 "Vector" },
+  { MTYPE_VECTOR_INDEX,           "Vector index" },
+  { MTYPE_LINK_LIST,              "Link List" },
+  { MTYPE_LINK_NODE,              "Link Node" },
+  { MTYPE_SKIPLIST,               "Skip list" },
+  { MTYPE_SKIPLIST_NODE,          "Skip list node" },
+  { MTYPE_RADIX,                  "Radix tree" },
+  { MTYPE_RADIX_NODE,             "Radix tree node" },
+  { MTYPE_THREAD,                 "Thread" },
+  { MTYPE_THREAD_MASTER,          "Thread master" },
+  { MTYPE_VTY,                    "VTY" },
+  { MTYPE_VTY_HIST,               "VTY history" },
+  { MTYPE_VTY_OUT_BUF,            "VTY output buffer" },
+  { MTYPE_VTY_LOG,                "VTY log" },
+  { MTYPE_VTY_ARENA,              "VTY arena" },
+  { MTYPE_IF,                     "Interface" },
+  { MTYPE_CONNECTED,              "Connected" },
+  { MTYPE_VLAN,                   "VLAN port map" },
+  { MTYPE_IF_STAT,                "Interface counters" },
+  { MTYPE_IF_EVENT,               "Interface events" },
+  { MTYPE_IF_LINE,                "Interface show cache" },
+  { MTYPE_IF_NETLINK,             "Interface kernel sync" },
+  { MTYPE_AS_SEG,                 "AS seg" },
+  { MTYPE_AS_STR,                 "AS str" },
+  { MTYPE_AS_PATH,                "AS path" },
+  { MTYPE_CLUSTER,                "Cluster" },
+  { MTYPE_CLUSTER_VAL,            "Cluster val" },
+  { MTYPE_ATTR,                   "Attr" },
+  { MTYPE_TRANSIT,                "Transit" },
+  { MTYPE_TRANSIT_VAL,            "Transit val" },
+  { MTYPE_BUFFER,                 "Buffer" },
+  { MTYPE_BUFFER_DATA,            "Buffer data" },
+  { MTYPE_STREAM,                 "Stream" },
+  { MTYPE_STREAM_DATA,            "Stream data" },
+  { MTYPE_STREAM_FIFO,            "Stream FIFO" },
+  { MTYPE_PREFIX,                 "Prefix" },
+  { MTYPE_PREFIX_IPV4,            "Prefix IPv4" },
+  { MTYPE_PREFIX_IPV6,            "Prefix IPv6" },
+  { MTYPE_HASH,                   "Hash" },
+  { MTYPE_HASH_INDEX,             "Hash index" },
+  { MTYPE_HASH_BACKET,            "Hash Bucket" },
+  { MTYPE_RIPNG_ROUTE,            "RIPNG route" },
+  { MTYPE_RIPNG_AGGREGATE,        "RIPNG aggregate" },
+  { MTYPE_ROUTE_TABLE,            "Route table" },
+  { MTYPE_ROUTE_NODE,             "Route node" },
+  { MTYPE_ACCESS_LIST,            "Access List" },
+  { MTYPE_ACCESS_LIST_STR,        "Access List Str" },
+  { MTYPE_ACCESS_FILTER,          "Access Filter" },
+  { MTYPE_PREFIX_LIST,            "Prefix List" },
+  { MTYPE_PREFIX_LIST_STR,        "Prefix List Str" },
+  { MTYPE_PREFIX_LIST_ENTRY,      "Prefix List Entry" },
+  { MTYPE_ROUTE_MAP,              "Route map" },
+  { MTYPE_ROUTE_MAP_NAME,         "Route map name" },
+  { MTYPE_ROUTE_MAP_INDEX,        "Route map index" },
+  { MTYPE_ROUTE_MAP_RULE,         "Route map rule" },
+  { MTYPE_ROUTE_MAP_RULE_STR,     "Route map rule str" },
+  { MTYPE_ROUTE_MAP_COMPILED,     "Route map compiled" },
+  { MTYPE_RIB,                    "RIB" },
+  { MTYPE_DISTRIBUTE,             "Distribute" },
+  { MTYPE_ZLOG,                   "Log" },
+  { MTYPE_ZCLIENT,                "Zclient" },
+  { MTYPE_NEXTHOP,                "Nexthop" },
+  { MTYPE_RTADV_PREFIX,           "Rtadv prefix" },
+  { MTYPE_IF_RMAP,                "IF rmap" },
+  { MTYPE_SOCKUNION,              "Sockunion" },
+  { MTYPE_STATIC_IPV4,            "Static IPv4" },
+  { MTYPE_STATIC_IPV6,            "Static IPv6" },
+  { MTYPE_DESC,                   "Command desc" },
+  { MTYPE_OSPF_TOP,               "OSPF top" },
+  { MTYPE_OSPF_AREA,              "OSPF area" },
+  { MTYPE_OSPF_AREA_RANGE,        "OSPF area range" },
+  { MTYPE_OSPF_NETWORK,           "OSPF network" },
+  { MTYPE_OSPF_NEIGHBOR_STATIC,   "OSPF neighbor static" },
+  { MTYPE_OSPF_IF,                "OSPF IF" },
+  { MTYPE_OSPF_NEIGHBOR,          "OSPF neighbor" },
+  { MTYPE_OSPF_ROUTE,             "OSPF route" },
+  { MTYPE_OSPF_TMP,               "OSPF TMP" },
+  { MTYPE_OSPF_LSA,               "OSPF LSA" },
+  { MTYPE_OSPF_LSA_DATA,          "OSPF LSA data" },
+  { MTYPE_OSPF_LSDB,              "OSPF LSDB" },
+  { MTYPE_OSPF_PACKET,            "OSPF packet" },
+  { MTYPE_OSPF_FIFO,              "OSPF FIFO" },
+  { MTYPE_OSPF_VERTEX,            "OSPF vertex" },
+  { MTYPE_OSPF_NEXTHOP,           "OSPF nexthop" },
+  { MTYPE_OSPF_PATH,              "OSPF path" },
+  { MTYPE_OSPF_VL_DATA,           "OSPF VL data" },
+  { MTYPE_OSPF_CRYPT_KEY,         "OSPF crypt key" },
+  { MTYPE_OSPF_EXTERNAL_INFO,     "OSPF external info" },
+  { MTYPE_OSPF_MESSAGE,           "OSPF message" },
+  { MTYPE_OSPF_DISTANCE,          "OSPF distance" },
+  { MTYPE_OSPF_IF_INFO,           "OSPF IF info" },
+  { MTYPE_OSPF_IF_PARAMS,         "OSPF IF params" },
+  { MTYPE_OSPF6_TOP,              "OSPF6 top" },
+  { MTYPE_OSPF6_AREA,             "OSPF6 area" },
+  { MTYPE_OSPF6_IF,               "OSPF6 IF" },
+  { MTYPE_OSPF6_NEIGHBOR,         "OSPF6 neighbor" },
+  { MTYPE_OSPF6_ROUTE,            "OSPF6 route" },
+  { MTYPE_OSPF6_PREFIX,           "OSPF6 prefix" },
+  { MTYPE_OSPF6_MESSAGE,          "OSPF6 message" },
+  { MTYPE_OSPF6_LSA,              "OSPF6 LSA" },
+  { MTYPE_OSPF6_LSA_SUMMARY,      "OSPF6 LSA summary" },
+  { MTYPE_OSPF6_LSDB,             "OSPF6 LSDB" },
+  { MTYPE_OSPF6_VERTEX,           "OSPF6 vertex" },
+  { MTYPE_OSPF6_SPFTREE,          "OSPF6 SPFTREE" },
+  { MTYPE_OSPF6_NEXTHOP,          "OSPF6 nexthop" },
+  { MTYPE_OSPF6_EXTERNAL_INFO,    "OSPF6 external info" },
+  { MTYPE_OSPF6_OTHER,            "OSPF6 other" },
+  { MTYPE_BGP,                    "BGP" },
+  { MTYPE_BGP_PEER,               "BGP peer" },
+  { MTYPE_PEER_GROUP,             "Peer group" },
+  { MTYPE_PEER_DESC,              "Peer desc" },
+  { MTYPE_PEER_UPDATE_SOURCE,     "Peer update source" },
+  { MTYPE_BGP_STATIC,             "BGP static" },
+  { MTYPE_BGP_AGGREGATE,          "BGP aggregate" },
+  { MTYPE_BGP_CONFED_LIST,        "BGP confed list" },
+  { MTYPE_BGP_NEXTHOP_CACHE,      "BGP nexthop cache" },
+  { MTYPE_BGP_DAMP_INFO,          "BGP DAMP info" },
+  { MTYPE_BGP_DAMP_ARRAY,         "BGP DAMP array" },
+  { MTYPE_BGP_ANNOUNCE,           "BGP announce" },
+  { MTYPE_BGP_ATTR_QUEUE,         "BGP attr queue" },
+  { MTYPE_BGP_ROUTE_QUEUE,        "BGP route queue" },
+  { MTYPE_BGP_DISTANCE,           "BGP distance" },
+  { MTYPE_BGP_ROUTE,              "BGP route" },
+  { MTYPE_BGP_TABLE,              "BGP table" },
+  { MTYPE_BGP_NODE,               "BGP node" },
+  { MTYPE_BGP_ADVERTISE_ATTR,     "BGP advertise attr" },
+  { MTYPE_BGP_ADVERTISE,          "BGP advertise" },
+  { MTYPE_BGP_ADJ_IN,             "BGP ADJ in" },
+  { MTYPE_BGP_ADJ_OUT,            "BGP ADJ out" },
+  { MTYPE_BGP_REGEXP,             "BGP regexp" },
+  { MTYPE_AS_FILTER,              "AS filter" },
+  { MTYPE_AS_FILTER_STR,          "AS filter str" },
+  { MTYPE_AS_LIST,                "AS list" },
+  { MTYPE_COMMUNITY,              "Community" },
+  { MTYPE_COMMUNITY_VAL,          "Community val" },
+  { MTYPE_COMMUNITY_STR,          "Community str" },
+  { MTYPE_ECOMMUNITY,             "Ecommunity" },
+  { MTYPE_ECOMMUNITY_VAL,         "Ecommunity val" },
+  { MTYPE_ECOMMUNITY_STR,         "Ecommunity str" },
+  { MTYPE_COMMUNITY_LIST_HANDLER, "Community list handler" },
+  { MTYPE_COMMUNITY_LIST,         "Community list" },
+  { MTYPE_COMMUNITY_LIST_NAME,    "Community list name" },
+  { MTYPE_COMMUNITY_LIST_ENTRY,   "Community list entry" },
+  { MTYPE_COMMUNITY_LIST_CONFIG,  "Community list config" },
+  { MTYPE_RIP,                    "RIP" },
+  { MTYPE_RIP_INTERFACE,          "RIP interface" },
+  { MTYPE_RIP_DISTANCE,           "RIP distance" },
+  { MTYPE_RIP_OFFSET_LIST,        "RIP offset list" },
+  { MTYPE_RIP_INFO,               "RIP info" },
+  { MTYPE_RIP_PEER,               "RIP peer" },
+  { MTYPE_KEYCHAIN,               "Key chain" },
+  { MTYPE_KEY,                    "Key" },
+  { MTYPE_VTYSH_CONFIG,           "VTYSH config" },
+  { MTYPE_VTYSH_CONFIG_LINE,      "VTYSH config line" },
+  { MTYPE_VRF,                    "VRF" },
+  { MTYPE_VRF_NAME,               "VRF name" },
+  { -1, NULL }
+};
+
 struct memory_list memory_list_separator[] =
 {
   { 0, NULL},
   {-1, NULL}
 };
 
+/* Show the counters of the types in LIST, those which have never been
+   allocated are left out when ACTIVE is set. */
 void
-show_memory_vty (struct vty *vty, struct memory_list *list)
+show_memory_vty (struct vty *vty, struct memory_list *list, int active)
 {
   struct memory_list *m;
 
+  pthread_mutex_lock (&mstat_mtx);
+  mstat_sum (time (NULL));
+  pthread_mutex_unlock (&mstat_mtx);
+
+  vty_object_begin (vty, NULL);
+  vty_field_label (vty, 24, "Type");
+  vty_field_label (vty, 0, "   Count       Bytes        Peak  Allocs/s");
+  vty_field_label (vty, 0, VTY_NEWLINE);
+  vty_array_begin (vty, "memory");
   for (m = list; m->index >= 0; m++)
     if (m->index == 0)
-      vty_out (vty, "-----------------------------\r\n");
-    else
-      vty_out (vty, "%-22s: %5ld\r\n", m->format, mstat[m->index].alloc);
+      {
+        vty_field_label (vty, 0, "-----------------------------");
+        vty_field_label (vty, 0, VTY_NEWLINE);
+      }
+    else if (! active || mstat[m->index].allocs || mstat[m->index].count)
+      {
+        vty_row_begin (vty);
+        vty_field_str (vty, "type", 22, m->format);
+        vty_field_label (vty, 0, ": ");
+        vty_field_int (vty, "allocated", -8, mstat[m->index].count);
+        vty_field_label (vty, 0, " ");
+        vty_field_int (vty, "bytes", -11, mstat[m->index].bytes);
+        vty_field_label (vty, 0, " ");
+        vty_field_int (vty, "peak", -11, mstat[m->index].peak);
+        vty_field_label (vty, 0, " ");
+        vty_field_int (vty, "rate", -9, mstat[m->index].rate);
+        vty_row_end (vty);
+      }
+  vty_array_end (vty);
+  vty_object_end (vty);
 }
 
-DEFUN (show_memory_all,
+DEFUN_ATTR (show_memory,
+       show_memory_cmd,
+       "show memory",
+       "Show running system information\n"
+       "Memory statistics\n",
+       CMD_ATTR_READONLY)
+{
+  show_memory_vty (vty, memory_list_all, 1);
+  vty_out (vty, "%s", VTY_NEWLINE);
+  huge_show (vty);
+  return CMD_SUCCESS;
+}
+
+DEFUN_ATTR (show_memory_all,
        show_memory_all_cmd,
        "show memory all",
        "Show running system information\n"
        "Memory statistics\n"
-       "All memory statistics\n")
+       "All memory statistics\n",
+       CMD_ATTR_READONLY)
 {
-  show_memory_vty (vty, memory_list_lib);
+  show_memory_vty (vty, memory_list_all, 0);
 
   return CMD_SUCCESS;
 }
 
-ALIAS (show_memory_all,
-       show_memory_cmd,
-       "show memory",
-       "Show running system information\n"
-       "Memory statistics\n");
-
-DEFUN (show_memory_lib,
+DEFUN_ATTR (show_memory_lib,
        show_memory_lib_cmd,
        "show memory lib",
        SHOW_STR
        "Memory statistics\n"
-       "Library memory\n")
+       "Library memory\n",
+       CMD_ATTR_READONLY)
 {
-  show_memory_vty (vty, memory_list_lib);
+  show_memory_vty (vty, memory_list_lib, 0);
   return CMD_SUCCESS;
 }
 
+DEFUN_ATTR (show_memory_slab,
+       show_memory_slab_cmd,
+       "show memory slab",
+       SHOW_STR
+       "Memory statistics\n"
+       "Slab cache statistics\n",
+       CMD_ATTR_READONLY)
+{
+  slab_show (vty);
+  return CMD_SUCCESS;
+}
+
+#ifdef MEMORY_LOG
+static const char *
+mtype_name (int type)
+{
+  struct memory_list *m;
+
+  for (m = memory_list_all; m->index >= 0; m++)
+    if (m->index == type)
+      return m->format;
+  return "unknown";
+}
+
+static int
+mlog_site_cmp (const void *a, const void *b)
+{
+  const struct mlog_site *x = a;
+  const struct mlog_site *y = b;
+
+  if (x->live != y->live)
+    return x->live < y->live ? 1 : -1;
+  return 0;
+}
+
+DEFUN_ATTR (show_memory_callsites,
+       show_memory_callsites_cmd,
+       "show memory callsites",
+       SHOW_STR
+       "Memory statistics\n"
+       "Sampled allocations by call site\n",
+       CMD_ATTR_READONLY)
+{
+  struct mlog_site *sites;
+  struct mlog_site *m;
+  char loc[64];
+  int i, n;
+
+  /* Copied with malloc (), a counted allocation could take the lock. */
+  sites = malloc (sizeof (struct mlog_site) * MLOG_SITES);
+  if (sites == NULL)
+    return CMD_WARNING;
+
+  pthread_mutex_lock (&mlog_mtx);
+  for (i = n = 0; i < MLOG_SITES; i++)
+    if (mlog_sites[i].file && mlog_sites[i].total)
+      sites[n++] = mlog_sites[i];
+  pthread_mutex_unlock (&mlog_mtx);
+
+  qsort (sites, n, sizeof (struct mlog_site), mlog_site_cmp);
+
+  vty_out (vty, "Sampling every %d bytes, estimated totals%s",
+           MEMORY_SAMPLE_BYTES, VTY_NEWLINE);
+  vty_out (vty, "%-28s %-18s %10s %8s %12s%s", "Call site", "Type",
+           "Live bytes", "Objects", "Allocated", VTY_NEWLINE);
+  for (i = 0; i < n; i++)
+    {
+      m = &sites[i];
+      snprintf (loc, sizeof loc, "%s:%d", m->file, m->line);
+      vty_out (vty, "%-28s %-18s %10lu %8lu %12lu%s", loc,
+               mtype_name (m->type), m->live, m->objects, m->total,
+               VTY_NEWLINE);
+    }
+
+  free (sites);
+  return CMD_SUCCESS;
+}
+#endif /* MEMORY_LOG */
+
+DEFUN_ATTR (show_memory_intern,
+       show_memory_intern_cmd,
+       "show memory intern",
+       SHOW_STR
+       "Memory statistics\n"
+       "Interned string statistics\n",
+       CMD_ATTR_READONLY)
+{
+  intern_show (vty);
+  return CMD_SUCCESS;
+}
+
+DEFUN_ATTR (show_memory_json,
+       show_memory_json_cmd,
+       "show memory json",
+       SHOW_STR
+       "Memory statistics\n"
+       "JavaScript Object Notation\n",
+       CMD_ATTR_READONLY)
+{
+  vty->json = 1;
+  show_memory_vty (vty, memory_list_all, 1);
+  vty->json = 0;
+  return CMD_SUCCESS;
+}
 
 
 void
@@ -233,10 +1069,22 @@ memory_init ()
   install_element (VIEW_NODE, &show_memory_cmd);
   install_element (VIEW_NODE, &show_memory_all_cmd);
   install_element (VIEW_NODE, &show_memory_lib_cmd);
+  install_element (VIEW_NODE, &show_memory_json_cmd);
+  install_element (VIEW_NODE, &show_memory_slab_cmd);
+  install_element (VIEW_NODE, &show_memory_intern_cmd);
+#ifdef MEMORY_LOG
+  install_element (VIEW_NODE, &show_memory_callsites_cmd);
+#endif /* MEMORY_LOG */
 
 
   install_element (ENABLE_NODE, &show_memory_cmd);
   install_element (ENABLE_NODE, &show_memory_all_cmd);
   install_element (ENABLE_NODE, &show_memory_lib_cmd);
+  install_element (ENABLE_NODE, &show_memory_json_cmd);
+  install_element (ENABLE_NODE, &show_memory_slab_cmd);
+  install_element (ENABLE_NODE, &show_memory_intern_cmd);
+#ifdef MEMORY_LOG
+  install_element (ENABLE_NODE, &show_memory_callsites_cmd);
+#endif /* MEMORY_LOG */
 
 }
@@ -23,22 +23,38 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 /* #define MEMORY_LOG */
 
+/* With MEMORY_LOG, about one allocation per this many bytes is
+   recorded with its call site. */
+#define MEMORY_SAMPLE_BYTES (512 * 1024)
+
 /* For tagging memory, below is the type of the memory. */
 enum
 {
   MTYPE_TMP = 1,
   MTYPE_STRVEC,
+  MTYPE_INTERN,
   MTYPE_VECTOR,
   MTYPE_VECTOR_INDEX,
   MTYPE_LINK_LIST,
   MTYPE_LINK_NODE,
+  MTYPE_SKIPLIST,
+  MTYPE_SKIPLIST_NODE,
+  MTYPE_RADIX,
+  MTYPE_RADIX_NODE,
   MTYPE_THREAD,
   MTYPE_THREAD_MASTER,
   MTYPE_VTY,
   MTYPE_VTY_HIST,
   MTYPE_VTY_OUT_BUF,
+  MTYPE_VTY_LOG,
+  MTYPE_VTY_ARENA,
   MTYPE_IF,
   MTYPE_CONNECTED,
+  MTYPE_VLAN,
+  MTYPE_IF_STAT,
+  MTYPE_IF_EVENT,
+  MTYPE_IF_LINE,
+  MTYPE_IF_NETLINK,
   MTYPE_AS_SEG,
   MTYPE_AS_STR,
   MTYPE_AS_PATH,
@@ -222,7 +238,6 @@ void *mtype_zmalloc (const char *file,
 void *mtype_zcalloc (const char *file,
 		     int line,
 		     int type,
-		     size_t num,
 		     size_t size);
 
 void *mtype_zrealloc (const char *file,
@@ -241,5 +256,6 @@ char *mtype_zstrdup (const char *file,
 		     int type,
 		     char *str);
 void memory_init ();
+void memory_sample (void);
 
 #endif /* _ZEBRA_MEMORY_H */
@@ -0,0 +1,286 @@
+/* Radix tree, a compressed trie of strings.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include "memory.h"
+#include "radix.h"
+
+static struct radix_node *
+radix_node_new (const char *label, size_t len)
+{
+  struct radix_node *node;
+
+  node = XCALLOC (MTYPE_RADIX_NODE, sizeof (struct radix_node) + len);
+  memcpy (node->label, label, len);
+  node->len = len;
+  return node;
+}
+
+/* Where the child of NODE whose label starts with C is, or would be
+   put. */
+static struct radix_node **
+radix_child (struct radix_node *node, unsigned char c)
+{
+  struct radix_node **link;
+
+  for (link = &node->child; *link; link = &(*link)->next)
+    if ((unsigned char) (*link)->label[0] >= c)
+      break;
+  return link;
+}
+
+/* Length of the common prefix of LABEL, of LEN bytes, and KEY. */
+static size_t
+radix_common (const char *label, size_t len, const char *key)
+{
+  size_t i;
+
+  for (i = 0; i < len && label[i] == key[i]; i++)
+    ;
+  return i;
+}
+
+struct radix *
+radix_new (void)
+{
+  struct radix *r;
+
+  r = XCALLOC (MTYPE_RADIX, sizeof (struct radix));
+  r->root = radix_node_new ("", 0);
+  return r;
+}
+
+static void
+radix_node_free (struct radix_node *node)
+{
+  struct radix_node *child;
+  struct radix_node *next;
+
+  for (child = node->child; child; child = next)
+    {
+      next = child->next;
+      radix_node_free (child);
+    }
+  XFREE (MTYPE_RADIX_NODE, node);
+}
+
+/* Free the tree, not what its keys are for. */
+void
+radix_free (struct radix *r)
+{
+  radix_node_free (r->root);
+  XFREE (MTYPE_RADIX, r);
+}
+
+/* Add KEY for DATA, which must not be NULL.  Returns -1 when KEY is
+   there already or too long. */
+int
+radix_insert (struct radix *r, const char *key, void *data)
+{
+  struct radix_node *node = r->root;
+  struct radix_node **link;
+  struct radix_node *c;
+  struct radix_node *mid;
+  size_t m;
+
+  if (strlen (key) > RADIX_KEY_MAX)
+    return -1;
+
+  while (*key)
+    {
+      link = radix_child (node, *key);
+      c = *link;
+      if (c == NULL || c->label[0] != *key)
+        {
+          mid = radix_node_new (key, strlen (key));
+          mid->data = data;
+          mid->next = c;
+          *link = mid;
+          r->count++;
+          return 0;
+        }
+
+      /* Split C where KEY leaves its label. */
+      m = radix_common (c->label, c->len, key);
+      if (m < c->len)
+        {
+          mid = radix_node_new (c->label, m);
+          mid->child = c;
+          mid->next = c->next;
+          *link = mid;
+          c->next = NULL;
+          c->len -= m;
+          memmove (c->label, c->label + m, c->len);
+          c = mid;
+        }
+      node = c;
+      key += m;
+    }
+
+  if (node->data)
+    return -1;
+  node->data = data;
+  r->count++;
+  return 0;
+}
+
+/* Replace NODE, which is at *LINK and has only one child, by a node
+   with both labels. */
+static void
+radix_merge (struct radix_node **link, struct radix_node *node)
+{
+  struct radix_node *c = node->child;
+  struct radix_node *merged;
+
+  merged = XCALLOC (MTYPE_RADIX_NODE,
+                    sizeof (struct radix_node) + node->len + c->len);
+  memcpy (merged->label, node->label, node->len);
+  memcpy (merged->label + node->len, c->label, c->len);
+  merged->len = node->len + c->len;
+  merged->data = c->data;
+  merged->child = c->child;
+  merged->next = node->next;
+  *link = merged;
+
+  XFREE (MTYPE_RADIX_NODE, c);
+  XFREE (MTYPE_RADIX_NODE, node);
+}
+
+/* Remove KEY, returns what it was for or NULL when it isn't there. */
+void *
+radix_delete (struct radix *r, const char *key)
+{
+  struct radix_node *parent = NULL;
+  struct radix_node *node = r->root;
+  struct radix_node **plink = NULL;
+  struct radix_node **link = NULL;
+  struct radix_node **l;
+  void *data;
+
+  while (*key)
+    {
+      l = radix_child (node, *key);
+      if (*l == NULL || (*l)->label[0] != *key
+          || radix_common ((*l)->label, (*l)->len, key) != (*l)->len)
+        return NULL;
+      key += (*l)->len;
+      parent = node;
+      plink = link;
+      link = l;
+      node = *l;
+    }
+
+  data = node->data;
+  if (data == NULL)
+    return NULL;
+  node->data = NULL;
+  r->count--;
+
+  if (node == r->root)
+    return data;
+
+  if (node->child == NULL)
+    {
+      *link = node->next;
+      XFREE (MTYPE_RADIX_NODE, node);
+
+      /* The parent may be left with a single child. */
+      if (parent != r->root && parent->data == NULL
+          && parent->child->next == NULL)
+        radix_merge (plink, parent);
+    }
+  else if (node->child->next == NULL)
+    radix_merge (link, node);
+
+  return data;
+}
+
+void *
+radix_lookup (struct radix *r, const char *key)
+{
+  struct radix_node *node = r->root;
+  struct radix_node *c;
+
+  while (*key)
+    {
+      c = *radix_child (node, *key);
+      if (c == NULL || c->label[0] != *key
+          || radix_common (c->label, c->len, key) != c->len)
+        return NULL;
+      key += c->len;
+      node = c;
+    }
+  return node->data;
+}
+
+/* Call FUNC with ARG for the completions of PREFIX: the key there
+   is where the keys starting with PREFIX first branch, and each
+   branch.  A branch which holds more than one key stands for them
+   all, so there are no more calls than a node has children, whatever
+   the count of keys.  There is only one call when one key starts
+   with PREFIX, and it's for that key.  Returns the count of calls. */
+int
+radix_complete (struct radix *r, const char *prefix,
+                void (*func) (const char *, void *), void *arg)
+{
+  struct radix_node *node = r->root;
+  struct radix_node *c;
+  char buf[RADIX_KEY_MAX + 1];
+  size_t len = 0, m;
+  int n = 0;
+
+  while (*prefix)
+    {
+      c = *radix_child (node, *prefix);
+      if (c == NULL || c->label[0] != *prefix)
+        return 0;
+      m = radix_common (c->label, c->len, prefix);
+      if (m < c->len && prefix[m])
+        return 0;
+      memcpy (buf + len, c->label, c->len);
+      len += c->len;
+      prefix += m;
+      node = c;
+    }
+
+  /* Nothing to choose until the keys branch. */
+  while (node->data == NULL && node->child && node->child->next == NULL)
+    {
+      node = node->child;
+      memcpy (buf + len, node->label, node->len);
+      len += node->len;
+    }
+
+  if (node->data)
+    {
+      buf[len] = '\0';
+      (*func) (buf, arg);
+      n++;
+    }
+  for (c = node->child; c; c = c->next)
+    {
+      memcpy (buf + len, c->label, c->len);
+      buf[len + c->len] = '\0';
+      (*func) (buf, arg);
+      n++;
+    }
+  return n;
+}
@@ -0,0 +1,61 @@
+/* Radix tree, a compressed trie of strings.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_RADIX_H
+#define _ZEBRA_RADIX_H
+
+/* Longest key. */
+#define RADIX_KEY_MAX 255
+
+/* A node stands for the key made of the labels from the root down to
+   it.  Nodes with a single child are merged with it unless a key ends
+   there, so a lookup takes a node per branch rather than per
+   character. */
+struct radix_node
+{
+  /* Children, in the order of the first byte of their labels. */
+  struct radix_node *child;
+  struct radix_node *next;
+
+  /* What the key of the node is for, or NULL when it is no key. */
+  void *data;
+
+  unsigned short len;
+  char label[1];
+};
+
+struct radix
+{
+  struct radix_node *root;
+  unsigned int count;
+};
+
+#define radix_count(R) ((R)->count)
+
+/* Prototypes. */
+struct radix *radix_new (void);
+void radix_free (struct radix *);
+int radix_insert (struct radix *, const char *, void *);
+void *radix_delete (struct radix *, const char *);
+void *radix_lookup (struct radix *, const char *);
+int radix_complete (struct radix *, const char *,
+                    void (*) (const char *, void *), void *);
+
+#endif /* _ZEBRA_RADIX_H */
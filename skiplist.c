@@ -0,0 +1,241 @@
+/* Skip list, an ordered container.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <stddef.h>
+
+#include "memory.h"
+#include "skiplist.h"
+
+static struct skiplist_node *
+skiplist_node_new (int level, void *data)
+{
+  struct skiplist_node *node;
+
+  node = XCALLOC (MTYPE_SKIPLIST_NODE, sizeof (struct skiplist_node)
+                  + sizeof (struct skiplist_node *) * (level - 1));
+  node->level = level;
+  node->data = data;
+  return node;
+}
+
+/* Level of a new node, each level up is taken with a chance of 1/4. */
+static int
+skiplist_random_level (struct skiplist *sl)
+{
+  unsigned int r;
+  int level = 1;
+
+  /* xorshift32 */
+  r = sl->seed;
+  r ^= r << 13;
+  r ^= r >> 17;
+  r ^= r << 5;
+  sl->seed = r;
+
+  while ((r & 3) == 0 && level < SKIPLIST_MAXLEVEL)
+    {
+      level++;
+      r >>= 2;
+    }
+  return level;
+}
+
+/* Fill UPDATE with the last node on each level before KEY, or before
+   the first element after KEY when AFTER is set. */
+static void
+skiplist_find (struct skiplist *sl, void *key, int after,
+               struct skiplist_node **update)
+{
+  struct skiplist_node *x = sl->head;
+  int i, c;
+
+  for (i = sl->level - 1; i >= 0; i--)
+    {
+      while (x->forward[i])
+        {
+          c = (*sl->cmp) (x->forward[i]->data, key);
+          if (c > 0 || (c == 0 && ! after))
+            break;
+          x = x->forward[i];
+        }
+      update[i] = x;
+    }
+}
+
+struct skiplist *
+skiplist_new (int (*cmp) (void *, void *))
+{
+  struct skiplist *sl;
+
+  sl = XCALLOC (MTYPE_SKIPLIST, sizeof (struct skiplist));
+  sl->head = skiplist_node_new (SKIPLIST_MAXLEVEL, NULL);
+  sl->level = 1;
+  sl->seed = (unsigned int) ((unsigned long) sl >> 4) | 1;
+  sl->cmp = cmp;
+  DLIST_INIT (&sl->cursors);
+  return sl;
+}
+
+/* Free the list, but not its elements. */
+void
+skiplist_free (struct skiplist *sl)
+{
+  struct skiplist_node *node;
+  struct skiplist_node *next;
+
+  for (node = sl->head->forward[0]; node; node = next)
+    {
+      next = node->forward[0];
+      XFREE (MTYPE_SKIPLIST_NODE, node);
+    }
+  XFREE (MTYPE_SKIPLIST_NODE, sl->head);
+  XFREE (MTYPE_SKIPLIST, sl);
+}
+
+/* Add DATA after the elements which are equal to it. */
+void
+skiplist_insert (struct skiplist *sl, void *data)
+{
+  struct skiplist_node *update[SKIPLIST_MAXLEVEL];
+  struct skiplist_node *node;
+  int level, i;
+
+  skiplist_find (sl, data, 1, update);
+
+  level = skiplist_random_level (sl);
+  for (i = sl->level; i < level; i++)
+    update[i] = sl->head;
+  if (level > sl->level)
+    sl->level = level;
+
+  node = skiplist_node_new (level, data);
+  for (i = 0; i < level; i++)
+    {
+      node->forward[i] = update[i]->forward[i];
+      update[i]->forward[i] = node;
+    }
+  sl->count++;
+}
+
+/* Remove element DATA, which is looked up by key and then by
+   pointer.  Cursors at it move on to the next element.  Returns -1
+   when it's not on the list. */
+int
+skiplist_delete (struct skiplist *sl, void *data)
+{
+  struct skiplist_node *update[SKIPLIST_MAXLEVEL];
+  struct skiplist_node *node;
+  struct skiplist_cursor *c;
+  struct dlink *nn;
+  int i;
+
+  skiplist_find (sl, data, 0, update);
+
+  for (node = update[0]->forward[0]; node; node = node->forward[0])
+    if (node->data == data || (*sl->cmp) (node->data, data) != 0)
+      break;
+  if (node == NULL || node->data != data)
+    return -1;
+
+  /* Equal elements before it may stand between it and the nodes
+     found. */
+  for (i = 0; i < node->level; i++)
+    {
+      while (update[i]->forward[i] != node)
+        update[i] = update[i]->forward[i];
+      update[i]->forward[i] = node->forward[i];
+    }
+  while (sl->level > 1 && sl->head->forward[sl->level - 1] == NULL)
+    sl->level--;
+
+  DLIST_LOOP (&sl->cursors, c, nn, struct skiplist_cursor, link)
+    if (c->node == node)
+      {
+        c->node = node->forward[0];
+        c->advanced = 1;
+      }
+
+  XFREE (MTYPE_SKIPLIST_NODE, node);
+  sl->count--;
+  return 0;
+}
+
+/* First element which is equal to KEY. */
+void *
+skiplist_lookup (struct skiplist *sl, void *key)
+{
+  struct skiplist_node *update[SKIPLIST_MAXLEVEL];
+  struct skiplist_node *node;
+
+  skiplist_find (sl, key, 0, update);
+  node = update[0]->forward[0];
+  if (node && (*sl->cmp) (node->data, key) == 0)
+    return node->data;
+  return NULL;
+}
+
+void *
+skiplist_first (struct skiplist *sl)
+{
+  return sl->head->forward[0] ? sl->head->forward[0]->data : NULL;
+}
+
+/* Start a walk of SL before its first element.  The cursor must be
+   given back with skiplist_cursor_done (). */
+void
+skiplist_cursor_init (struct skiplist *sl, struct skiplist_cursor *c)
+{
+  c->sl = sl;
+  c->node = sl->head;
+  c->advanced = 0;
+  DLIST_ADD_TAIL (&sl->cursors, &c->link);
+}
+
+/* Move to the first element which isn't less than KEY and return it,
+   this starts a range. */
+void *
+skiplist_cursor_seek (struct skiplist_cursor *c, void *key)
+{
+  struct skiplist_node *update[SKIPLIST_MAXLEVEL];
+
+  skiplist_find (c->sl, key, 0, update);
+  c->node = update[0]->forward[0];
+  c->advanced = (c->node == NULL);
+  return c->node ? c->node->data : NULL;
+}
+
+/* Move to the next element and return it, NULL at the end. */
+void *
+skiplist_cursor_next (struct skiplist_cursor *c)
+{
+  if (c->advanced)
+    c->advanced = 0;
+  else if (c->node)
+    c->node = c->node->forward[0];
+  return c->node ? c->node->data : NULL;
+}
+
+void
+skiplist_cursor_done (struct skiplist_cursor *c)
+{
+  DLIST_DELETE (&c->sl->cursors, &c->link);
+}
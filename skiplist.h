@@ -0,0 +1,84 @@
+/* Skip list, an ordered container.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_SKIPLIST_H
+#define _ZEBRA_SKIPLIST_H
+
+#include "linklist.h"
+
+/* Levels of the list, enough for 4^16 elements. */
+#define SKIPLIST_MAXLEVEL 16
+
+struct skiplist_node
+{
+  void *data;
+  int level;
+  struct skiplist_node *forward[1];
+};
+
+/* Elements are kept in the order of CMP, which has the signature of a
+   struct list's cmp.  Equal elements stay in the order they were
+   inserted in.  The elements are the caller's, the list only points
+   at them. */
+struct skiplist
+{
+  struct skiplist_node *head;
+  int level;
+  unsigned int count;
+  unsigned int seed;
+  int (*cmp) (void *val1, void *val2);
+
+  /* Cursors walking the list. */
+  struct dlist cursors;
+};
+
+/* A position in a skip list.  It stays valid when elements are added
+   or removed, removing the element it's at moves it to the next. */
+struct skiplist_cursor
+{
+  struct dlink link;
+  struct skiplist *sl;
+  struct skiplist_node *node;
+  int advanced;
+};
+
+#define skiplist_count(S) ((S)->count)
+
+/* Walk the elements V of S in order.  S must not change meanwhile,
+   use a cursor for that. */
+#define SKIPLIST_LOOP(S,V,N) \
+  for ((N) = (S)->head->forward[0]; \
+       (N) && ((V) = (N)->data, 1); \
+       (N) = (N)->forward[0])
+
+/* Prototypes. */
+struct skiplist *skiplist_new (int (*) (void *, void *));
+void skiplist_free (struct skiplist *);
+void skiplist_insert (struct skiplist *, void *);
+int skiplist_delete (struct skiplist *, void *);
+void *skiplist_lookup (struct skiplist *, void *);
+void *skiplist_first (struct skiplist *);
+
+void skiplist_cursor_init (struct skiplist *, struct skiplist_cursor *);
+void *skiplist_cursor_seek (struct skiplist_cursor *, void *);
+void *skiplist_cursor_next (struct skiplist_cursor *);
+void skiplist_cursor_done (struct skiplist_cursor *);
+
+#endif /* _ZEBRA_SKIPLIST_H */
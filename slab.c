@@ -0,0 +1,413 @@
+/* Slab caches for small objects.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "vty.h"
+#include "slab.h"
+
+/* A slab starts with this header, the objects follow.  Objects which
+   have never been handed out are taken from BUMP, freed ones are
+   chained through their first word. */
+struct slab
+{
+  struct slab *next;
+  struct slab *prev;
+  struct slab_cache *cache;
+  void *free;
+  unsigned int bump;
+  unsigned int inuse;
+  int listed;
+};
+
+#define SLAB_HEADER_SIZE \
+  ((sizeof (struct slab) + 63) & ~63UL)
+
+/* Find the slab of object P. */
+#define SLAB_OF(p) \
+  ((struct slab *) ((unsigned long) (p) & ~(SLAB_SIZE - 1)))
+
+/* All slabs of one size class. */
+struct slab_cache
+{
+  pthread_mutex_t mtx;
+  int index;
+  unsigned int size;
+
+  /* Slabs with room left, full slabs are on no list. */
+  struct slab *partial;
+
+  /* One empty slab is kept to avoid bouncing at the boundary. */
+  struct slab *empty;
+
+  unsigned long slabs;
+  unsigned long inuse;
+};
+
+/* Objects which a thread has at hand for one size class. */
+struct slab_magazine
+{
+  int count;
+  void *obj[SLAB_MAGAZINE_SIZE];
+};
+
+static const unsigned short slab_sizes[] =
+{
+  16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+#define SLAB_CLASSES (sizeof (slab_sizes) / sizeof (slab_sizes[0]))
+
+static struct slab_cache slab_caches[SLAB_CLASSES];
+
+/* Size class of each 16 byte step up to SLAB_OBJECT_MAX. */
+static unsigned char slab_index[(SLAB_OBJECT_MAX >> 4) + 1];
+
+static __thread struct slab_magazine slab_mag[SLAB_CLASSES];
+static __thread int slab_thread_registered;
+
+/* The region slabs are cut from. */
+char *slab_base;
+static unsigned long slab_brk;
+static struct slab *slab_released;
+static unsigned long slab_released_count;
+static pthread_mutex_t slab_region_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t slab_key;
+static int slab_disabled;
+
+static void slab_thread_exit (void *);
+
+static void
+slab_init_once (void)
+{
+  char *p;
+  unsigned long skew;
+  unsigned int i, c;
+
+  for (c = i = 0; i < sizeof (slab_index); i++)
+    {
+      while (slab_sizes[c] < (i << 4))
+        c++;
+      slab_index[i] = c;
+    }
+
+  for (c = 0; c < SLAB_CLASSES; c++)
+    {
+      pthread_mutex_init (&slab_caches[c].mtx, NULL);
+      slab_caches[c].index = c;
+      slab_caches[c].size = slab_sizes[c];
+    }
+
+  pthread_key_create (&slab_key, slab_thread_exit);
+
+  /* Address space only, pages are only backed once touched. */
+  p = mmap (NULL, SLAB_REGION_SIZE + SLAB_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED)
+    {
+      slab_disabled = 1;
+      return;
+    }
+
+  skew = (unsigned long) p & (SLAB_SIZE - 1);
+  if (skew)
+    {
+      munmap (p, SLAB_SIZE - skew);
+      p += SLAB_SIZE - skew;
+      munmap (p + SLAB_REGION_SIZE, skew);
+    }
+  else
+    munmap (p + SLAB_REGION_SIZE, SLAB_SIZE);
+
+  __atomic_store_n (&slab_base, p, __ATOMIC_RELEASE);
+}
+
+static int
+slab_init (void)
+{
+  pthread_once (&slab_once, slab_init_once);
+  return slab_disabled ? -1 : 0;
+}
+
+/* Magazines of a thread which goes away are given back. */
+static void
+slab_thread_register (void)
+{
+  if (! slab_thread_registered)
+    {
+      slab_thread_registered = 1;
+      pthread_setspecific (slab_key, (void *) 1);
+    }
+}
+
+/* Get a fresh slab from the region. */
+static struct slab *
+slab_region_get (void)
+{
+  struct slab *s = NULL;
+
+  pthread_mutex_lock (&slab_region_mtx);
+  if (slab_released)
+    {
+      s = slab_released;
+      slab_released = s->next;
+      slab_released_count--;
+    }
+  else if (slab_brk < SLAB_REGION_SIZE)
+    {
+      s = (struct slab *) (slab_base + slab_brk);
+      slab_brk += SLAB_SIZE;
+    }
+  pthread_mutex_unlock (&slab_region_mtx);
+
+  return s;
+}
+
+/* Give an empty slab's pages back to the system. */
+static void
+slab_region_put (struct slab *s)
+{
+  madvise (s, SLAB_SIZE, MADV_DONTNEED);
+
+  pthread_mutex_lock (&slab_region_mtx);
+  s->next = slab_released;
+  slab_released = s;
+  slab_released_count++;
+  pthread_mutex_unlock (&slab_region_mtx);
+}
+
+static void
+slab_link (struct slab_cache *cache, struct slab *s)
+{
+  s->prev = NULL;
+  s->next = cache->partial;
+  if (cache->partial)
+    cache->partial->prev = s;
+  cache->partial = s;
+  s->listed = 1;
+}
+
+static void
+slab_unlink (struct slab_cache *cache, struct slab *s)
+{
+  if (s->prev)
+    s->prev->next = s->next;
+  else
+    cache->partial = s->next;
+  if (s->next)
+    s->next->prev = s->prev;
+  s->listed = 0;
+}
+
+/* Make S an empty slab of CACHE. */
+static void
+slab_reset (struct slab_cache *cache, struct slab *s)
+{
+  s->cache = cache;
+  s->free = NULL;
+  s->bump = SLAB_HEADER_SIZE;
+  s->inuse = 0;
+  s->listed = 0;
+}
+
+/* Take an object from CACHE, with its lock held. */
+static void *
+slab_get (struct slab_cache *cache)
+{
+  struct slab *s;
+  void *p;
+
+  s = cache->partial;
+  if (s == NULL)
+    {
+      s = cache->empty;
+      if (s)
+        cache->empty = NULL;
+      else
+        {
+          s = slab_region_get ();
+          if (s == NULL)
+            return NULL;
+          cache->slabs++;
+        }
+      slab_reset (cache, s);
+      slab_link (cache, s);
+    }
+
+  if (s->free)
+    {
+      p = s->free;
+      s->free = *(void **) p;
+    }
+  else
+    {
+      p = (char *) s + s->bump;
+      s->bump += cache->size;
+    }
+  s->inuse++;
+  cache->inuse++;
+
+  if (s->free == NULL && s->bump + cache->size > SLAB_SIZE)
+    slab_unlink (cache, s);
+
+  return p;
+}
+
+/* Return object P to CACHE, with its lock held. */
+static void
+slab_put (struct slab_cache *cache, void *p)
+{
+  struct slab *s = SLAB_OF (p);
+
+  *(void **) p = s->free;
+  s->free = p;
+  s->inuse--;
+  cache->inuse--;
+
+  if (! s->listed)
+    slab_link (cache, s);
+
+  if (s->inuse == 0)
+    {
+      slab_unlink (cache, s);
+      if (cache->empty == NULL)
+        cache->empty = s;
+      else
+        {
+          cache->slabs--;
+          slab_region_put (s);
+        }
+    }
+}
+
+/* Fill an empty magazine halfway. */
+static int
+slab_refill (struct slab_cache *cache, struct slab_magazine *m)
+{
+  void *p;
+
+  slab_thread_register ();
+
+  pthread_mutex_lock (&cache->mtx);
+  while (m->count < SLAB_MAGAZINE_SIZE / 2
+         && (p = slab_get (cache)) != NULL)
+    m->obj[m->count++] = p;
+  pthread_mutex_unlock (&cache->mtx);
+
+  return m->count;
+}
+
+/* Move COUNT objects from a magazine back to their slabs. */
+static void
+slab_drain (struct slab_cache *cache, struct slab_magazine *m, int count)
+{
+  pthread_mutex_lock (&cache->mtx);
+  while (count-- > 0 && m->count > 0)
+    slab_put (cache, m->obj[--m->count]);
+  pthread_mutex_unlock (&cache->mtx);
+}
+
+static void
+slab_thread_exit (void *arg)
+{
+  unsigned int c;
+
+  for (c = 0; c < SLAB_CLASSES; c++)
+    slab_drain (&slab_caches[c], &slab_mag[c], SLAB_MAGAZINE_SIZE);
+}
+
+/* Allocate SIZE bytes from a slab.  Returns NULL when SIZE is too
+   large or the region is used up, the caller falls back to malloc. */
+void *
+slab_alloc (size_t size)
+{
+  struct slab_magazine *m;
+  int c;
+
+  if (size > SLAB_OBJECT_MAX)
+    return NULL;
+  if (slab_base == NULL && slab_init () < 0)
+    return NULL;
+
+  c = slab_index[(size + 15) >> 4];
+  m = &slab_mag[c];
+  if (m->count == 0 && slab_refill (&slab_caches[c], m) == 0)
+    return NULL;
+
+  return m->obj[--m->count];
+}
+
+/* Free object P, which must be owned by a slab. */
+void
+slab_free (void *p)
+{
+  struct slab_cache *cache = SLAB_OF (p)->cache;
+  struct slab_magazine *m = &slab_mag[cache->index];
+
+  if (m->count == 0)
+    slab_thread_register ();
+  else if (m->count == SLAB_MAGAZINE_SIZE)
+    slab_drain (cache, m, SLAB_MAGAZINE_SIZE / 2);
+
+  m->obj[m->count++] = p;
+}
+
+/* Usable size of slab object P. */
+size_t
+slab_size (void *p)
+{
+  return SLAB_OF (p)->cache->size;
+}
+
+void
+slab_show (struct vty *vty)
+{
+  struct slab_cache *cache;
+  unsigned long slabs, inuse, capacity;
+  unsigned int c;
+
+  vty_out (vty, "  Size  Slabs    In use      Free%s", VTY_NEWLINE);
+  for (c = 0; c < SLAB_CLASSES; c++)
+    {
+      cache = &slab_caches[c];
+
+      pthread_mutex_lock (&cache->mtx);
+      slabs = cache->slabs;
+      inuse = cache->inuse;
+      pthread_mutex_unlock (&cache->mtx);
+
+      if (slabs == 0)
+        continue;
+      capacity = slabs * ((SLAB_SIZE - SLAB_HEADER_SIZE) / cache->size);
+      vty_out (vty, "  %4u  %5lu  %8lu  %8lu%s", cache->size, slabs, inuse,
+               capacity - inuse, VTY_NEWLINE);
+    }
+
+  pthread_mutex_lock (&slab_region_mtx);
+  vty_out (vty, "Region: %lu of %lu KB used, %lu slabs released%s",
+           (slab_brk - slab_released_count * SLAB_SIZE) >> 10,
+           SLAB_REGION_SIZE >> 10, slab_released_count, VTY_NEWLINE);
+  pthread_mutex_unlock (&slab_region_mtx);
+}
@@ -0,0 +1,51 @@
+/* Slab caches for small objects.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_SLAB_H
+#define _ZEBRA_SLAB_H
+
+/* Slabs are carved out of one reserved region of this size. */
+#define SLAB_REGION_SIZE   (256UL << 20)
+
+/* Size of a slab, slabs are aligned to it. */
+#define SLAB_SIZE          (64UL << 10)
+
+/* Largest object served from a slab. */
+#define SLAB_OBJECT_MAX    2048
+
+/* Objects a thread keeps for itself per size class. */
+#define SLAB_MAGAZINE_SIZE 32
+
+struct vty;
+
+/* Prototypes. */
+void *slab_alloc (size_t);
+void slab_free (void *);
+size_t slab_size (void *);
+void slab_show (struct vty *);
+
+extern char *slab_base;
+
+/* Is P an object from a slab? */
+#define SLAB_OWNS(p) \
+  (slab_base \
+   && (unsigned long) ((char *) (p) - slab_base) < SLAB_REGION_SIZE)
+
+#endif /* _ZEBRA_SLAB_H */
@@ -23,6 +23,65 @@
 
 #include "vector.h"
 #include "memory.h"
+#include "arena.h"
+
+#define VECTOR_WORD_BITS  (sizeof (unsigned long) * 8)
+#define VECTOR_WORDS(n)   (((n) + VECTOR_WORD_BITS - 1) / VECTOR_WORD_BITS)
+
+#define VECTOR_USED(v,i) \
+  ((v)->used[(i) / VECTOR_WORD_BITS] & (1UL << ((i) % VECTOR_WORD_BITS)))
+
+/* Allocate the bitmap of SIZE slots of V, cleared.  A bitmap of one
+   word is kept in the vector itself. */
+static unsigned long *
+vector_used_alloc (vector v, unsigned int size)
+{
+  size_t len = sizeof (unsigned long) * VECTOR_WORDS (size);
+  unsigned long *used;
+
+  if (VECTOR_WORDS (size) <= 1)
+    {
+      v->used0 = 0;
+      return &v->used0;
+    }
+
+  if (v->arena)
+    {
+      used = arena_alloc (v->arena, len);
+      memset (used, 0, len);
+    }
+  else
+    used = XCALLOC (MTYPE_VECTOR_INDEX, len);
+  return used;
+}
+
+static void
+vector_used_free (vector v)
+{
+  if (v->used != &v->used0 && ! v->arena)
+    XFREE (MTYPE_VECTOR_INDEX, v->used);
+}
+
+/* Record whether slot I holds a value. */
+static void
+vector_mark (vector v, unsigned int i, void *val)
+{
+  unsigned long bit = 1UL << (i % VECTOR_WORD_BITS);
+  unsigned long *word = &v->used[i / VECTOR_WORD_BITS];
+
+  if (val && ! (*word & bit))
+    {
+      *word |= bit;
+      v->count++;
+    }
+  else if (! val && (*word & bit))
+    {
+      *word &= ~bit;
+      v->count--;
+      if (i < v->hint)
+        v->hint = i;
+    }
+}
 
 /* Initialize vector : allocate memory and return vector. */
 vector
@@ -37,12 +96,35 @@ vector_init (unsigned int size)
   v->alloced = size;
   v->max = 0;
   v->index = XCALLOC (MTYPE_VECTOR_INDEX, sizeof (void *) * size);
+  v->used = vector_used_alloc (v, size);
+  return v;
+}
+
+/* Initialize vector in ARENA, it goes away with the arena and must
+   not be freed. */
+vector
+vector_init_arena (struct arena *arena, unsigned int size)
+{
+  vector v = arena_alloc (arena, sizeof (struct _vector));
+
+  if (size == 0)
+    size = 1;
+
+  memset (v, 0, sizeof (struct _vector));
+  v->alloced = size;
+  v->arena = arena;
+  v->index = arena_alloc (arena, sizeof (void *) * size);
+  memset (v->index, 0, sizeof (void *) * size);
+  v->used = vector_used_alloc (v, size);
   return v;
 }
 
 void
 vector_only_wrapper_free (vector v)
 {
+  if (v->arena)
+    return;
+  vector_used_free (v);
   XFREE (MTYPE_VECTOR, v);
 }
 
@@ -55,22 +137,48 @@ vector_only_index_free (void *index)
 void
 vector_free (vector v)
 {
+  if (v->arena)
+    return;
+  vector_used_free (v);
   XFREE (MTYPE_VECTOR_INDEX, v->index);
   XFREE (MTYPE_VECTOR, v);
 }
 
+/* Fill NEW, which has V's size, with the contents of V. */
+static void
+vector_copy_contents (vector new, vector v)
+{
+  new->max = v->max;
+  new->alloced = v->alloced;
+  new->count = v->count;
+  new->hint = v->hint;
+  memcpy (new->index, v->index, sizeof (void *) * v->alloced);
+  new->used = vector_used_alloc (new, v->alloced);
+  memcpy (new->used, v->used,
+          sizeof (unsigned long) * VECTOR_WORDS (v->alloced));
+}
+
 vector
 vector_copy (vector v)
 {
-  unsigned int size;
   vector new = XCALLOC (MTYPE_VECTOR, sizeof (struct _vector));
 
-  new->max = v->max;
-  new->alloced = v->alloced;
+  new->index = XMALLOC (MTYPE_VECTOR_INDEX, sizeof (void *) * v->alloced);
+  vector_copy_contents (new, v);
+
+  return new;
+}
 
-  size = sizeof (void *) * (v->alloced);
-  new->index = XCALLOC (MTYPE_VECTOR_INDEX, size);
-  memcpy (new->index, v->index, size);
+/* Copy vector V into ARENA. */
+vector
+vector_copy_arena (struct arena *arena, vector v)
+{
+  vector new = arena_alloc (arena, sizeof (struct _vector));
+
+  memset (new, 0, sizeof (struct _vector));
+  new->arena = arena;
+  new->index = arena_alloc (arena, sizeof (void *) * v->alloced);
+  vector_copy_contents (new, v);
 
   return new;
 }
@@ -79,16 +187,40 @@ vector_copy (vector v)
 void
 vector_ensure (vector v, unsigned int num)
 {
+  unsigned int alloced;
+  unsigned long *used;
+  void **index;
+
   if (v->alloced > num)
     return;
 
-  v->index = XREALLOC (MTYPE_VECTOR_INDEX, 
-		       v->index, sizeof (void *) * (v->alloced * 2));
-  memset (&v->index[v->alloced], 0, sizeof (void *) * v->alloced);
-  v->alloced *= 2;
-  
-  if (v->alloced <= num)
-    vector_ensure (v, num);
+  alloced = v->alloced;
+  while (alloced <= num)
+    alloced *= 2;
+
+  if (v->arena)
+    {
+      index = arena_alloc (v->arena, sizeof (void *) * alloced);
+      memcpy (index, v->index, sizeof (void *) * v->alloced);
+      v->index = index;
+    }
+  else
+    v->index = XREALLOC (MTYPE_VECTOR_INDEX, 
+		         v->index, sizeof (void *) * alloced);
+  memset (&v->index[v->alloced], 0,
+          sizeof (void *) * (alloced - v->alloced));
+
+  if (VECTOR_WORDS (alloced) > VECTOR_WORDS (v->alloced))
+    {
+      used = v->used;
+      v->used = vector_used_alloc (v, alloced);
+      memcpy (v->used, used,
+              sizeof (unsigned long) * VECTOR_WORDS (v->alloced));
+      if (used != &v->used0 && ! v->arena)
+        XFREE (MTYPE_VECTOR_INDEX, used);
+    }
+
+  v->alloced = alloced;
 }
 
 /* This function only returns next empty slot index.  It dose not mean
@@ -97,15 +229,26 @@ vector_ensure (vector v, unsigned int num)
 int
 vector_empty_slot (vector v)
 {
+  unsigned int w;
+  unsigned int words = VECTOR_WORDS (v->alloced);
   unsigned int i;
 
-  if (v->max == 0)
-    return 0;
+  /* Every slot below the hint is taken, look from there a word at a
+     time. */
+  for (w = v->hint / VECTOR_WORD_BITS; w < words; w++)
+    if (v->used[w] != ~0UL)
+      break;
+
+  if (w == words)
+    i = v->alloced;
+  else
+    i = w * VECTOR_WORD_BITS + __builtin_ctzl (~v->used[w]);
 
-  for (i = 0; i < v->max; i++)
-    if (v->index[i] == 0)
-      return i;
+  /* Slots past max are empty. */
+  if (i > v->max)
+    i = v->max;
 
+  v->hint = i;
   return i;
 }
 
@@ -119,6 +262,7 @@ vector_set (vector v, void *val)
   vector_ensure (v, i);
 
   v->index[i] = val;
+  vector_mark (v, i, val);
 
   if (v->max <= i)
     v->max = i + 1;
@@ -133,6 +277,7 @@ vector_set_index (vector v, unsigned int i, void *val)
   vector_ensure (v, i);
 
   v->index[i] = val;
+  vector_mark (v, i, val);
 
   if (v->max <= i)
     v->max = i + 1;
@@ -161,29 +306,54 @@ vector_lookup_ensure (vector v, unsigned int i)
 void
 vector_unset (vector v, unsigned int i)
 {
+  unsigned long word;
+  int w;
+
   if (i >= v->alloced)
     return;
 
   v->index[i] = NULL;
+  vector_mark (v, i, NULL);
 
-  if (i + 1 == v->max) 
-    {
-      v->max--;
-      while (i && v->index[--i] == NULL && v->max--) 
-	;				/* Is this ugly ? */
-    }
+  if (i + 1 != v->max)
+    return;
+
+  /* Shrink max to the last slot which is still set, there are none
+     past I. */
+  for (w = i / VECTOR_WORD_BITS; w >= 0; w--)
+    if ((word = v->used[w]) != 0)
+      break;
+  v->max = w < 0 ? 0 : w * VECTOR_WORD_BITS + VECTOR_WORD_BITS
+                       - __builtin_clzl (word);
 }
 
 /* Count the number of not emplty slot. */
 unsigned int
 vector_count (vector v)
 {
-  unsigned int i;
-  unsigned count = 0;
+  return v->count;
+}
+
+/* Index of the first not empty slot from I on, or vector_max () when
+   there is none. */
+unsigned int
+vector_next (vector v, unsigned int i)
+{
+  unsigned int w;
+  unsigned long word;
 
-  for (i = 0; i < v->max; i++) 
-    if (v->index[i] != NULL)
-      count++;
+  if (i >= v->max)
+    return v->max;
+
+  w = i / VECTOR_WORD_BITS;
+  word = v->used[w] & (~0UL << (i % VECTOR_WORD_BITS));
+  while (word == 0)
+    {
+      if (++w >= VECTOR_WORDS (v->max))
+        return v->max;
+      word = v->used[w];
+    }
 
-  return count;
+  i = w * VECTOR_WORD_BITS + __builtin_ctzl (word);
+  return i < v->max ? i : v->max;
 }
@@ -29,6 +29,11 @@ struct _vector
   unsigned int max;		/* max number of used slot */
   unsigned int alloced;		/* number of allocated slot */
   void **index;			/* index to data */
+  struct arena *arena;		/* owner of the memory, or NULL */
+  unsigned int count;		/* number of not empty slot */
+  unsigned int hint;		/* no empty slot below this */
+  unsigned long *used;		/* bit per not empty slot */
+  unsigned long used0;		/* the bits while they fit a word */
 };
 typedef struct _vector *vector;
 
@@ -39,18 +44,31 @@ typedef struct _vector *vector;
 #define vector_slot(V,I)  ((V)->index[(I)])
 #define vector_max(V) ((V)->max)
 
-/* Prototypes. */
+/* Walk the not empty slots of V, holes are skipped a word of the bitmap
+   at a time.  The slot at I may be unset while walking. */
+#define vector_foreach(V,I,VAL) \
+  for ((I) = vector_next ((V), 0); \
+       (I) < vector_max (V) && ((VAL) = vector_slot ((V), (I)), 1); \
+       (I) = vector_next ((V), (I) + 1))
+
+/* Prototypes.  Slots are only set and unset through these, which keep
+   the bitmap and count up to date; vector_slot () is for reading. */
+struct arena;
+
 vector vector_init (unsigned int size);
+vector vector_init_arena (struct arena *, unsigned int size);
 void vector_ensure (vector v, unsigned int num);
 int vector_empty_slot (vector v);
 int vector_set (vector v, void *val);
 int vector_set_index (vector v, unsigned int i, void *val);
 void vector_unset (vector v, unsigned int i);
 unsigned int vector_count (vector v);
+unsigned int vector_next (vector v, unsigned int i);
 void vector_only_wrapper_free (vector v);
 void vector_only_index_free (void *index);
 void vector_free (vector v);
 vector vector_copy (vector v);
+vector vector_copy_arena (struct arena *, vector v);
 
 void *vector_lookup (vector, unsigned int);
 void *vector_lookup_ensure (vector, unsigned int);
@@ -0,0 +1,241 @@
+/* VLAN sets.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
+#include "vlan.h"
+
+/* Set operations work on 128 bits at a time where SSE2 is there; a
+   bitmap is 32 such lanes. */
+
+void
+vlan_bitmap_zero (struct vlan_bitmap *b)
+{
+  memset (b, 0, sizeof (struct vlan_bitmap));
+}
+
+/* DST = A | B. */
+void
+vlan_bitmap_or (struct vlan_bitmap *dst, const struct vlan_bitmap *a,
+                const struct vlan_bitmap *b)
+{
+#ifdef __SSE2__
+  const __m128i *pa = (const __m128i *) a->w;
+  const __m128i *pb = (const __m128i *) b->w;
+  __m128i *pd = (__m128i *) dst->w;
+  unsigned int i;
+
+  for (i = 0; i < sizeof (struct vlan_bitmap) / sizeof (__m128i); i++)
+    _mm_store_si128 (pd + i, _mm_or_si128 (_mm_load_si128 (pa + i),
+                                           _mm_load_si128 (pb + i)));
+#else
+  unsigned int i;
+
+  for (i = 0; i < VLAN_WORDS; i++)
+    dst->w[i] = a->w[i] | b->w[i];
+#endif /* __SSE2__ */
+}
+
+/* DST = A & B. */
+void
+vlan_bitmap_and (struct vlan_bitmap *dst, const struct vlan_bitmap *a,
+                 const struct vlan_bitmap *b)
+{
+#ifdef __SSE2__
+  const __m128i *pa = (const __m128i *) a->w;
+  const __m128i *pb = (const __m128i *) b->w;
+  __m128i *pd = (__m128i *) dst->w;
+  unsigned int i;
+
+  for (i = 0; i < sizeof (struct vlan_bitmap) / sizeof (__m128i); i++)
+    _mm_store_si128 (pd + i, _mm_and_si128 (_mm_load_si128 (pa + i),
+                                            _mm_load_si128 (pb + i)));
+#else
+  unsigned int i;
+
+  for (i = 0; i < VLAN_WORDS; i++)
+    dst->w[i] = a->w[i] & b->w[i];
+#endif /* __SSE2__ */
+}
+
+/* DST = A & ~B, the VLANs of A which aren't in B. */
+void
+vlan_bitmap_andnot (struct vlan_bitmap *dst, const struct vlan_bitmap *a,
+                    const struct vlan_bitmap *b)
+{
+#ifdef __SSE2__
+  const __m128i *pa = (const __m128i *) a->w;
+  const __m128i *pb = (const __m128i *) b->w;
+  __m128i *pd = (__m128i *) dst->w;
+  unsigned int i;
+
+  for (i = 0; i < sizeof (struct vlan_bitmap) / sizeof (__m128i); i++)
+    _mm_store_si128 (pd + i, _mm_andnot_si128 (_mm_load_si128 (pb + i),
+                                               _mm_load_si128 (pa + i)));
+#else
+  unsigned int i;
+
+  for (i = 0; i < VLAN_WORDS; i++)
+    dst->w[i] = a->w[i] & ~b->w[i];
+#endif /* __SSE2__ */
+}
+
+int
+vlan_bitmap_empty (const struct vlan_bitmap *b)
+{
+#ifdef __SSE2__
+  const __m128i *p = (const __m128i *) b->w;
+  __m128i acc = _mm_setzero_si128 ();
+  unsigned int i;
+
+  for (i = 0; i < sizeof (struct vlan_bitmap) / sizeof (__m128i); i++)
+    acc = _mm_or_si128 (acc, _mm_load_si128 (p + i));
+  return _mm_movemask_epi8 (_mm_cmpeq_epi8 (acc, _mm_setzero_si128 ()))
+         == 0xffff;
+#else
+  unsigned long acc = 0;
+  unsigned int i;
+
+  for (i = 0; i < VLAN_WORDS; i++)
+    acc |= b->w[i];
+  return acc == 0;
+#endif /* __SSE2__ */
+}
+
+unsigned int
+vlan_bitmap_count (const struct vlan_bitmap *b)
+{
+  unsigned int count = 0;
+  unsigned int i;
+
+  for (i = 0; i < VLAN_WORDS; i++)
+    count += __builtin_popcountl (b->w[i]);
+  return count;
+}
+
+/* First VLAN in B from V on, or -1. */
+int
+vlan_bitmap_next (const struct vlan_bitmap *b, int v)
+{
+  unsigned int w;
+  unsigned long word;
+
+  if (v >= VLAN_BITS)
+    return -1;
+
+  w = v / VLAN_WORD_BITS;
+  word = b->w[w] & (~0UL << (v % VLAN_WORD_BITS));
+  while (word == 0)
+    {
+      if (++w >= VLAN_WORDS)
+        return -1;
+      word = b->w[w];
+    }
+  return w * VLAN_WORD_BITS + __builtin_ctzl (word);
+}
+
+/* Read a VLAN ID at *P. */
+static int
+vlan_id_parse (const char **p)
+{
+  char *end;
+  long id;
+
+  if (! isdigit ((unsigned char) **p))
+    return -1;
+  id = strtol (*p, &end, 10);
+  if (id < VLAN_ID_MIN || id > VLAN_ID_MAX)
+    return -1;
+  *p = end;
+  return id;
+}
+
+/* Add the VLANs of list STR, such as "1,10-20,30", or "all", to B.
+   Returns -1 and leaves B alone when STR is malformed. */
+int
+vlan_list_parse (const char *str, struct vlan_bitmap *b)
+{
+  struct vlan_bitmap list;
+  const char *p = str;
+  int from, to;
+
+  vlan_bitmap_zero (&list);
+
+  if (strcmp (str, "all") == 0)
+    {
+      for (from = VLAN_ID_MIN; from <= VLAN_ID_MAX; from++)
+        VLAN_SET (&list, from);
+      vlan_bitmap_or (b, b, &list);
+      return 0;
+    }
+
+  for (;;)
+    {
+      if ((from = vlan_id_parse (&p)) < 0)
+        return -1;
+      to = from;
+      if (*p == '-')
+        {
+          p++;
+          if ((to = vlan_id_parse (&p)) < 0 || to < from)
+            return -1;
+        }
+      for (; from <= to; from++)
+        VLAN_SET (&list, from);
+
+      if (*p == '\0')
+        break;
+      if (*p++ != ',')
+        return -1;
+    }
+
+  vlan_bitmap_or (b, b, &list);
+  return 0;
+}
+
+/* Write B as a list of VLANs and ranges into BUF, "-" when it's
+   empty.  VLAN_LIST_MAX bytes fit any list, a smaller SIZE may cut
+   it short. */
+char *
+vlan_list_format (const struct vlan_bitmap *b, char *buf, size_t size)
+{
+  size_t len = 0;
+  int from, to;
+
+  buf[0] = '\0';
+  for (from = vlan_bitmap_next (b, 0); from >= 0 && len < size;
+       from = vlan_bitmap_next (b, to + 1))
+    {
+      for (to = from; to + 1 < VLAN_BITS && VLAN_ISSET (b, to + 1); to++)
+        ;
+      if (to == from)
+        len += snprintf (buf + len, size - len, "%s%d", len ? "," : "", from);
+      else
+        len += snprintf (buf + len, size - len, "%s%d-%d", len ? "," : "",
+                         from, to);
+    }
+  if (len == 0)
+    snprintf (buf, size, "-");
+  return buf;
+}
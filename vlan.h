@@ -0,0 +1,69 @@
+/* VLAN sets.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_VLAN_H
+#define _ZEBRA_VLAN_H
+
+/* Usable VLAN IDs, 0 and 4095 are reserved. */
+#define VLAN_ID_MIN 1
+#define VLAN_ID_MAX 4094
+
+#define VLAN_BITS       4096
+#define VLAN_WORD_BITS  (8 * sizeof (unsigned long))
+#define VLAN_WORDS      (VLAN_BITS / VLAN_WORD_BITS)
+
+/* A set of VLANs, a bit per ID. */
+struct vlan_bitmap
+{
+  unsigned long w[VLAN_WORDS];
+} __attribute__ ((aligned (16)));
+
+#define VLAN_SET(B,V) \
+  ((B)->w[(V) / VLAN_WORD_BITS] |= 1UL << ((V) % VLAN_WORD_BITS))
+#define VLAN_UNSET(B,V) \
+  ((B)->w[(V) / VLAN_WORD_BITS] &= ~(1UL << ((V) % VLAN_WORD_BITS)))
+#define VLAN_ISSET(B,V) \
+  (((B)->w[(V) / VLAN_WORD_BITS] >> ((V) % VLAN_WORD_BITS)) & 1)
+
+/* Walk the VLANs V in B in order. */
+#define VLAN_LOOP(B,V) \
+  for ((V) = vlan_bitmap_next ((B), 0); (V) >= 0; \
+       (V) = vlan_bitmap_next ((B), (V) + 1))
+
+/* Longest list vlan_list_format () makes, with its NUL: pairs of VLANs
+   with one left out between them, "1-2,4-5,...,4093-4094".  Every third
+   VLAN then costs a range of two. */
+#define VLAN_LIST_MAX 12912
+
+/* Prototypes. */
+void vlan_bitmap_zero (struct vlan_bitmap *);
+void vlan_bitmap_or (struct vlan_bitmap *, const struct vlan_bitmap *,
+                     const struct vlan_bitmap *);
+void vlan_bitmap_and (struct vlan_bitmap *, const struct vlan_bitmap *,
+                      const struct vlan_bitmap *);
+void vlan_bitmap_andnot (struct vlan_bitmap *, const struct vlan_bitmap *,
+                         const struct vlan_bitmap *);
+int vlan_bitmap_empty (const struct vlan_bitmap *);
+unsigned int vlan_bitmap_count (const struct vlan_bitmap *);
+int vlan_bitmap_next (const struct vlan_bitmap *, int);
+int vlan_list_parse (const char *, struct vlan_bitmap *);
+char *vlan_list_format (const struct vlan_bitmap *, char *, size_t);
+
+#endif /* _ZEBRA_VLAN_H */
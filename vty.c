@@ -29,7 +29,17 @@
 #include "memory.h"
 
 #include "log.h"
+#include "worker.h"
+#include "ioloop.h"
+#include "intern.h"
+#include "if.h"
+#include "ifevent.h"
+#include "ifnetlink.h"
 
+#include <regex.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/un.h>
 
 
 /* Vty events */
@@ -42,6 +52,7 @@ enum event
   };
 
 static void vty_event (enum event, int, struct vty *);
+static void vty_input (struct vty *, unsigned char *, int);
 
 /* Extern host structure from command.c */
 extern struct host host;
@@ -74,6 +85,178 @@ static int no_password_check = 0;
 char integrate_default[] = INTEGRATE_DEFAULT_CONFIG;
 
 
+/* Output filter types, see vty_filter_parse (). */
+enum vty_filter_type
+{
+  VTY_FILTER_INCLUDE,
+  VTY_FILTER_EXCLUDE,
+  VTY_FILTER_BEGIN,
+  VTY_FILTER_COUNT
+};
+
+/* Output filter stage, alive for the duration of one command. */
+struct vty_filter
+{
+  enum vty_filter_type type;
+
+  /* Compiled regular expression, unused for count. */
+  regex_t re;
+
+  /* Begin filter has seen its first matching line. */
+  int begun;
+
+  /* Number of lines which passed. */
+  unsigned long count;
+
+  /* Partial line left over from the previous write. */
+  char *line;
+  size_t len;
+  size_t size;
+};
+
+/* Hand the IOVCNT pieces at IOV over to the vty's output sink. */
+static void
+vty_sinkv (struct vty *vty, const struct iovec *iov, int iovcnt)
+{
+  int i;
+
+  if (vty_shell (vty))
+    {
+      for (i = 0; i < iovcnt; i++)
+        fwrite (iov[i].iov_base, 1, iov[i].iov_len, stdout);
+    }
+  else if (vty_shell_serv (vty))
+    writev (vty->fd, iov, iovcnt);
+  else
+    {
+      buffer_writev (vty->obuf, iov, iovcnt);
+      if (vty->worker_job && vty->obuf->length >= WORKER_CHUNK_SIZE)
+        worker_flush (vty);
+    }
+}
+
+/* Hand bytes over to the vty's output sink. */
+static void
+vty_sink (struct vty *vty, const char *buf, size_t len)
+{
+  struct iovec iov;
+
+  iov.iov_base = (void *) buf;
+  iov.iov_len = len;
+  vty_sinkv (vty, &iov, 1);
+}
+
+/* Run one complete line, newline included, through the filter. */
+static void
+vty_filter_line (struct vty *vty, const char *line, size_t len)
+{
+  struct vty_filter *filter = vty->filter;
+  regmatch_t match;
+  size_t end;
+  int pass;
+
+  if (filter->type == VTY_FILTER_COUNT)
+    {
+      filter->count++;
+      return;
+    }
+
+  if (filter->type == VTY_FILTER_BEGIN && filter->begun)
+    {
+      vty_sink (vty, line, len);
+      return;
+    }
+
+  /* Match without the line terminator and without copying. */
+  end = len;
+  while (end && (line[end - 1] == '\n' || line[end - 1] == '\r'))
+    end--;
+  match.rm_so = 0;
+  match.rm_eo = end;
+  pass = (regexec (&filter->re, line, 1, &match, REG_STARTEND) == 0);
+
+  if (filter->type == VTY_FILTER_EXCLUDE)
+    pass = ! pass;
+  if (filter->type == VTY_FILTER_BEGIN)
+    filter->begun = pass;
+
+  if (pass)
+    {
+      filter->count++;
+      vty_sink (vty, line, len);
+    }
+}
+
+/* Streaming filter stage: split output into lines, only the current
+   partial line is kept back. */
+static void
+vty_filter_write (struct vty *vty, const char *buf, size_t len)
+{
+  struct vty_filter *filter = vty->filter;
+  const char *nl;
+
+  while (len)
+    {
+      nl = memchr (buf, '\n', len);
+      if (nl == NULL)
+        {
+          if (filter->len + len > filter->size)
+            {
+              filter->size = (filter->len + len) * 2;
+              filter->line = XREALLOC (MTYPE_VTY_OUT_BUF, filter->line,
+                                       filter->size);
+            }
+          memcpy (filter->line + filter->len, buf, len);
+          filter->len += len;
+          return;
+        }
+
+      nl++;
+      if (filter->len)
+        {
+          if (filter->len + (nl - buf) > filter->size)
+            {
+              filter->size = filter->len + (nl - buf);
+              filter->line = XREALLOC (MTYPE_VTY_OUT_BUF, filter->line,
+                                       filter->size);
+            }
+          memcpy (filter->line + filter->len, buf, nl - buf);
+          vty_filter_line (vty, filter->line, filter->len + (nl - buf));
+          filter->len = 0;
+        }
+      else
+        vty_filter_line (vty, buf, nl - buf);
+
+      len -= nl - buf;
+      buf = nl;
+    }
+}
+
+/* All vty output goes through here. */
+static void
+vty_write_out (struct vty *vty, const char *buf, size_t len)
+{
+  if (vty->filter)
+    vty_filter_write (vty, buf, len);
+  else
+    vty_sink (vty, buf, len);
+}
+
+/* Output the IOVCNT pieces at IOV, text which is ready as it is. */
+void
+vty_writev (struct vty *vty, const struct iovec *iov, int iovcnt)
+{
+  int i;
+
+  if (vty->filter)
+    {
+      for (i = 0; i < iovcnt; i++)
+        vty_write_out (vty, iov[i].iov_base, iov[i].iov_len);
+      return;
+    }
+  vty_sinkv (vty, iov, iovcnt);
+}
+
 /* VTY standard output function. */
 int
 vty_out (struct vty *vty, const char *format, ...)
@@ -86,54 +269,278 @@ vty_out (struct vty *vty, const char *format, ...)
   
   va_start (args, format);
 
-  if (vty_shell (vty))
-    vprintf (format, args);
-  else
-    {
-      /* Try to write to initial buffer.  */
-      len = vsnprintf (buf, sizeof buf, format, args);
+  /* Try to write to initial buffer.  */
+  len = vsnprintf (buf, sizeof buf, format, args);
+  va_end (args);
 
-      /* Initial buffer is not enough.  */
-      if (len < 0 || len >= size)
+  /* Initial buffer is not enough.  */
+  if (len < 0 || len >= size)
     {
       while (1)
         {
           if (len > -1)
-        size = len + 1;
+            size = len + 1;
           else
-        size = size * 2;
+            size = size * 2;
 
-          p = XREALLOC (MTYPE_VTY_OUT_BUF, p, size);
-          if (! p)
-        return -1;
+          /* Spilled output lives as long as the command. */
+          p = arena_alloc (&vty->arena, size);
 
+          va_start (args, format);
           len = vsnprintf (p, size, format, args);
+          va_end (args);
 
           if (len > -1 && len < size)
-        break;
+            break;
         }
     }
 
-      /* When initial buffer is enough to store all output.  */
-      if (! p)
+  /* When initial buffer is enough to store all output.  */
+  if (! p)
     p = buf;
 
-      /* Pointer p must point out buffer. */
-      if (vty_shell_serv (vty))
-    write (vty->fd, (u_char *) p, len);
-      else
-    buffer_write (vty->obuf, (u_char *) p, len);
+  vty_write_out (vty, p, len);
+
+  return len;
+}
 
-      /* If p is not different with buf, it is allocated buffer.  */
-      if (p != buf)
-    XFREE (MTYPE_VTY_OUT_BUF, p);
+/* Streaming JSON writer.  Show commands describe their output field
+   by field; in text mode a field is its value padded to a column, in
+   JSON mode a "key":value member.  Both are appended straight to the
+   output buffer without going through vsnprintf. */
+#define VTY_JSON_LEVEL_MAX (sizeof (unsigned long) * 8)
+
+static void
+vty_write_pad (struct vty *vty, int n)
+{
+  static const char spaces[] = "                                ";
+
+  while (n > 0)
+    {
+      int len = n < (int) sizeof spaces - 1 ? n : (int) sizeof spaces - 1;
+      vty_write_out (vty, spaces, len);
+      n -= len;
     }
+}
 
-  va_end (args);
+/* Decimal conversion of VAL into BUF, returns the length. */
+static int
+vty_ltoa (char *buf, long val)
+{
+  char tmp[24];
+  unsigned long u;
+  int len = 0;
+  int i = 0;
+
+  u = val < 0 ? - (unsigned long) val : (unsigned long) val;
+  do
+    {
+      tmp[i++] = '0' + u % 10;
+      u /= 10;
+    }
+  while (u);
+
+  if (val < 0)
+    buf[len++] = '-';
+  while (i)
+    buf[len++] = tmp[--i];
+  buf[len] = '\0';
 
   return len;
 }
 
+static void
+vty_json_string (struct vty *vty, const char *str)
+{
+  const char *sp;
+  const char *cp;
+  char esc[8];
+
+  vty_write_out (vty, "\"", 1);
+  for (sp = cp = str; *cp; cp++)
+    {
+      unsigned char c = *cp;
+
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+
+      vty_write_out (vty, sp, cp - sp);
+      switch (c)
+        {
+        case '"':
+          vty_write_out (vty, "\\\"", 2);
+          break;
+        case '\\':
+          vty_write_out (vty, "\\\\", 2);
+          break;
+        case '\n':
+          vty_write_out (vty, "\\n", 2);
+          break;
+        case '\r':
+          vty_write_out (vty, "\\r", 2);
+          break;
+        case '\t':
+          vty_write_out (vty, "\\t", 2);
+          break;
+        default:
+          snprintf (esc, sizeof esc, "\\u%04x", c);
+          vty_write_out (vty, esc, 6);
+          break;
+        }
+      sp = cp + 1;
+    }
+  vty_write_out (vty, sp, cp - sp);
+  vty_write_out (vty, "\"", 1);
+}
+
+/* Emit separator and key of a new member at the current level. */
+static void
+vty_json_member (struct vty *vty, const char *key)
+{
+  unsigned long bit = 1UL << (vty->json_level % VTY_JSON_LEVEL_MAX);
+
+  if (vty->json_sep & bit)
+    vty_write_out (vty, ",", 1);
+  vty->json_sep |= bit;
+
+  if (key)
+    {
+      vty_json_string (vty, key);
+      vty_write_out (vty, ":", 1);
+    }
+}
+
+static void
+vty_json_open (struct vty *vty, const char *key, const char *bracket)
+{
+  vty_json_member (vty, key);
+  vty_write_out (vty, bracket, 1);
+  vty->json_level++;
+  vty->json_sep &= ~(1UL << (vty->json_level % VTY_JSON_LEVEL_MAX));
+}
+
+static void
+vty_json_close (struct vty *vty, const char *bracket)
+{
+  if (vty->json_level == 0)
+    return;
+
+  vty->json_level--;
+  vty_write_out (vty, bracket, 1);
+
+  /* End of the document. */
+  if (vty->json_level == 0)
+    {
+      vty->json_sep = 0;
+      vty_write_out (vty, VTY_NEWLINE, strlen (VTY_NEWLINE));
+    }
+}
+
+/* JSON object, named KEY inside an enclosing object.  Nothing is
+   written in text mode. */
+void
+vty_object_begin (struct vty *vty, const char *key)
+{
+  if (vty->json)
+    vty_json_open (vty, key, "{");
+}
+
+void
+vty_object_end (struct vty *vty)
+{
+  if (vty->json)
+    vty_json_close (vty, "}");
+}
+
+/* JSON array, named KEY inside an enclosing object. */
+void
+vty_array_begin (struct vty *vty, const char *key)
+{
+  if (vty->json)
+    vty_json_open (vty, key, "[");
+}
+
+void
+vty_array_end (struct vty *vty)
+{
+  if (vty->json)
+    vty_json_close (vty, "]");
+}
+
+/* One line of text output, one object in JSON. */
+void
+vty_row_begin (struct vty *vty)
+{
+  if (vty->json)
+    vty_json_open (vty, NULL, "{");
+}
+
+void
+vty_row_end (struct vty *vty)
+{
+  if (vty->json)
+    vty_json_close (vty, "}");
+  else
+    vty_write_out (vty, VTY_NEWLINE, strlen (VTY_NEWLINE));
+}
+
+/* Decoration which only exists in text mode: headers, separators and
+   indentation.  TEXT is left justified in WIDTH columns. */
+void
+vty_field_label (struct vty *vty, int width, const char *text)
+{
+  int len;
+
+  if (vty->json)
+    return;
+
+  len = strlen (text);
+  vty_write_out (vty, text, len);
+  vty_write_pad (vty, width - len);
+}
+
+/* String field.  Text mode left justifies it in WIDTH columns. */
+void
+vty_field_str (struct vty *vty, const char *key, int width, const char *val)
+{
+  int len;
+
+  if (vty->json)
+    {
+      vty_json_member (vty, key);
+      vty_json_string (vty, val);
+      return;
+    }
+
+  len = strlen (val);
+  vty_write_out (vty, val, len);
+  vty_write_pad (vty, width - len);
+}
+
+/* Integer field.  Text mode left justifies it in WIDTH columns, or
+   right justifies it in -WIDTH columns. */
+void
+vty_field_int (struct vty *vty, const char *key, int width, long val)
+{
+  char buf[24];
+  int len;
+
+  len = vty_ltoa (buf, val);
+
+  if (vty->json)
+    {
+      vty_json_member (vty, key);
+      vty_write_out (vty, buf, len);
+      return;
+    }
+
+  if (width < 0)
+    vty_write_pad (vty, - width - len);
+  vty_write_out (vty, buf, len);
+  if (width > 0)
+    vty_write_pad (vty, width - len);
+}
+
 #define TIME_BUF 27
 
 /* current time string. */
@@ -152,35 +559,89 @@ time_str (char *buf)
   return ret;
 }
 
-int
-vty_log_out (struct vty *vty, const char *proto_str, const char *format,
-         va_list va)
+/* A log line formatted once for all monitoring vtys. */
+struct vty_log_rec
 {
-  int len;
-  int ret;
-  char buf[1024];
-  char time_buf[TIME_BUF];
+  int refcnt;
+  size_t len;
+  char msg[1];
+};
 
-  ret = time_str (time_buf);
+/* Log records may come from worker threads. */
+static pthread_mutex_t vty_log_mtx = PTHREAD_MUTEX_INITIALIZER;
 
-  if (ret != 0)
+static void
+vty_log_unref (struct vty_log_rec *rec)
+{
+  if (__atomic_sub_fetch (&rec->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+    XFREE (MTYPE_VTY_LOG, rec);
+}
+
+/* Queue REC on VTY's ring, a full ring drops it.  Called locked. */
+static void
+vty_log_enqueue (struct vty *vty, struct vty_log_rec *rec)
+{
+  if (vty->log_ring == NULL)
+    vty->log_ring = XCALLOC (MTYPE_VTY_LOG,
+                             sizeof (struct vty_log_rec *) * VTY_LOG_RING);
+
+  if (vty->log_head - vty->log_tail == VTY_LOG_RING)
     {
-      snprintf (buf, sizeof buf, "%s ", time_buf);
-      write (vty->fd, buf, strlen (time_buf) + 1);
+      vty->log_dropped++;
+      return;
     }
 
-  snprintf (buf, sizeof buf, "%s: ", proto_str);
-  write (vty->fd, buf, strlen (proto_str) + 2);
+  __atomic_add_fetch (&rec->refcnt, 1, __ATOMIC_RELAXED);
+  vty->log_ring[vty->log_head++ % VTY_LOG_RING] = rec;
+}
 
-  len = vsnprintf (buf, sizeof buf, format, va);
-  if (len < 0)
-    return -1;
-  write (vty->fd, (u_char *)buf, len);
+/* Move queued log records to the output buffer of VTY. */
+void
+vty_log_flush (struct vty *vty)
+{
+  struct vty_log_rec *recs[VTY_LOG_RING];
+  unsigned long dropped;
+  unsigned int i, n;
+
+  if (vty->log_ring == NULL)
+    return;
 
-  snprintf (buf, sizeof buf, "\r\n");
-  write (vty->fd, buf, 2);
+  pthread_mutex_lock (&vty_log_mtx);
+  for (n = 0; vty->log_tail != vty->log_head; n++)
+    recs[n] = vty->log_ring[vty->log_tail++ % VTY_LOG_RING];
+  dropped = vty->log_dropped;
+  vty->log_dropped = 0;
+  pthread_mutex_unlock (&vty_log_mtx);
 
-  return len;
+  for (i = 0; i < n; i++)
+    {
+      buffer_write (vty->obuf, (u_char *) recs[i]->msg, recs[i]->len);
+      buffer_write (vty->obuf, (u_char *) VTY_NEWLINE, strlen (VTY_NEWLINE));
+      vty_log_unref (recs[i]);
+    }
+
+  if (dropped)
+    vty_out (vty, "%% %lu log messages dropped%s", dropped, VTY_NEWLINE);
+
+  if (n || dropped)
+    vty_event (VTY_WRITE, vty->fd, vty);
+}
+
+/* Detach VTY from the log and drop what it hasn't shown yet. */
+static void
+vty_log_close (struct vty *vty)
+{
+  pthread_mutex_lock (&vty_log_mtx);
+  vty->monitor = 0;
+  if (vty->log_ring)
+    {
+      while (vty->log_tail != vty->log_head)
+        vty_log_unref (vty->log_ring[vty->log_tail++ % VTY_LOG_RING]);
+      XFREE (MTYPE_VTY_LOG, vty->log_ring);
+      vty->log_ring = NULL;
+      vty->log_dropped = 0;
+    }
+  pthread_mutex_unlock (&vty_log_mtx);
 }
 
 /* Output current time to the vty. */
@@ -345,21 +806,168 @@ vty_auth (struct vty *vty, char *buf)
     }
 }
 
+/* Attach the output filter described by STR, the text after '|' of a
+   command line.  Returns 0 when STR isn't a filter, -1 when it is but
+   can't be used, 1 when it has been attached. */
+static int
+vty_filter_parse (struct vty *vty, char *str)
+{
+  static const struct
+  {
+    const char *name;
+    int type;
+  } filters[] =
+    {
+      { "include", VTY_FILTER_INCLUDE },
+      { "exclude", VTY_FILTER_EXCLUDE },
+      { "begin",   VTY_FILTER_BEGIN },
+      { "count",   VTY_FILTER_COUNT },
+      { "json",    -1 },
+    };
+  struct vty_filter *filter;
+  char *cp, *word, *regex;
+  size_t len;
+  int i, ret;
+
+  for (cp = str; isspace ((int) *cp); cp++)
+    ;
+  for (word = cp; *cp != '\0' && ! isspace ((int) *cp); cp++)
+    ;
+  len = cp - word;
+  if (len == 0)
+    return 0;
+
+  for (i = 0; i < sizeof filters / sizeof filters[0]; i++)
+    if (strncmp (word, filters[i].name, len) == 0)
+      break;
+  if (i == sizeof filters / sizeof filters[0])
+    return 0;
+
+  for (; isspace ((int) *cp); cp++)
+    ;
+  len = strlen (cp);
+  while (len && isspace ((int) cp[len - 1]))
+    len--;
+
+  /* Structured output of field-level show commands. */
+  if (filters[i].type < 0)
+    {
+      vty->json = 1;
+      return 1;
+    }
+
+  if (filters[i].type != VTY_FILTER_COUNT && len == 0)
+    {
+      vty_out (vty, "%% Missing regular expression.%s", VTY_NEWLINE);
+      return -1;
+    }
+
+  filter = XCALLOC (MTYPE_VTY, sizeof (struct vty_filter));
+  filter->type = filters[i].type;
+
+  if (filter->type != VTY_FILTER_COUNT)
+    {
+      regex = XMALLOC (MTYPE_TMP, len + 1);
+      memcpy (regex, cp, len);
+      regex[len] = '\0';
+      ret = regcomp (&filter->re, regex, REG_EXTENDED | REG_NOSUB);
+      XFREE (MTYPE_TMP, regex);
+
+      if (ret != 0)
+        {
+          XFREE (MTYPE_VTY, filter);
+          vty_out (vty, "%% Invalid regular expression.%s", VTY_NEWLINE);
+          return -1;
+        }
+    }
+
+  vty->filter = filter;
+  return 1;
+}
+
+/* Flush the last partial line and detach the output filter.  The
+   count is only reported when the command could be executed. */
+static void
+vty_filter_finish (struct vty *vty, int ret)
+{
+  struct vty_filter *filter = vty->filter;
+
+  if (filter == NULL)
+    return;
+
+  if (filter->len)
+    vty_filter_line (vty, filter->line, filter->len);
+  vty->filter = NULL;
+
+  if (filter->type == VTY_FILTER_COUNT)
+    {
+      if (ret == CMD_SUCCESS || ret == CMD_WARNING)
+        vty_out (vty, "Count: %lu lines%s", filter->count, VTY_NEWLINE);
+    }
+  else
+    regfree (&filter->re);
+
+  if (filter->line)
+    XFREE (MTYPE_VTY_OUT_BUF, filter->line);
+  XFREE (MTYPE_VTY, filter);
+}
+
+/* End of the output of a command which returned RET. */
+void
+vty_output_finish (struct vty *vty, int ret)
+{
+  vty_filter_finish (vty, ret);
+  vty->json = 0;
+}
+
 /* Command execution over the vty interface. */
 int
 vty_command (struct vty *vty, char *buf)
 {
   int ret;
   vector vline;
+  char *pipe;
+
+  /* Cut off "| filter" while the command is split up, the line itself
+     is kept intact for the history. */
+  pipe = strchr (buf, '|');
+  if (pipe)
+    *pipe = '\0';
+
+  /* Split readline string up into the vector, everything the command
+     needs only while it runs goes to the arena. */
+  arena_reset (&vty->arena);
+  vline = cmd_make_strvec_arena (&vty->arena, buf);
 
-  /* Split readline string up into the vector */
-  vline = cmd_make_strvec (buf);
+  if (pipe)
+    *pipe = '|';
 
   if (vline == NULL)
     return CMD_SUCCESS;
 
+  if (pipe)
+    {
+      ret = vty_filter_parse (vty, pipe + 1);
+      if (ret < 0)
+        return CMD_WARNING;
+
+      /* Not a filter, '|' is part of the command. */
+      if (ret == 0)
+        vline = cmd_make_strvec_arena (&vty->arena, buf);
+    }
+
   ret = cmd_execute_command (vline, vty, NULL);
 
+  /* Output settings went with the command to the worker pool. */
+  if (ret == CMD_QUEUED)
+    {
+      vty->json = 0;
+      arena_reset (&vty->arena);
+      return ret;
+    }
+
+  vty_output_finish (vty, ret);
+
   if (ret != CMD_SUCCESS)
     switch (ret)
       {
@@ -377,7 +985,7 @@ vty_command (struct vty *vty, char *buf)
     vty_out (vty, "%% Command incomplete.%s", VTY_NEWLINE);
     break;
       }
-  cmd_free_strvec (vline);
+  arena_reset (&vty->arena);
 
   return ret;
 }
@@ -771,7 +1379,8 @@ vty_complete_command (struct vty *vty)
   if (vty->node == AUTH_NODE || vty->node == AUTH_ENABLE_NODE)
     return;
 
-  vline = cmd_make_strvec (vty->buf);
+  arena_reset (&vty->arena);
+  vline = cmd_make_strvec_arena (&vty->arena, vty->buf);
   if (vline == NULL)
     return;
 
@@ -780,8 +1389,6 @@ vty_complete_command (struct vty *vty)
     vector_set (vline, '\0');
 
   matched = cmd_complete_command (vline, vty, &ret);
-  
-  cmd_free_strvec (vline);
 
   vty_out (vty, "%s", VTY_NEWLINE);
   switch (ret)
@@ -885,12 +1492,13 @@ vty_describe_command (struct vty *vty)
   int i, width, desc_width;
   struct desc *desc, *desc_cr = NULL;
 
-  vline = cmd_make_strvec (vty->buf);
+  arena_reset (&vty->arena);
+  vline = cmd_make_strvec_arena (&vty->arena, vty->buf);
 
   /* In case of '> ?'. */
   if (vline == NULL)
     {
-      vline = vector_init (1);
+      vline = vector_init_arena (&vty->arena, 1);
       vector_set (vline, '\0');
     }
   else 
@@ -905,14 +1513,12 @@ vty_describe_command (struct vty *vty)
   switch (ret)
     {
     case CMD_ERR_AMBIGUOUS:
-      cmd_free_strvec (vline);
       vty_out (vty, "%% Ambiguous command.%s", VTY_NEWLINE);
       vty_prompt (vty);
       vty_redraw_line (vty);
       return;
       break;
     case CMD_ERR_NO_MATCH:
-      cmd_free_strvec (vline);
       vty_out (vty, "%% There is no matched command.%s", VTY_NEWLINE);
       vty_prompt (vty);
       vty_redraw_line (vty);
@@ -986,7 +1592,6 @@ vty_describe_command (struct vty *vty)
     vty_describe_fold (vty, width, desc_width, desc);
     }
 
-  cmd_free_strvec (vline);
   vector_free (describe);
 
   vty_prompt (vty);
@@ -1049,9 +1654,8 @@ vty_hist_add (struct vty *vty)
       }
 
   /* Insert history entry. */
-  if (vty->hist[vty->hindex])
-    XFREE (MTYPE_VTY_HIST, vty->hist[vty->hindex]);
-  vty->hist[vty->hindex] = XSTRDUP (MTYPE_VTY_HIST, vty->buf);
+  intern_unref (vty->hist[vty->hindex]);
+  vty->hist[vty->hindex] = intern (vty->buf);
 
   /* History index rotation. */
   vty->hindex++;
@@ -1183,14 +1787,46 @@ vty_execute (struct vty *vty)
   vty->cp = vty->length = 0;
   vty_clear_buf (vty);
 
+  /* The prompt follows the output of a queued command. */
   if (vty->status != VTY_CLOSE 
       && vty->status != VTY_START
-      && vty->status != VTY_CONTINUE)
+      && vty->status != VTY_CONTINUE
+      && ret != CMD_QUEUED)
     vty_prompt (vty);
 
   return ret;
 }
 
+/* Output of the command VTY has queued on the worker pool.  DONE is
+   set on the last piece. */
+void
+vty_worker_output (struct vty *vty, struct buffer *obuf, int done)
+{
+  buffer_splice (vty->obuf, obuf);
+
+  if (done)
+    {
+      unsigned char *ibuf = vty->ibuf;
+
+      vty->job = NULL;
+      if (vty->status != VTY_CLOSE)
+        vty_prompt (vty);
+
+      /* Carry on with what has been typed meanwhile. */
+      if (ibuf)
+        {
+          int len = vty->ibuf_len;
+
+          vty->ibuf = NULL;
+          vty->ibuf_len = 0;
+          vty_input (vty, ibuf, len);
+          XFREE (MTYPE_VTY, ibuf);
+        }
+    }
+
+  vty_event (VTY_WRITE, vty->fd, vty);
+}
+
 #define CONTROL(X)  ((X) - '@')
 #define VTY_NORMAL     0
 #define VTY_PRE_ESCAPE 1
@@ -1235,20 +1871,40 @@ vty_buffer_reset (struct vty *vty)
 static int
 vty_read (struct vty *vty)
 {
-  int i;
-  int ret;
   int nbytes;
   unsigned char buf[VTY_READ_BUFSIZ];
 
   int vty_sock = vty->fd;
   
   /* Read raw data from socket */
-  nbytes = read (vty->fd, buf, VTY_READ_BUFSIZ);
+  nbytes = io_read (vty->fd, buf, VTY_READ_BUFSIZ);
   if (nbytes <= 0)
     vty->status = VTY_CLOSE;
 
+  vty_input (vty, buf, nbytes);
+  return 0;
+}
+
+/* Process NBYTES of input from the vty. */
+static void
+vty_input (struct vty *vty, unsigned char *buf, int nbytes)
+{
+  int i;
+  int ret;
+  int vty_sock = vty->fd;
+
   for (i = 0; i < nbytes; i++) 
     {
+      /* Keep type-ahead until the queued command has finished. */
+      if (vty->job)
+    {
+      vty->ibuf = XREALLOC (MTYPE_VTY, vty->ibuf,
+                            vty->ibuf_len + nbytes - i);
+      memcpy (vty->ibuf + vty->ibuf_len, buf + i, nbytes - i);
+      vty->ibuf_len += nbytes - i;
+      break;
+    }
+
       if (buf[i] == IAC)
     {
       if (!vty->iac)
@@ -1426,7 +2082,6 @@ vty_read (struct vty *vty)
         vty_event (VTY_WRITE, vty_sock, vty);
         vty_event (VTY_READ, vty_sock, vty);
     }
-  return 0;
 }
 
 /* Flush buffer to the vty. */
@@ -1517,30 +2172,32 @@ vty_flush (struct vty *vty)
         //vty_event (VTY_READ, vty_sock, vty);
         }
     }
-      else
+      else if (vty->lines == 0)
     {
-      vty->status = VTY_MORE;
-
-     // if (vty->lines == 0)
-      //  vty_event (VTY_WRITE, vty_sock, vty);
+      /* No pager, the main loop goes on flushing. */
+      vty->status = VTY_NORMAL;
     }
+      else
+    vty->status = VTY_MORE;
     }
 
   return 0;
 }
 
-/* Create new vty structure. */
-struct vty *
-vty_create (int vty_sock)
+/* Create new vty structure.  Sessions over a unix socket are local,
+   they don't log in and don't speak telnet. */
+static struct vty *
+vty_create (int vty_sock, int family)
 {
   struct vty *vty;
+  int telnet = (family != AF_UNIX);
 
   /* Allocate new vty structure and set up default values. */
   vty = vty_new ();
   vty->fd = vty_sock;
   vty->type = VTY_TERM;
  
-  if (no_password_check)
+  if (no_password_check || ! telnet)
     {
       if (host.advanced)
     vty->node = ENABLE_NODE;
@@ -1556,7 +2213,9 @@ vty_create (int vty_sock)
   memset (vty->hist, 0, sizeof (vty->hist));
   vty->hp = 0;
   vty->hindex = 0;
+  pthread_mutex_lock (&vty_log_mtx);
   vector_set_index (vtyvec, vty_sock, vty);
+  pthread_mutex_unlock (&vty_log_mtx);
   vty->status = VTY_NORMAL;
   vty->v_timeout = vty_timeout_val;
   if (host.lines >= 0)
@@ -1567,7 +2226,7 @@ vty_create (int vty_sock)
   vty->iac_sb_in_progress = 0;
   vty->sb_buffer = buffer_new (1024);
 
-  if (! no_password_check)
+  if (! no_password_check && telnet)
     {
       /* Vty is not available if password isn't set. */
       if (host.password == NULL && host.password_encrypt == NULL)
@@ -1581,15 +2240,18 @@ vty_create (int vty_sock)
 
   /* Say hello to the world. */
   vty_hello (vty);
-  if (! no_password_check)
+  if (! no_password_check && telnet)
     vty_out (vty, "%sUser Access Verification%s%s", VTY_NEWLINE, VTY_NEWLINE, VTY_NEWLINE);
 
   /* Setting up terminal. */
-  vty_will_echo (vty);
-  vty_will_suppress_go_ahead (vty);
+  if (telnet)
+    {
+      vty_will_echo (vty);
+      vty_will_suppress_go_ahead (vty);
 
-  vty_dont_linemode (vty);
-  vty_do_window_size (vty);
+      vty_dont_linemode (vty);
+      vty_do_window_size (vty);
+    }
   /* vty_dont_lflow_ahead (vty); */
 
   vty_prompt (vty);
@@ -1620,6 +2282,10 @@ vty_close (struct vty *vty)
     thread_cancel (vty->t_output);
 #endif
 
+  /* Output of a queued command has nowhere to go. */
+  worker_cancel (vty);
+  vty_log_close (vty);
+
   /* Flush buffer. */
   if (! buffer_empty (vty->obuf))
     buffer_flush_all (vty->obuf, vty->fd);
@@ -1633,13 +2299,20 @@ vty_close (struct vty *vty)
 
   /* Free command history. */
   for (i = 0; i < VTY_MAXHIST; i++)
-    if (vty->hist[i])
-      XFREE (MTYPE_VTY_HIST, vty->hist[i]);
+    intern_unref (vty->hist[i]);
+
+  arena_fini (&vty->arena);
 
-  /* Unset vector. */
+  if (vty->ifrange)
+    XFREE (MTYPE_VTY, vty->ifrange);
+
+  /* Unset vector, vty_log () may be walking it. */
+  pthread_mutex_lock (&vty_log_mtx);
   vector_unset (vtyvec, vty->fd);
+  pthread_mutex_unlock (&vty_log_mtx);
 
   /* Close socket. */
+  io_del (vty->fd);
   if (vty->fd > 0)
     close (vty->fd);
 
@@ -1647,6 +2320,8 @@ vty_close (struct vty *vty)
     XFREE (0, vty->address);
   if (vty->buf)
     XFREE (MTYPE_VTY, vty->buf);
+  if (vty->ibuf)
+    XFREE (MTYPE_VTY, vty->ibuf);
 
   /* Check configure. */
   vty_config_unlock (vty);
@@ -1853,17 +2528,47 @@ vty_read_config (char *config_file,
   host_config_set (fullpath);
 }
 
-/* Small utility function which output log to the VTY. */
+/* Small utility function which output log to the VTY.  The record is
+   formatted once and shared by all monitoring vtys, they pick it up
+   with vty_log_flush (). */
 void
 vty_log (const char *proto_str, const char *format, va_list va)
 {
   int i;
+  int len;
   struct vty *vty;
+  struct vty_log_rec *rec;
+  char time_buf[TIME_BUF];
+  char buf[1024];
 
-  for (i = 0; i < vector_max (vtyvec); i++)
-    if ((vty = vector_slot (vtyvec, i)) != NULL)
+  if (vtyvec == NULL)
+    return;
+
+  if (time_str (time_buf) == 0)
+    time_buf[0] = '\0';
+  len = snprintf (buf, sizeof buf, "%s%s%s: ", time_buf,
+                  time_buf[0] ? " " : "", proto_str);
+  if (len < 0 || len >= sizeof buf)
+    return;
+  i = vsnprintf (buf + len, sizeof buf - len, format, va);
+  if (i < 0)
+    return;
+  len += i;
+  if (len >= sizeof buf)
+    len = sizeof buf - 1;
+
+  rec = XMALLOC (MTYPE_VTY_LOG, sizeof (struct vty_log_rec) + len);
+  rec->refcnt = 1;
+  rec->len = len;
+  memcpy (rec->msg, buf, len + 1);
+
+  pthread_mutex_lock (&vty_log_mtx);
+  vector_foreach (vtyvec, i, vty)
       if (vty->monitor)
-    vty_log_out (vty, proto_str, format, va);
+        vty_log_enqueue (vty, rec);
+  pthread_mutex_unlock (&vty_log_mtx);
+
+  vty_log_unref (rec);
 }
 
 int
@@ -1890,17 +2595,13 @@ vty_config_unlock (struct vty *vty)
 
 
 
+/* Input is governed by the main loop, only output needs a note. */
 void vty_event(enum event event, int sock, struct vty *vty)
 {
-    int fd = vty->fd;
-
     switch (event)
     {
-    case VTY_READ:
-        FD_SET(fd, &vty->read_set);
-        break;
     case VTY_WRITE:
-        FD_SET(fd, &vty->write_set);
+        vty->write_event = 1;
         break;
     default:
         break;
@@ -1917,8 +2618,7 @@ DEFUN (config_who,
   int i;
   struct vty *v;
 
-  for (i = 0; i < vector_max (vtyvec); i++)
-    if ((v = vector_slot (vtyvec, i)) != NULL)
+  vector_foreach (vtyvec, i, v)
       vty_out (vty, "%svty[%d] connected from %s.%s",
            v->config ? "*" : " ",
            i, v->address, VTY_NEWLINE);
@@ -2083,7 +2783,7 @@ DEFUN (terminal_no_monitor,
        NO_STR
        "Copy debug output to the current terminal line\n")
 {
-  vty->monitor = 0;
+  vty_log_close (vty);
   return CMD_SUCCESS;
 }
 
@@ -2167,7 +2867,8 @@ vty_reset ()
     if ((vty_serv_thread = vector_slot (Vvty_serv_thread, i)) != NULL)
       {
     //thread_cancel (vty_serv_thread);
-    vector_slot (Vvty_serv_thread, i) = NULL;
+    vector_unset (Vvty_serv_thread, i);
+        io_del (i);
         close (i);
       }
 
@@ -2207,7 +2908,8 @@ vty_finish ()
     if ((vty_serv_thread = vector_slot (Vvty_serv_thread, i)) != NULL)
       {
     //thread_cancel (vty_serv_thread);
-    vector_slot (Vvty_serv_thread, i) = NULL;
+    vector_unset (Vvty_serv_thread, i);
+        io_del (i);
         close (i);
       }
 
@@ -2310,14 +3012,219 @@ time_t sysGetUpTime()
     return info.uptime;
 }
 
+/* Address family of the listening sockets, kept in Vvty_serv_thread. */
+static int vty_serv_inet = AF_INET;
+static int vty_serv_unix = AF_UNIX;
+
+/* Watch listening socket SOCK of FAMILY. */
+static void
+vty_serv_add (int sock, int *family)
+{
+  fcntl (sock, F_SETFL, fcntl (sock, F_GETFL) | O_NONBLOCK);
+  vector_set_index (Vvty_serv_thread, sock, family);
+  io_add (sock, 0);
+}
+
+/* Accept the pending connections on listening socket SOCK. */
+static void
+vty_accept (int sock, int family)
+{
+  int vty_sock;
+  struct vty *vty;
+  union
+  {
+    struct sockaddr sa;
+    struct sockaddr_in sin;
+#ifdef HAVE_IPV6
+    struct sockaddr_in6 sin6;
+#endif /* HAVE_IPV6 */
+    struct sockaddr_un sun;
+  } su;
+  socklen_t len;
+  char buf[INET6_ADDRSTRLEN];
+
+  while (1)
+    {
+      len = sizeof su;
+      vty_sock = accept (sock, &su.sa, &len);
+      if (vty_sock < 0)
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            zlog_warn ("can't accept vty socket : %s", strerror (errno));
+          return;
+        }
+
+      if (family != AF_UNIX)
+        {
+          int on = 1;
+
+          setsockopt (vty_sock, IPPROTO_TCP, TCP_NODELAY,
+                      (char *) &on, sizeof (on));
+        }
+      fcntl (vty_sock, F_SETFL, fcntl (vty_sock, F_GETFL) | O_NONBLOCK);
+
+      vty = vty_create (vty_sock, family);
+      if (vty == NULL)
+        continue;
+
+      if (su.sa.sa_family == AF_INET)
+        inet_ntop (AF_INET, &su.sin.sin_addr, buf, sizeof buf);
+#ifdef HAVE_IPV6
+      else if (su.sa.sa_family == AF_INET6)
+        inet_ntop (AF_INET6, &su.sin6.sin6_addr, buf, sizeof buf);
+#endif /* HAVE_IPV6 */
+      else
+        strcpy (buf, "unix");
+      vty->address = XSTRDUP (0, buf);
+      vty->expire = sysGetUpTime ();
+
+      io_add (vty_sock, 1);
+    }
+}
+
+/* Make vty server sockets for ADDR and PORT. */
+static void
+vty_serv_sock_addrinfo (const char *hostname, unsigned short port)
+{
+  int ret;
+  struct addrinfo req;
+  struct addrinfo *ainfo;
+  struct addrinfo *ainfo_save;
+  int sock;
+  char port_str[BUFSIZ];
+
+  memset (&req, 0, sizeof (struct addrinfo));
+  req.ai_flags = AI_PASSIVE;
+  req.ai_family = AF_UNSPEC;
+  req.ai_socktype = SOCK_STREAM;
+  sprintf (port_str, "%d", port);
+  port_str[sizeof (port_str) - 1] = '\0';
+
+  ret = getaddrinfo (hostname, port_str, &req, &ainfo);
+  if (ret != 0)
+    {
+      fprintf (stderr, "getaddrinfo failed: %s\n", gai_strerror (ret));
+      return;
+    }
+
+  ainfo_save = ainfo;
+
+  do
+    {
+      int on = 1;
+
+      if (ainfo->ai_family != AF_INET
+#ifdef HAVE_IPV6
+          && ainfo->ai_family != AF_INET6
+#endif /* HAVE_IPV6 */
+          )
+        continue;
+
+      sock = socket (ainfo->ai_family, ainfo->ai_socktype, ainfo->ai_protocol);
+      if (sock < 0)
+        continue;
+
+      setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, (char *) &on, sizeof (on));
+#ifdef IPV6_V6ONLY
+      if (ainfo->ai_family == AF_INET6)
+        setsockopt (sock, IPPROTO_IPV6, IPV6_V6ONLY, (char *) &on, sizeof (on));
+#endif /* IPV6_V6ONLY */
+
+      ret = bind (sock, ainfo->ai_addr, ainfo->ai_addrlen);
+      if (ret < 0)
+        {
+          close (sock);
+          continue;
+        }
+
+      ret = listen (sock, 3);
+      if (ret < 0)
+        {
+          close (sock);
+          continue;
+        }
+
+      vty_serv_add (sock, &vty_serv_inet);
+    }
+  while ((ainfo = ainfo->ai_next) != NULL);
+
+  freeaddrinfo (ainfo_save);
+}
+
+/* Make a vty server socket on unix domain socket PATH. */
+static void
+vty_serv_un (const char *path)
+{
+  int ret;
+  int sock, len;
+  struct sockaddr_un serv;
+  mode_t old_mask;
+
+  /* First of all, unlink existing socket */
+  unlink (path);
+
+  /* Set umask */
+  old_mask = umask (0077);
+
+  /* Make UNIX domain socket. */
+  sock = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0)
+    {
+      zlog_err ("Cannot create unix stream socket: %s", strerror (errno));
+      umask (old_mask);
+      return;
+    }
+
+  /* Make server socket. */
+  memset (&serv, 0, sizeof (struct sockaddr_un));
+  serv.sun_family = AF_UNIX;
+  strncpy (serv.sun_path, path, sizeof (serv.sun_path) - 1);
+  len = sizeof (serv.sun_family) + strlen (serv.sun_path);
+
+  ret = bind (sock, (struct sockaddr *) &serv, len);
+  if (ret < 0)
+    {
+      zlog_err ("Cannot bind path %s: %s", path, strerror (errno));
+      close (sock);
+      umask (old_mask);
+      return;
+    }
+
+  ret = listen (sock, 5);
+  if (ret < 0)
+    {
+      zlog_err ("listen(fd %d) failed: %s", sock, strerror (errno));
+      close (sock);
+      umask (old_mask);
+      return;
+    }
+
+  umask (old_mask);
+
+  vty_serv_add (sock, &vty_serv_unix);
+}
+
+/* Determine address family to bind. */
+void
+vty_serv_sock (const char *addr, unsigned short port, char *path)
+{
+  if (port)
+    vty_serv_sock_addrinfo (addr, port);
+
+  if (path)
+    vty_serv_un (path);
+}
+
 extern struct vty *vty;
 #define CONSOLE_NAME    "/dev/tty"
 
 void vty_main_loop()
 {   
-    struct timeval timer_now;
-    struct timeval *timer_wait;
-    int fd,ret,match=0;
+    struct io_event ev[IO_EVENTS_MAX];
+    struct vty *v;
+    int *family;
+    int fd,wfd,efd,i,n;
+    time_t now;
     struct termios termios_save;
     struct termios new_term;
 
@@ -2335,6 +3242,9 @@ void vty_main_loop()
         return ;
     }
     vty->fd = fd;
+    pthread_mutex_lock (&vty_log_mtx);
+    vector_set_index (vtyvec, fd, vty);
+    pthread_mutex_unlock (&vty_log_mtx);
     
     tcgetattr(fd, &termios_save);
     new_term = termios_save;
@@ -2343,36 +3253,85 @@ void vty_main_loop()
 
     tcsetattr(fd, TCSANOW, &new_term);
 
+    io_add(fd, 0);
+    wfd = worker_fd();
+    if(wfd >= 0)
+        io_add(wfd, 0);
+    efd = ifevent_fd();
+    if(efd >= 0)
+        io_add(efd, 0);
     
     while(1)
     {       
-        timer_wait= &timer_now;
-        timer_now.tv_sec = 1;
-        timer_now.tv_usec = 0;
-        FD_ZERO(&vty->read_set);
-        FD_ZERO(&vty->write_set);
-        FD_SET(vty->fd,&vty->read_set);
-        
-        ret=select(vty->fd + 1,&vty->read_set,&vty->write_set,NULL,timer_wait);
-        if (ret <= 0)
-        {
-            continue;
-        }
-        
-        if(FD_ISSET(fd,&vty->read_set))
-        {
-            vty_read (vty);
-            vty->expire=sysGetUpTime();
-        }
-        if(FD_ISSET(fd,&vty->write_set))
+        now = sysGetUpTime();
+        memory_sample();
+        if_counters_sample();
+
+        /* Settle every session before waiting. */
+        vector_foreach(vtyvec, i, v)
         {
-            vty_flush (vty);
+            vty_log_flush(v);
+
+            /* Input waits until a queued command has finished. */
+            io_enable(v->fd, v->job == NULL);
+
+            if(v->write_event
+               || (v->status != VTY_MORE && ! buffer_empty(v->obuf)))
+            {
+                v->write_event = 0;
+                vty_flush(v);
+            }
+
+            if(v != vty && v->v_timeout && v->job == NULL
+               && v->status != VTY_CLOSE
+               && now - v->expire >= (time_t) v->v_timeout)
+                vty_timeout(v);
+
+            if(v->status == VTY_CLOSE && v != vty)
+                vty_close(v);
         }
-        
         if(vty->status == VTY_CLOSE)
             break;
+
+        /* Wake up in time for a batch of interface events. */
+        n = io_wait(ev, IO_EVENTS_MAX, ifevent_timeout(1000));
+
+        for(i = 0; i < n; i++)
+        {
+            if(ev[i].fd == wfd)
+            {
+                worker_process();
+            }
+            else if(ev[i].fd == efd)
+            {
+                /* Read by ifevent_run() below. */
+            }
+            else if(ev[i].fd == ifnl_fd())
+            {
+                ifnl_read();
+            }
+            else if(ev[i].fd < vector_max(Vvty_serv_thread)
+                    && (family = vector_slot(Vvty_serv_thread, ev[i].fd)))
+            {
+                vty_accept(ev[i].fd, *family);
+            }
+            else if(ev[i].fd < vector_max(vtyvec)
+                    && (v = vector_slot(vtyvec, ev[i].fd)))
+            {
+                if(ev[i].data == NULL)
+                    vty_read(v);
+                else if(ev[i].len <= 0)
+                    v->status = VTY_CLOSE;
+                else
+                    vty_input(v, ev[i].data, ev[i].len);
+                v->expire = now;
+            }
+            io_done(&ev[i]);
+        }
+        ifevent_run();
     }
     
+    io_del(fd);
     tcsetattr(fd, TCSAFLUSH, &termios_save);
     vty_close(vty);
     return;
@@ -26,9 +26,12 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include <unistd.h>
 #include <sys/select.h>
 
+#include "arena.h"
+
 
 #define VTY_BUFSIZ 512
 #define VTY_MAXHIST 20
+#define VTY_LOG_RING 64
 
 /* VTY struct. */
 struct vty 
@@ -79,6 +82,11 @@ struct vty
   int outputDelay;
   int ifindex;
 
+  /* The interfaces of an interface range, a bit per ifindex below
+     IFRANGE_SIZE, or NULL while IFINDEX is configured alone. */
+  unsigned long *ifrange;
+  unsigned int ifrange_size;
+
   /* For current referencing point of interface, route-map,
      access-list etc... */
   void *index;
@@ -113,8 +121,12 @@ struct vty
   /* Current executing function pointer. */
   int (*func) (struct vty *, void *arg);
 
-  /* Terminal monitor. */
+  /* Terminal monitor and its queue of log records. */
   int monitor;
+  struct vty_log_rec **log_ring;
+  unsigned int log_head;
+  unsigned int log_tail;
+  unsigned long log_dropped;
 
   /* In configure mode. */
   int config;
@@ -122,9 +134,8 @@ struct vty
   /* Timeout seconds and thread. */
   unsigned long v_timeout;
 
-    fd_set read_set;
-    fd_set write_set;
-    fd_set except_set;
+  /* Output waits to be flushed by the main loop. */
+  int write_event;
 
   /* Output data pointer. */
   int (*output_func) (struct vty *, int);
@@ -133,6 +144,27 @@ struct vty
   unsigned long output_count;
   int output_type;
   void *output_arg;
+
+  /* Structured output of the running command: JSON flag, nesting
+     level and a bit per level telling a member has been written. */
+  int json;
+  unsigned int json_level;
+  unsigned long json_sep;
+
+  /* Output filter ("| include REGEX") of the running command. */
+  struct vty_filter *filter;
+
+  /* Command of this vty running on the worker pool, and input which
+     arrived after it. */
+  struct worker_job *job;
+  unsigned char *ibuf;
+  int ibuf_len;
+
+  /* Set on the private vty a worker renders into. */
+  struct worker_job *worker_job;
+
+  /* Scratch memory of the running command, reset when it's done. */
+  struct arena arena;
 };
 
 /* Integrated configuration file. */
@@ -197,16 +229,31 @@ void vty_reset (void);
 void vty_finish (void);
 struct vty *vty_new (void);
 int vty_out (struct vty *, const char *, ...) PRINTF_ATTRIBUTE(2, 3);
+void vty_writev (struct vty *, const struct iovec *, int);
 void vty_read_config (char *, char *, char *);
 void vty_time_print (struct vty *, int);
 void vty_serv_sock (const char *, unsigned short, char *);
 void vty_close (struct vty *);
 char *vty_get_cwd (void);
 void vty_log (const char *, const char *, va_list);
+void vty_log_flush (struct vty *);
 int vty_config_lock (struct vty *);
 int vty_config_unlock (struct vty *);
 int vty_shell (struct vty *);
 int vty_shell_serv (struct vty *);
 void vty_hello (struct vty *);
+void vty_output_finish (struct vty *, int);
+void vty_worker_output (struct vty *, struct buffer *, int);
+
+/* Field-level output for show commands. */
+void vty_object_begin (struct vty *, const char *);
+void vty_object_end (struct vty *);
+void vty_array_begin (struct vty *, const char *);
+void vty_array_end (struct vty *);
+void vty_row_begin (struct vty *);
+void vty_row_end (struct vty *);
+void vty_field_label (struct vty *, int, const char *);
+void vty_field_str (struct vty *, const char *, int, const char *);
+void vty_field_int (struct vty *, const char *, int, long);
 
 #endif /* _ZEBRA_VTY_H */
@@ -200,6 +200,7 @@ void vtysh_init_vty ()
     install_element (ENABLE_NODE, &vtysh_start_shell_cmd);
     install_element (ENABLE_NODE, &vtysh_start_bash_cmd);
     install_element (ENABLE_NODE, &vtysh_start_zsh_cmd);
-   nm_if_init();
+    memory_init ();
+    nm_if_init();
 
 }
@@ -27,9 +27,12 @@
 #include <pwd.h>
 #include "getopt.h"
 #include "command.h"
+#include "log.h"
 
 #include "vtysh.h"
 #include "vtysh_user.h"
+#include "worker.h"
+#include "ioloop.h"
 
 /* VTY shell program name. */
 char *progname;
@@ -109,6 +112,10 @@ redistribution between different routing protocols.\n\n\
 -b, --boot               Execute boot startup configuration\n\
 -e, --eval               Execute argument as command\n\
 -h, --help               Display this help and exit\n\
+-A, --vty_addr           Set vty's bind address\n\
+-P, --vty_port           Set vty's port number, none by default\n\
+-S, --vty_socket         Set vty's unix socket path, none by default\n\
+-I, --io                 I/O backend: io_uring, epoll or select\n\
 \n", progname);
     }
     exit (status);
@@ -120,6 +127,10 @@ struct option longopts[] =
     { "boot",                no_argument,             NULL, 'b'},
     { "eval",                 required_argument,       NULL, 'e'},
     { "help",                 no_argument,             NULL, 'h'},
+    { "vty_addr",             required_argument,       NULL, 'A'},
+    { "vty_port",             required_argument,       NULL, 'P'},
+    { "vty_socket",           required_argument,       NULL, 'S'},
+    { "io",                   required_argument,       NULL, 'I'},
     { 0 }
 };
 
@@ -134,15 +145,19 @@ int main (int argc, char **argv, char **env)
     int boot_flag = 0;
     char *eval_line = NULL;
     char *integrated_file = NULL;
+    char *vty_addr = NULL;
+    int vty_port = 0;
+    char *vty_sock_path = NULL;
+    char *io_backend = NULL;
 
     /* Preserve name of myself. */
     progname = ((p = strrchr (argv[0], '/')) ? ++p : argv[0]);
-    //zlog_default = openzlog (progname, ZLOG_STDOUT, ZLOG_ZEBRA,LOG_CONS|LOG_NDELAY|LOG_PID, LOG_DAEMON);
+    zlog_default = openzlog (progname, ZLOG_NOLOG, ZLOG_ZEBRA,LOG_CONS|LOG_NDELAY|LOG_PID, LOG_DAEMON);
 
     /* Option handling. */
     while (1) 
     {
-        opt = getopt_long (argc, argv, "be:h", longopts, 0);
+        opt = getopt_long (argc, argv, "be:hA:P:S:I:", longopts, 0);
 
         if (opt == EOF)
         break;
@@ -161,6 +176,20 @@ int main (int argc, char **argv, char **env)
             case 'h':
                 usage (0);
                 break;
+            case 'A':
+                vty_addr = optarg;
+                break;
+            case 'P':
+                vty_port = atoi (optarg);
+                if (vty_port <= 0 || vty_port > 0xffff)
+                    usage (1);
+                break;
+            case 'S':
+                vty_sock_path = optarg;
+                break;
+            case 'I':
+                io_backend = optarg;
+                break;
             case 'i':
                 integrated_file = strdup (optarg);
             default:
@@ -179,10 +208,23 @@ int main (int argc, char **argv, char **env)
     vtysh_user_init ();
 
 
-    vty_init_vtysh ();
+    vty_init ();
+    io_cmd_init ();
 
     sort_node ();
 
+    worker_init (WORKER_THREADS_DEFAULT);
+
+    if (io_init (io_backend) < 0)
+    {
+        fprintf (stderr, "%s: no I/O backend available\n", progname);
+        exit (1);
+    }
+
+    /* Remote sessions only when asked for. */
+    if (vty_port || vty_sock_path)
+        vty_serv_sock (vty_addr, vty_port, vty_sock_path);
+
 
 
     vty_hello (vty);
@@ -21,20 +21,40 @@
 
 #include <common.h>
 
+#include <stddef.h>
 #include <pwd.h>
 
 #include "memory.h"
 #include "linklist.h"
+#include "hash.h"
 #include "command.h"
 
 
 struct user
 {
+  struct dlink link;
   char *name;
   u_char nopassword;
 };
 
-struct list *userlist;
+struct dlist userlist;
+
+/* Users by name. */
+static struct hash *userhash;
+
+static unsigned int
+user_hash_key (void *data)
+{
+  struct user *user = data;
+
+  return hash_string (user->name);
+}
+
+static int
+user_hash_cmp (void *a, void *b)
+{
+  return strcmp (((struct user *) a)->name, ((struct user *) b)->name) == 0;
+}
 
 struct user *
 user_new ()
@@ -54,24 +74,19 @@ user_free (struct user *user)
 struct user *
 user_lookup (char *name)
 {
-  struct listnode *nn;
-  struct user *user;
+  struct user key;
 
-  LIST_LOOP (userlist, user, nn)
-    {
-      if (strcmp (user->name, name) == 0)
-	return user;
-    }
-  return NULL;
+  key.name = name;
+  return hash_lookup (userhash, &key);
 }
 
 void
 user_config_write ()
 {
-  struct listnode *nn;
+  struct dlink *nn;
   struct user *user;
 
-  LIST_LOOP (userlist, user, nn)
+  DLIST_LOOP (&userlist, user, nn, struct user, link)
     {
       if (user->nopassword)
 	printf (" username %s nopassword\n", user->name);
@@ -88,7 +103,8 @@ user_get (char *name)
 
   user = user_new ();
   user->name = strdup (name);
-  listnode_add (userlist, user);
+  DLIST_ADD_TAIL (&userlist, &user->link);
+  hash_get (userhash, user, hash_alloc_intern);
 
   return user;
 }
@@ -126,6 +142,7 @@ vtysh_auth ()
 void
 vtysh_user_init ()
 {
-  userlist = list_new ();
+  DLIST_INIT (&userlist);
+  userhash = hash_create (user_hash_key, user_hash_cmp);
   install_element (CONFIG_NODE, &username_nopassword_cmd);
 }
@@ -0,0 +1,290 @@
+/* Worker thread pool for read-only commands.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <common.h>
+
+#include <pthread.h>
+
+#include "memory.h"
+#include "buffer.h"
+#include "command.h"
+#include "vty.h"
+#include "log.h"
+#include "worker.h"
+
+/* A command handed over to the pool.  OWNER is only looked at by the
+   main thread, the worker renders into its private VTY. */
+struct worker_job
+{
+  struct worker_job *next;
+
+  struct cmd_element *cmd;
+  int argc;
+  char *argv[CMD_ARGC_MAX];
+
+  struct vty *owner;
+  struct vty *vty;
+  int ret;
+};
+
+/* A piece of rendered output on its way back to the main thread. */
+struct worker_msg
+{
+  struct worker_msg *next;
+  struct worker_job *job;
+  struct buffer *obuf;
+  int done;
+};
+
+/* Jobs waiting for a worker. */
+static pthread_mutex_t worker_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_cond = PTHREAD_COND_INITIALIZER;
+static struct worker_job *worker_head;
+static struct worker_job *worker_tail;
+
+/* Finished output, a lock-free stack pushed by the workers and taken
+   as a whole by the main thread. */
+static struct worker_msg *worker_done;
+
+/* Wakes up the main loop when output is available. */
+static int worker_pipe[2] = { -1, -1 };
+
+static int worker_count;
+
+/* Serializes state changing commands against snapshots taken by the
+   read-only ones. */
+static pthread_mutex_t worker_state_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+void
+worker_state_lock (void)
+{
+  pthread_mutex_lock (&worker_state_mtx);
+}
+
+void
+worker_state_unlock (void)
+{
+  pthread_mutex_unlock (&worker_state_mtx);
+}
+
+/* Give a message to the main thread. */
+static void
+worker_post (struct worker_job *job, struct buffer *obuf, int done)
+{
+  struct worker_msg *msg;
+  char c = 0;
+
+  msg = XCALLOC (MTYPE_THREAD, sizeof (struct worker_msg));
+  msg->job = job;
+  msg->obuf = obuf;
+  msg->done = done;
+
+  msg->next = __atomic_load_n (&worker_done, __ATOMIC_RELAXED);
+  while (! __atomic_compare_exchange_n (&worker_done, &msg->next, msg, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+
+  write (worker_pipe[1], &c, 1);
+}
+
+/* Called from vty output of a worker's private vty, pass what has
+   been rendered so far on to the owner. */
+void
+worker_flush (struct vty *vty)
+{
+  struct buffer *obuf = vty->obuf;
+
+  if (buffer_empty (obuf))
+    return;
+
+  vty->obuf = buffer_new (obuf->size);
+  worker_post (vty->worker_job, obuf, 0);
+}
+
+static void
+worker_run (struct worker_job *job)
+{
+  struct vty *vty = job->vty;
+  int i;
+
+  job->ret = (*job->cmd->func) (job->cmd, vty, job->argc, job->argv);
+  vty_output_finish (vty, job->ret);
+
+  for (i = 0; i < job->argc; i++)
+    XFREE (MTYPE_TMP, job->argv[i]);
+
+  job->vty = NULL;
+  worker_post (job, vty->obuf, 1);
+  arena_fini (&vty->arena);
+  XFREE (MTYPE_VTY, vty);
+}
+
+static void *
+worker_thread (void *arg)
+{
+  struct worker_job *job;
+
+  while (1)
+    {
+      pthread_mutex_lock (&worker_mtx);
+      while (worker_head == NULL)
+        pthread_cond_wait (&worker_cond, &worker_mtx);
+      job = worker_head;
+      worker_head = job->next;
+      if (worker_head == NULL)
+        worker_tail = NULL;
+      pthread_mutex_unlock (&worker_mtx);
+
+      worker_run (job);
+    }
+  return NULL;
+}
+
+/* Queue CMD for execution on the pool.  The command renders into a
+   private vty which takes over the output settings of VTY.  Returns 0
+   when the command has been queued, -1 when it must be run in place. */
+int
+worker_execute (struct cmd_element *cmd, struct vty *vty, int argc,
+                char **argv)
+{
+  struct worker_job *job;
+  struct vty *wvty;
+  int i;
+
+  if (worker_count == 0 || vty->type != VTY_TERM || vty->job)
+    return -1;
+
+  job = XCALLOC (MTYPE_THREAD, sizeof (struct worker_job));
+  job->cmd = cmd;
+  job->argc = argc;
+  for (i = 0; i < argc; i++)
+    job->argv[i] = XSTRDUP (MTYPE_TMP, argv[i]);
+  job->owner = vty;
+
+  wvty = XCALLOC (MTYPE_VTY, sizeof (struct vty));
+  wvty->fd = -1;
+  wvty->type = vty->type;
+  wvty->node = vty->node;
+  wvty->privilege = vty->privilege;
+  wvty->width = vty->width;
+  wvty->height = vty->height;
+  wvty->lines = vty->lines;
+  wvty->obuf = buffer_new (vty->obuf->size);
+  wvty->json = vty->json;
+  wvty->filter = vty->filter;
+  wvty->worker_job = job;
+  vty->filter = NULL;
+  job->vty = wvty;
+
+  vty->job = job;
+
+  pthread_mutex_lock (&worker_mtx);
+  if (worker_tail)
+    worker_tail->next = job;
+  else
+    worker_head = job;
+  worker_tail = job;
+  pthread_cond_signal (&worker_cond);
+  pthread_mutex_unlock (&worker_mtx);
+
+  return 0;
+}
+
+/* Main thread: move finished output to the owning vtys. */
+void
+worker_process (void)
+{
+  struct worker_msg *msg;
+  struct worker_msg *next;
+  struct worker_msg *list;
+  char buf[64];
+
+  while (read (worker_pipe[0], buf, sizeof buf) > 0)
+    ;
+
+  msg = __atomic_exchange_n (&worker_done, NULL, __ATOMIC_ACQUIRE);
+
+  /* The stack hands messages out newest first. */
+  for (list = NULL; msg; msg = next)
+    {
+      next = msg->next;
+      msg->next = list;
+      list = msg;
+    }
+
+  for (msg = list; msg; msg = next)
+    {
+      next = msg->next;
+
+      if (msg->job->owner)
+        vty_worker_output (msg->job->owner, msg->obuf, msg->done);
+      buffer_free (msg->obuf);
+
+      if (msg->done)
+        XFREE (MTYPE_THREAD, msg->job);
+      XFREE (MTYPE_THREAD, msg);
+    }
+}
+
+/* VTY is going away, drop the output of its running command. */
+void
+worker_cancel (struct vty *vty)
+{
+  if (vty->job)
+    {
+      vty->job->owner = NULL;
+      vty->job = NULL;
+    }
+}
+
+/* Descriptor which becomes readable when worker_process () has got
+   something to do, -1 when there is no pool. */
+int
+worker_fd (void)
+{
+  return worker_count ? worker_pipe[0] : -1;
+}
+
+/* Start COUNT worker threads. */
+void
+worker_init (int count)
+{
+  pthread_t tid;
+  int i;
+
+  if (pipe (worker_pipe) < 0)
+    {
+      zlog_err ("worker: can't make pipe: %s", strerror (errno));
+      return;
+    }
+  fcntl (worker_pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl (worker_pipe[1], F_SETFL, O_NONBLOCK);
+
+  for (i = 0; i < count; i++)
+    {
+      if (pthread_create (&tid, NULL, worker_thread, NULL) != 0)
+        {
+          zlog_err ("worker: can't create thread: %s", strerror (errno));
+          break;
+        }
+      pthread_detach (tid);
+      worker_count++;
+    }
+}
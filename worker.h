@@ -0,0 +1,43 @@
+/* Worker thread pool for read-only commands.
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_WORKER_H
+#define _ZEBRA_WORKER_H
+
+#include "command.h"
+
+/* Default number of worker threads. */
+#define WORKER_THREADS_DEFAULT 2
+
+/* Output of a worker is handed back to the main thread in pieces of
+   about this many bytes. */
+#define WORKER_CHUNK_SIZE 4096
+
+/* Prototypes. */
+void worker_init (int);
+int worker_fd (void);
+int worker_execute (struct cmd_element *, struct vty *, int, char **);
+void worker_flush (struct vty *);
+void worker_process (void);
+void worker_cancel (struct vty *);
+void worker_state_lock (void);
+void worker_state_unlock (void);
+
+#endif /* _ZEBRA_WORKER_H */